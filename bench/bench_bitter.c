@@ -0,0 +1,460 @@
+/// @file bench_bitter.c
+/// Measures the bit functions over a sweep of field lengths, alignment,
+/// erase/start_low and message sizes from L1 to DRAM resident. Results are
+/// printed as CSV (default) or JSON, one record per measurement, to track
+/// regressions between releases.
+///
+/// Usage: bench_bitter.exe [-j] [-p] [-q] [-i isa] [-o file]
+///   -j        JSON output instead of CSV
+///   -p        Add hardware counters per field (perf_event_open), empty if
+///             not available
+///   -q        Quick run, only smallest and largest message size and a
+///             single round per measurement
+///   -i isa    Kernels to use, see bitter_isa_list
+///   -o file   Write results to file instead of stdout
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "bitter.h"
+
+
+#define ROUNDS      3
+#define MIN_TIME    0.01    // Seconds per round.
+
+// Message sizes in bytes, from L1 to DRAM resident.
+static const size_t message_sizes[] = {
+    16 << 10, 512 << 10, 8 << 20, 128 << 20
+};
+#define SIZE_CNT (int)(sizeof(message_sizes) / sizeof(message_sizes[0]))
+
+static const int single_lens[] = {
+    1, 2, 4, 7, 8, 13, 16, 31, 32, 33, 48, 63, 64
+};
+#define SINGLE_CNT (int)(sizeof(single_lens) / sizeof(single_lens[0]))
+
+static const int bulk_lens[] = {128, 1000, 8192, 65536};
+#define BULK_CNT (int)(sizeof(bulk_lens) / sizeof(bulk_lens[0]))
+
+typedef enum {
+    OP_SET, OP_GET, OP_SET_H, OP_GET_H, OP_SET_LE, OP_GET_LE,
+    OP_SET2, OP_GET2, OP_SET3, OP_GET3
+} op_t;
+
+static const char* op_names[] = {
+    "set_message_bits", "get_message_bits",
+    "set_message_bits_h", "get_message_bits_h",
+    "set_message_bits_le", "get_message_bits_le",
+    "set_message_bits2", "get_message_bits2",
+    "set_message_bits3", "get_message_bits3"
+};
+
+// Hardware counters reported with -p.
+typedef enum {
+    PC_CYCLES, PC_INSTRUCTIONS, PC_BRANCH_MISSES, PC_L1D_MISSES,
+    PC_LLC_MISSES, PC_CNT
+} counter_t;
+
+static const char* counter_names[] = {
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"
+};
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_events[] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+};
+
+// One measurement.
+typedef struct {
+    op_t op;
+    int bit_len;
+    bool aligned;
+    bool erase;
+    bool start_low;
+    size_t message_bytes;
+} bench_t;
+
+static FILE* out;
+static bool json;
+static bool perf;
+static int counter_fds[PC_CNT];
+static int rounds = ROUNDS;
+static int records;
+static volatile WORD_T sink;
+
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/*
+ * Opens the hardware counters of the calling thread, counting user space
+ * only. Counters not supported by the CPU or not permitted (containers,
+ * perf_event_paranoid) are left closed and reported as empty.
+ */
+static void counters_open(void) {
+    int open_cnt = 0;
+
+    for(int c=0; c<PC_CNT; c++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counter_events[c].type;
+        attr.config = counter_events[c].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        counter_fds[c] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if(counter_fds[c] >= 0)
+            open_cnt++;
+    }
+    if(open_cnt < PC_CNT)
+        fprintf(stderr, "%d of %d hardware counters not available, "
+            "reported as empty\n", PC_CNT - open_cnt, PC_CNT);
+}
+
+
+static void counters_close(void) {
+    for(int c=0; c<PC_CNT; c++)
+        if(counter_fds[c] >= 0)
+            close(counter_fds[c]);
+}
+
+
+static void counters_start(void) {
+    for(int c=0; c<PC_CNT; c++) {
+        if(counter_fds[c] >= 0) {
+            ioctl(counter_fds[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter_fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+
+/*
+ * Stops the counters and stores their values in values, -1 for counters
+ * not available. Counts are scaled up when the kernel multiplexed a counter
+ * with others.
+ */
+static void counters_stop(double values[]) {
+    for(int c=0; c<PC_CNT; c++) {
+        uint64_t data[3];
+        values[c] = -1;
+        if(counter_fds[c] < 0)
+            continue;
+        ioctl(counter_fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        if(read(counter_fds[c], data, sizeof(data)) != sizeof(data) ||
+           data[2] == 0)
+            continue;
+        values[c] = (double)data[0] * data[1] / data[2];
+    }
+}
+
+
+/*
+ * Runs one pass over the whole message, field after field. Word aligned
+ * fields start at word boundaries, crossing fields of single word lengths
+ * start so they continue in the next word (for bit_len > 1), bulk fields
+ * start 13 bits after a word boundary.
+ */
+static int64_t run_pass(const bench_t* b, WORD_T* message, int message_len,
+                        WORD_T* value, int value_len) {
+    int64_t msg_bits = (int64_t)message_len * WORD_BIT_LEN;
+    int64_t cnt = 0;
+    WORD_T sum = 0;
+    WORD_T v = 0;
+    bool bulk = b->bit_len > WORD_BIT_LEN;
+    int stride = (bulk ? (b->bit_len + WORD_BIT_LEN - 1) / WORD_BIT_LEN *
+                  WORD_BIT_LEN + WORD_BIT_LEN : WORD_BIT_LEN);
+    int offset = (b->aligned ? 0 :
+                  (bulk ? 13 : WORD_BIT_LEN - b->bit_len / 2));
+
+    for(int64_t pos=offset; pos + b->bit_len <= msg_bits - WORD_BIT_LEN;
+        pos += stride) {
+        int p = (int)pos;
+        switch(b->op) {
+            case OP_SET:
+                set_message_bits(message, message_len, p, b->bit_len, pos,
+                                 b->erase, b->start_low);
+                break;
+            case OP_GET:
+                get_message_bits(message, message_len, p, b->bit_len, &v,
+                                 b->start_low);
+                sum += v;
+                break;
+            case OP_SET_H:
+                set_message_bits_h(message, message_len, p, b->bit_len, pos,
+                                   b->erase, b->start_low);
+                break;
+            case OP_GET_H:
+                get_message_bits_h(message, message_len, p, b->bit_len, &v,
+                                   b->start_low);
+                sum += v;
+                break;
+            case OP_SET_LE:
+                set_message_bits_le(message, message_len, p, b->bit_len, pos,
+                                    b->erase, b->start_low);
+                break;
+            case OP_GET_LE:
+                get_message_bits_le(message, message_len, p, b->bit_len, &v,
+                                    b->start_low);
+                sum += v;
+                break;
+            case OP_SET2:
+                set_message_bits2(message, message_len, p, b->bit_len,
+                                  value, value_len, b->erase);
+                break;
+            case OP_GET2:
+                get_message_bits2(message, message_len, p, b->bit_len,
+                                  value, value_len);
+                sum += value[0];
+                break;
+            case OP_SET3:
+                set_message_bits3(message, message_len, p, b->bit_len,
+                                  (const uint8_t*)value,
+                                  value_len * WORD_BYTE_LEN, b->erase);
+                break;
+            case OP_GET3:
+                get_message_bits3(message, message_len, p, b->bit_len,
+                                  (uint8_t*)value,
+                                  value_len * WORD_BYTE_LEN);
+                sum += value[0];
+                break;
+        }
+        cnt++;
+    }
+    sink = sum;
+    return cnt;
+}
+
+
+// Prints a counter value per field, empty if not available.
+static void report_counter(const char* name, double value) {
+    if(json) {
+        if(value < 0)
+            fprintf(out, ", \"%s\": null", name);
+        else
+            fprintf(out, ", \"%s\": %.3f", name, value);
+    }
+    else {
+        if(value < 0)
+            fprintf(out, ",");
+        else
+            fprintf(out, ",%.3f", value);
+    }
+}
+
+
+static void report(const bench_t* b, int64_t fields, double ns,
+                   const double counts[]) {
+    double gbs = b->bit_len / 8.0 / ns;
+    if(json) {
+        fprintf(out, "%s  {\"function\": \"%s\", \"isa\": \"%s\", "
+            "\"bit_len\": %d, \"aligned\": %s, \"erase\": %s, "
+            "\"start_low\": %s, \"message_bytes\": %zu, "
+            "\"fields\": %" PRId64 ", "
+            "\"ns_per_field\": %.3f, \"gb_per_s\": %.3f",
+            (records ? ",\n" : ""), op_names[b->op], bitter_isa(),
+            b->bit_len, (b->aligned ? "true" : "false"),
+            (b->erase ? "true" : "false"), (b->start_low ? "true" : "false"),
+            b->message_bytes, fields, ns, gbs);
+    }
+    else {
+        fprintf(out, "%s,%s,%d,%d,%d,%d,%zu,%" PRId64 ",%.3f,%.3f",
+            op_names[b->op], bitter_isa(), b->bit_len, b->aligned, b->erase,
+            b->start_low, b->message_bytes, fields, ns, gbs);
+    }
+    if(perf) {
+        for(int c=0; c<PC_CNT; c++)
+            report_counter(counter_names[c],
+                           (counts[c] < 0 ? -1 : counts[c] / fields));
+        // Instructions per cycle.
+        report_counter("ipc", (counts[PC_CYCLES] > 0 &&
+            counts[PC_INSTRUCTIONS] >= 0 ?
+            counts[PC_INSTRUCTIONS] / counts[PC_CYCLES] : -1));
+    }
+    fprintf(out, (json ? "}" : "\n"));
+    records++;
+    fflush(out);
+}
+
+
+// Best of rounds, each repeating passes for at least MIN_TIME. All pages of
+// the message were touched when it was initialized. Counters are those of
+// the best round.
+static void measure(const bench_t* b, WORD_T* message, WORD_T* value,
+                    int value_len) {
+    int message_len = b->message_bytes / WORD_BYTE_LEN;
+    double best = 0;
+    int64_t fields = 0;
+    double counts[PC_CNT] = {0};
+    double best_counts[PC_CNT] = {0};
+
+    for(int r=0; r<rounds; r++) {
+        int64_t cnt = 0;
+        double t = now();
+        double elapsed;
+        if(perf)
+            counters_start();
+        do {
+            cnt += run_pass(b, message, message_len, value, value_len);
+            elapsed = now() - t;
+        } while(elapsed < MIN_TIME);
+        if(perf)
+            counters_stop(counts);
+        double ns = elapsed * 1e9 / cnt;
+        if(r == 0 || ns < best) {
+            best = ns;
+            fields = cnt;
+            memcpy(best_counts, counts, sizeof(counts));
+        }
+    }
+    report(b, fields, best, best_counts);
+}
+
+
+int main(int argc, char* argv[]) {
+    const char* path = NULL;
+    bool quick = false;
+    int opt;
+
+    out = stdout;
+    while((opt = getopt(argc, argv, "jpqi:o:")) != -1) {
+        switch(opt) {
+            case 'j':
+                json = true;
+                break;
+            case 'p':
+                perf = true;
+                break;
+            case 'q':
+                quick = true;
+                rounds = 1;
+                break;
+            case 'i':
+                if(bitter_set_isa(optarg) < 0) {
+                    fprintf(stderr, "isa '%s' not supported\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o':
+                path = optarg;
+                break;
+            default:
+                fprintf(stderr,
+                    "usage: %s [-j] [-p] [-q] [-i isa] [-o file]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(path != NULL && (out = fopen(path, "w")) == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    size_t max_bytes = message_sizes[SIZE_CNT - 1];
+    int value_len = bulk_lens[BULK_CNT - 1] / WORD_BIT_LEN + 1;
+    WORD_T* message = malloc(max_bytes);
+    WORD_T* value = calloc(value_len, sizeof(WORD_T));
+    if(message == NULL || value == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for(size_t i=0; i<max_bytes / WORD_BYTE_LEN; i++)
+        message[i] = (WORD_T)i * 0x9e3779b97f4a7c15ULL;
+    for(int i=0; i<value_len; i++)
+        value[i] = (WORD_T)i * 0xbf58476d1ce4e5b9ULL;
+
+    if(perf)
+        counters_open();
+
+    if(json)
+        fprintf(out, "[\n");
+    else {
+        fprintf(out, "function,isa,bit_len,aligned,erase,start_low,"
+            "message_bytes,fields,ns_per_field,gb_per_s");
+        if(perf) {
+            for(int c=0; c<PC_CNT; c++)
+                fprintf(out, ",%s", counter_names[c]);
+            fprintf(out, ",ipc");
+        }
+        fprintf(out, "\n");
+    }
+
+    for(int s=0; s<SIZE_CNT; s++) {
+        if(quick && s != 0 && s != SIZE_CNT - 1)
+            continue;
+        bench_t b = { .message_bytes = message_sizes[s] };
+
+        // Single word fields, set functions with all erase/start_low
+        // combinations, get functions with all start_low values.
+        for(b.op=OP_SET; b.op<=OP_GET_LE; b.op++) {
+            bool set = (b.op == OP_SET || b.op == OP_SET_H ||
+                        b.op == OP_SET_LE);
+            for(int l=0; l<SINGLE_CNT; l++) {
+                b.bit_len = single_lens[l];
+                for(int a=1; a>=0; a--) {
+                    b.aligned = a;
+                    // A single bit field never crosses a word boundary.
+                    if(!b.aligned && b.bit_len == 1)
+                        continue;
+                    for(int e=(set ? 1 : 0); e>=0; e--) {
+                        b.erase = e;
+                        for(int sl=1; sl>=0; sl--) {
+                            b.start_low = sl;
+                            measure(&b, message, value, value_len);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Multi word fields.
+        b.start_low = true;
+        for(b.op=OP_SET2; b.op<=OP_GET3; b.op++) {
+            bool set = (b.op == OP_SET2 || b.op == OP_SET3);
+            for(int l=0; l<BULK_CNT; l++) {
+                b.bit_len = bulk_lens[l];
+                for(int a=1; a>=0; a--) {
+                    b.aligned = a;
+                    for(int e=(set ? 1 : 0); e>=0; e--) {
+                        b.erase = e;
+                        measure(&b, message, value, value_len);
+                    }
+                }
+            }
+        }
+    }
+
+    if(json)
+        fprintf(out, "\n]\n");
+    if(perf)
+        counters_close();
+    if(out != stdout)
+        fclose(out);
+    free(message);
+    free(value);
+    return 0;
+}
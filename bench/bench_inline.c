@@ -0,0 +1,145 @@
+/// @file bench_inline.c
+/// Measures the cost per field of set_message_bits/get_message_bits called
+/// in libbitter.so versus the inline variants of bitter_inline.h, with
+/// constant and with runtime field positions and lengths.
+///
+/// Usage: bench_inline.exe [message_cnt]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bitter.h"
+#include "bitter_inline.h"
+
+
+#define MESSAGE_SIZE 2      // 2 * 64 bits = 128 bits
+#define FIELD_CNT    8
+#define ROUNDS       5
+
+// Fields of a fixed layout: start_bit, bit_len.
+#define FIELDS(X)   \
+    X(0, 4)         \
+    X(4, 4)         \
+    X(8, 8)         \
+    X(16, 16)       \
+    X(32, 13)       \
+    X(45, 3)        \
+    X(48, 32)       \
+    X(80, 24)
+
+static const int field_start[FIELD_CNT] = {0, 4, 8, 16, 32, 45, 48, 80};
+static const int field_len[FIELD_CNT] = {4, 4, 8, 16, 13, 3, 32, 24};
+
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// Library call, runtime arguments.
+static WORD_T run_shared(WORD_T* messages, int message_cnt,
+                         const int* start, const int* len) {
+    WORD_T sum = 0;
+    for(int n=0; n<message_cnt; n++) {
+        WORD_T* m = &messages[(size_t)n * MESSAGE_SIZE];
+        for(int i=0; i<FIELD_CNT; i++)
+            set_message_bits(m, MESSAGE_SIZE, start[i], len[i], n + i,
+                             true, true);
+        for(int i=0; i<FIELD_CNT; i++) {
+            WORD_T v = 0;
+            get_message_bits(m, MESSAGE_SIZE, start[i], len[i], &v, true);
+            sum += v;
+        }
+    }
+    return sum;
+}
+
+// Inline, runtime arguments.
+static WORD_T run_inline(WORD_T* messages, int message_cnt,
+                         const int* start, const int* len) {
+    WORD_T sum = 0;
+    for(int n=0; n<message_cnt; n++) {
+        WORD_T* m = &messages[(size_t)n * MESSAGE_SIZE];
+        for(int i=0; i<FIELD_CNT; i++)
+            set_message_bits_inline(m, MESSAGE_SIZE, start[i], len[i], n + i,
+                                    true, true);
+        for(int i=0; i<FIELD_CNT; i++) {
+            WORD_T v = 0;
+            get_message_bits_inline(m, MESSAGE_SIZE, start[i], len[i], &v,
+                                    true);
+            sum += v;
+        }
+    }
+    return sum;
+}
+
+// Inline, constant arguments.
+static WORD_T run_inline_const(WORD_T* messages, int message_cnt,
+                               const int* start, const int* len) {
+    WORD_T sum = 0;
+    for(int n=0; n<message_cnt; n++) {
+        WORD_T* m = &messages[(size_t)n * MESSAGE_SIZE];
+        WORD_T v = 0;
+        int i = 0;
+#define SET(s, l)   set_message_bits_inline(m, MESSAGE_SIZE, s, l, n + i++, \
+                                            true, true);
+#define GET(s, l)   get_message_bits_inline(m, MESSAGE_SIZE, s, l, &v, true); \
+                    sum += v;
+        FIELDS(SET)
+        FIELDS(GET)
+#undef SET
+#undef GET
+    }
+    return sum;
+}
+
+
+typedef WORD_T (*run_fn)(WORD_T*, int, const int*, const int*);
+
+// Best of ROUNDS runs in nanoseconds per field access.
+static double measure(run_fn fn, WORD_T* messages, int message_cnt,
+                      WORD_T* sum) {
+    double best = 0;
+    for(int r=0; r<ROUNDS; r++) {
+        double t = now();
+        *sum = fn(messages, message_cnt, field_start, field_len);
+        t = (now() - t) * 1e9 / ((double)message_cnt * FIELD_CNT * 2);
+        if(r == 0 || t < best)
+            best = t;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int message_cnt = (argc > 1 ? atoi(argv[1]) : 1000000);
+    if(message_cnt < 1) {
+        fprintf(stderr, "usage: %s [message_cnt]\n", argv[0]);
+        return 1;
+    }
+
+    WORD_T* messages = calloc((size_t)message_cnt * MESSAGE_SIZE,
+                              sizeof(WORD_T));
+    if(messages == NULL)
+        return 1;
+
+    printf("bitter %s, %d messages, %d fields, ns per field access\n",
+        bitter_isa(), message_cnt, FIELD_CNT);
+    WORD_T sum, sum2;
+    double t = measure(run_shared, messages, message_cnt, &sum);
+    printf("  %-24s %6.2f\n", "libbitter.so", t);
+    double t2 = measure(run_inline, messages, message_cnt, &sum2);
+    printf("  %-24s %6.2f  (%.1fx)\n", "inline", t2, t / t2);
+    if(sum2 != sum)
+        fprintf(stderr, "inline result differs\n");
+    t2 = measure(run_inline_const, messages, message_cnt, &sum2);
+    printf("  %-24s %6.2f  (%.1fx)\n", "inline, constant fields", t2, t / t2);
+    if(sum2 != sum)
+        fprintf(stderr, "inline constant result differs\n");
+
+    free(messages);
+    return 0;
+}
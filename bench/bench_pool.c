@@ -0,0 +1,112 @@
+/// @file bench_pool.c
+/// Measures messages per second of the multi threaded batch functions
+/// versus number of worker threads.
+///
+/// Usage: bench_pool.exe [message_cnt] [max_threads]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bitter.h"
+
+
+#define MESSAGE_SIZE 4      // 4 * 64 bits = 256 bits
+#define FIELD_CNT    16
+#define ROUNDS       5
+
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Best of ROUNDS runs in messages per second.
+static double run(bitter_pool_t* pool, const message_layout_t* layout,
+                  WORD_T* messages, int message_cnt, WORD_T** columns,
+                  bool encode) {
+    double best = 0;
+    for(int r=0; r<ROUNDS; r++) {
+        double t = now();
+        if(encode)
+            encode_columns_mt(pool, layout, messages, message_cnt,
+                              (const WORD_T* const*)columns);
+        else
+            decode_columns_mt(pool, layout, messages, message_cnt, columns);
+        t = now() - t;
+        if(message_cnt / t > best)
+            best = message_cnt / t;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int message_cnt = (argc > 1 ? atoi(argv[1]) : 4000000);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = (argc > 2 ? atoi(argv[2]) : (int)cpus);
+    if(message_cnt < 1 || max_threads < 1) {
+        fprintf(stderr, "usage: %s [message_cnt] [max_threads]\n", argv[0]);
+        return 1;
+    }
+
+    // Fields of 1 - 31 bits filling about 3 message words.
+    field_desc_t fields[FIELD_CNT];
+    int next_pos = 0;
+    for(int i=0; i<FIELD_CNT; i++) {
+        fields[i].start_bit = next_pos;
+        fields[i].bit_len = 1 + (i * 7) % 31;
+        fields[i].erase = true;
+        fields[i].start_low = true;
+        fields[i].value_offset = i * sizeof(WORD_T);
+        next_pos += fields[i].bit_len;
+    }
+    message_layout_t layout;
+    if(message_layout_init(&layout, fields, FIELD_CNT, MESSAGE_SIZE) < 0) {
+        fprintf(stderr, "invalid layout\n");
+        return 1;
+    }
+
+    WORD_T* messages = calloc((size_t)message_cnt * MESSAGE_SIZE,
+                              sizeof(WORD_T));
+    WORD_T* columns[FIELD_CNT];
+    unsigned int seed = 1;
+    for(int i=0; i<FIELD_CNT; i++) {
+        columns[i] = malloc((size_t)message_cnt * sizeof(WORD_T));
+        if(columns[i] == NULL)
+            return 1;
+        for(int k=0; k<message_cnt; k++)
+            columns[i][k] = rand_in_range_r(&seed, 0, 0x7fffffff);
+    }
+    if(messages == NULL)
+        return 1;
+
+    printf("isa: %s, cpus: %ld, messages: %d, fields: %d\n\n",
+        bitter_isa(), cpus, message_cnt, FIELD_CNT);
+    printf("threads  encode msg/s  decode msg/s  speedup\n");
+
+    double base = 0;
+    for(int threads=1; threads<=max_threads;
+        threads = (threads * 2 > max_threads && threads < max_threads ?
+                   max_threads : threads * 2)) {
+        bitter_pool_t* pool = bitter_pool_create(threads, 0);
+        if(pool == NULL) {
+            fprintf(stderr, "failed to create pool of %d threads\n", threads);
+            return 1;
+        }
+        double enc = run(pool, &layout, messages, message_cnt, columns, true);
+        double dec = run(pool, &layout, messages, message_cnt, columns, false);
+        if(threads == 1)
+            base = enc;
+        printf("%7d  %12.3e  %12.3e  %7.2f\n", threads, enc, dec, enc / base);
+        bitter_pool_destroy(pool);
+    }
+
+    for(int i=0; i<FIELD_CNT; i++)
+        free(columns[i]);
+    free(messages);
+    message_layout_free(&layout);
+    return 0;
+}
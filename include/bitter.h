@@ -3,10 +3,15 @@
 #ifndef _BITTER_H_
 #define _BITTER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 // Endian conversion for 64 bit values
 #if __BIG_ENDIAN__
@@ -18,8 +23,6 @@
 #endif
 
 
-//#define MESSAGE_DEBUG
-
 // Using 64bit words.
 #define WORD_T          uint64_t
 #define WORD_BIT_LEN    64
@@ -36,6 +39,10 @@
 
 extern int pow_i(int x, int n);
 extern int rand_in_range(int min, int max);
+extern int rand_in_range_r(unsigned int* seed, int min, int max);
+extern int bitter_set_isa(const char* isa);
+extern const char* bitter_isa(void);
+extern const char* const* bitter_isa_list(int* cnt);
 extern void dump_hex(FILE* fd, const void* data, unsigned int size, bool show_addr,
     void (*cb)(const char*));
 
@@ -66,4 +73,484 @@ extern int get_message_bits3(WORD_T message[], int message_len,
                       int start_bit, int bit_len,
                       uint8_t value[], int value_len);
 
+
+extern int set_message_bits_h(WORD_T message[], int message_len,
+                     int start_bit, int bit_len,
+                     const WORD_T value,
+                     bool erase, bool start_low);
+extern int get_message_bits_h(const WORD_T message[], int message_len,
+                     int start_bit, int bit_len, WORD_T* value,
+                     bool start_low);
+extern int set_message_bits2_h(WORD_T message[], int message_len,
+                      int start_bit, int bit_len,
+                      const WORD_T value[], int value_len,
+                      bool erase);
+extern int get_message_bits2_h(const WORD_T message[], int message_len,
+                      int start_bit, int bit_len,
+                      WORD_T value[], int value_len);
+extern int set_message_bits3_h(WORD_T message[], int message_len,
+                      int start_bit, int bit_len,
+                      const uint8_t value[], int value_len,
+                      bool erase);
+extern int get_message_bits3_h(const WORD_T message[], int message_len,
+                      int start_bit, int bit_len,
+                      uint8_t value[], int value_len);
+extern int message_finalize(WORD_T message[], int64_t message_len);
+extern int message_load(WORD_T message[], int64_t message_len);
+
+
+extern int set_message_bits_le(WORD_T message[], int message_len,
+                     int start_bit, int bit_len,
+                     const WORD_T value,
+                     bool erase, bool start_low);
+extern int get_message_bits_le(const WORD_T message[], int message_len,
+                     int start_bit, int bit_len, WORD_T* value,
+                     bool start_low);
+extern int set_message_bits2_le(WORD_T message[], int message_len,
+                      int start_bit, int bit_len,
+                      const WORD_T value[], int value_len,
+                      bool erase);
+extern int get_message_bits2_le(const WORD_T message[], int message_len,
+                      int start_bit, int bit_len,
+                      WORD_T value[], int value_len);
+extern int set_message_bits3_le(WORD_T message[], int message_len,
+                      int start_bit, int bit_len,
+                      const uint8_t value[], int value_len,
+                      bool erase);
+extern int get_message_bits3_le(const WORD_T message[], int message_len,
+                      int start_bit, int bit_len,
+                      uint8_t value[], int value_len);
+
+
+extern int64_t set_message_bits_l(WORD_T message[], int64_t message_len,
+                      int64_t start_bit, int bit_len,
+                      const WORD_T value,
+                      bool erase, bool start_low);
+extern int64_t get_message_bits_l(const WORD_T message[], int64_t message_len,
+                      int64_t start_bit, int bit_len, WORD_T* value,
+                      bool start_low);
+extern int64_t set_message_bits2_l(WORD_T message[], int64_t message_len,
+                      int64_t start_bit, int64_t bit_len,
+                      const WORD_T value[], int64_t value_len,
+                      bool erase);
+extern int64_t get_message_bits2_l(const WORD_T message[], int64_t message_len,
+                      int64_t start_bit, int64_t bit_len,
+                      WORD_T value[], int64_t value_len);
+extern int64_t set_message_bits3_l(WORD_T message[], int64_t message_len,
+                      int64_t start_bit, int64_t bit_len,
+                      const uint8_t value[], int64_t value_len,
+                      bool erase);
+extern int64_t get_message_bits3_l(const WORD_T message[], int64_t message_len,
+                      int64_t start_bit, int64_t bit_len,
+                      uint8_t value[], int64_t value_len);
+
+
+extern int set_buffer_bits(uint8_t buffer[], size_t buffer_len,
+                      int start_bit, int bit_len,
+                      const WORD_T value,
+                      bool erase, bool start_low);
+extern int get_buffer_bits(const uint8_t buffer[], size_t buffer_len,
+                      int start_bit, int bit_len, WORD_T* value,
+                      bool start_low);
+extern int set_buffer_bits3(uint8_t buffer[], size_t buffer_len,
+                      int start_bit, int bit_len,
+                      const uint8_t value[], int value_len,
+                      bool erase);
+extern int get_buffer_bits3(const uint8_t buffer[], size_t buffer_len,
+                      int start_bit, int bit_len,
+                      uint8_t value[], int value_len);
+
+
+// Cursor to sequentially append fields to a binary message. Pending bits
+// are collected in an accumulator word in host-byte-order and written to
+// the message only once a word is completely filled.
+typedef struct {
+    WORD_T* message;
+    int message_len;
+    int word_idx;       // Message word index the accumulator belongs to.
+    WORD_T acc;         // Pending bits, MSB aligned.
+    int acc_bits;       // Number of pending bits in acc.
+    int bits_free;      // Bits left until end of message.
+    int bit_pos;        // Absolute bit position of cursor.
+} bit_writer_t;
+
+// Cursor to sequentially extract fields from a binary message.
+typedef struct {
+    const WORD_T* message;
+    int message_len;
+    int word_idx;       // Index of next message word to load.
+    WORD_T acc;         // Unread bits of current word, MSB aligned.
+    int acc_bits;       // Number of unread bits in acc.
+    int bits_left;      // Bits left until end of message.
+    int bit_pos;        // Absolute bit position of cursor.
+} bit_reader_t;
+
+extern int bit_writer_init(bit_writer_t* writer, WORD_T message[],
+                    int message_len, int start_bit);
+extern int bit_writer_put(bit_writer_t* writer, int bit_len,
+                    const WORD_T value, bool start_low);
+extern int bit_writer_flush(bit_writer_t* writer);
+
+extern int bit_reader_init(bit_reader_t* reader, const WORD_T message[],
+                    int message_len, int start_bit);
+extern int bit_reader_get(bit_reader_t* reader, int bit_len,
+                    WORD_T* value, bool start_low);
+
+
+// Describes one field of a message layout.
+typedef struct {
+    int start_bit;          // Absolute bit position of field in message.
+    int bit_len;            // Number of bits (1-n) of field.
+    bool erase;             // Set field range to 0 before inserting value.
+    bool start_low;         // Value starts at bit position <bit_len>.
+    size_t value_offset;    // Byte offset of WORD_T value in values struct.
+} field_desc_t;
+
+// Operation on one message word for (a part of) a field.
+typedef struct {
+    int word_idx;
+    int field_idx;          // Index of field in field descriptor table.
+    size_t value_offset;
+    int lshift;
+    int rshift;
+    WORD_T mask;            // Bits of field in message word.
+    WORD_T clear;           // Bits to erase before inserting value.
+    WORD_T keep;            // Bits of value to keep when decoding.
+} field_op_t;
+
+// All operations on one message word.
+typedef struct {
+    int word_idx;
+    int op_start;
+    int op_cnt;
+    bool load;              // Word has to be read before encoding.
+} field_group_t;
+
+// A validated field descriptor table created by message_layout_init.
+typedef struct {
+    int message_len;
+    int field_cnt;
+    int op_cnt;
+    field_op_t* ops;
+    int group_cnt;
+    field_group_t* groups;
+    int end_bit;
+} message_layout_t;
+
+extern int message_layout_init(message_layout_t* layout,
+                    const field_desc_t fields[], int field_cnt,
+                    int message_len);
+extern void message_layout_free(message_layout_t* layout);
+extern int encode_fields(const message_layout_t* layout, WORD_T message[],
+                    const void* values);
+extern int decode_fields(const message_layout_t* layout,
+                    const WORD_T message[], void* values);
+
+extern int encode_columns(const message_layout_t* layout, WORD_T messages[],
+                    int message_cnt, const WORD_T* const columns[]);
+extern int encode_columns_ptr(const message_layout_t* layout,
+                    WORD_T* const messages[], int message_cnt,
+                    const WORD_T* const columns[]);
+extern int decode_columns(const message_layout_t* layout,
+                    const WORD_T messages[], int message_cnt,
+                    WORD_T* const columns[]);
+extern int decode_columns_ptr(const message_layout_t* layout,
+                    const WORD_T* const messages[], int message_cnt,
+                    WORD_T* const columns[]);
+extern int decode_columns_buffer(const message_layout_t* layout,
+                    const uint8_t* const buffers[],
+                    const size_t buffer_lens[], int buffer_cnt,
+                    WORD_T* const columns[], int column_idx);
+
+
+// Pool of worker threads created by bitter_pool_create.
+typedef struct bitter_pool bitter_pool_t;
+
+// Job function called by pool workers for the items [start, end).
+typedef void (*bitter_pool_fn)(void* arg, int start, int end,
+                    void* scratch, int worker);
+
+extern bitter_pool_t* bitter_pool_create(int thread_cnt, size_t scratch_size);
+extern void bitter_pool_destroy(bitter_pool_t* pool);
+extern int bitter_pool_threads(const bitter_pool_t* pool);
+extern int bitter_pool_run(bitter_pool_t* pool, int cnt, int chunk,
+                    bitter_pool_fn fn, void* arg);
+
+extern int encode_columns_mt(bitter_pool_t* pool,
+                    const message_layout_t* layout, WORD_T messages[],
+                    int message_cnt, const WORD_T* const columns[]);
+extern int encode_columns_ptr_mt(bitter_pool_t* pool,
+                    const message_layout_t* layout,
+                    WORD_T* const messages[], int message_cnt,
+                    const WORD_T* const columns[]);
+extern int decode_columns_mt(bitter_pool_t* pool,
+                    const message_layout_t* layout,
+                    const WORD_T messages[], int message_cnt,
+                    WORD_T* const columns[]);
+extern int decode_columns_ptr_mt(bitter_pool_t* pool,
+                    const message_layout_t* layout,
+                    const WORD_T* const messages[], int message_cnt,
+                    WORD_T* const columns[]);
+
+
+// Arena of cache line aligned messages created by bitter_arena_create.
+typedef struct bitter_arena bitter_arena_t;
+
+// Flags of bitter_arena_create.
+#define BITTER_ARENA_HUGE       0x1     // Back messages by huge pages.
+#define BITTER_ARENA_ZERO       0x2     // Zero messages when released.
+
+extern bitter_arena_t* bitter_arena_create(int flags);
+extern void bitter_arena_destroy(bitter_arena_t* arena);
+extern WORD_T* bitter_arena_alloc(bitter_arena_t* arena, int64_t message_len);
+extern void bitter_arena_free(bitter_arena_t* arena, WORD_T* message);
+extern void bitter_arena_reset(bitter_arena_t* arena);
+
+
+// CRC parameters as listed in CRC catalogues (Rocksoft model) and tables
+// computed by crc_init. CRC values are uint64_t independent of WORD_T.
+typedef struct {
+    int width;                  // Number of CRC bits, 1 to 64.
+    uint64_t poly;              // Polynomial without the x^width term.
+    uint64_t init;              // Initial register value.
+    bool reflect_in;            // Bytes are fed least significant bit first.
+    bool reflect_out;           // Register is reflected before xor_out.
+    uint64_t xor_out;           // Xored to the final register value.
+
+    // Registers are MSB aligned to bit 63.
+    uint64_t table[8][256];     // Slice-by-8 tables.
+    uint64_t fold[4];           // x^576, x^512, x^192, x^128 mod poly.
+    uint64_t zeros[63];         // x^(2^k) mod poly.
+} crc_t;
+
+// Presets of crc_init_preset.
+#define CRC_15_CAN              1   // CAN frames.
+#define CRC_16_HDLC             2   // HDLC, X.25, PPP (CRC-16/IBM-SDLC).
+#define CRC_16_CCITT_FALSE      3   // CRC-16/CCITT-FALSE.
+#define CRC_24Q                 4   // Qualcomm CRC-24Q, RTCM.
+#define CRC_32                  5   // Ethernet, zlib (CRC-32/ISO-HDLC).
+#define CRC_32C                 6   // Castagnoli, iSCSI, SCTP.
+#define CRC_64_XZ               7   // xz (CRC-64/XZ).
+
+extern int crc_init(crc_t* crc, int width, uint64_t poly, uint64_t init,
+                    bool reflect_in, bool reflect_out, uint64_t xor_out);
+extern int crc_init_preset(crc_t* crc, int preset);
+extern int message_crc(const crc_t* crc, const WORD_T message[],
+                    int message_len, int start_bit, int bit_len,
+                    uint64_t* value);
+extern int64_t message_crc_l(const crc_t* crc, const WORD_T message[],
+                    int64_t message_len, int64_t start_bit, int64_t bit_len,
+                    uint64_t* value);
+extern int message_crc_update(const crc_t* crc, uint64_t* value,
+                    int64_t start_bit, int64_t bit_len,
+                    int64_t field_start_bit, int field_bit_len,
+                    WORD_T old_value, WORD_T new_value);
+
+
+extern int copy_message_bits(WORD_T dst[], int dst_len, int dst_bit,
+                    const WORD_T src[], int src_len, int src_bit,
+                    int bit_len);
+extern int64_t copy_message_bits_l(WORD_T dst[], int64_t dst_len,
+                    int64_t dst_bit, const WORD_T src[], int64_t src_len,
+                    int64_t src_bit, int64_t bit_len);
+extern int fill_message_bits(WORD_T message[], int message_len,
+                    int start_bit, int bit_len, WORD_T pattern,
+                    int pattern_len);
+extern int64_t fill_message_bits_l(WORD_T message[], int64_t message_len,
+                    int64_t start_bit, int64_t bit_len, WORD_T pattern,
+                    int pattern_len);
+extern int clear_message_bits(WORD_T message[], int message_len,
+                    int start_bit, int bit_len);
+extern int64_t clear_message_bits_l(WORD_T message[], int64_t message_len,
+                    int64_t start_bit, int64_t bit_len);
+extern int insert_message_bits(WORD_T message[], int message_len,
+                    int start_bit, int bit_len);
+extern int64_t insert_message_bits_l(WORD_T message[], int64_t message_len,
+                    int64_t start_bit, int64_t bit_len);
+extern int delete_message_bits(WORD_T message[], int message_len,
+                    int start_bit, int bit_len);
+extern int64_t delete_message_bits_l(WORD_T message[], int64_t message_len,
+                    int64_t start_bit, int64_t bit_len);
+
+extern int message_find(const WORD_T message[], int message_len,
+                    int start_bit, int bit_len, WORD_T pattern,
+                    int pattern_len, int max_errors);
+extern int64_t message_find_l(const WORD_T message[], int64_t message_len,
+                    int64_t start_bit, int64_t bit_len, WORD_T pattern,
+                    int pattern_len, int max_errors);
+extern int64_t message_find_all(const WORD_T message[], int64_t message_len,
+                    int64_t start_bit, int64_t bit_len, WORD_T pattern,
+                    int pattern_len, int max_errors,
+                    int64_t positions[], int64_t max_positions);
+
+
+// Message of up to 2^63 bits memory mapped from a file.
+typedef struct {
+    WORD_T* words;          // Stream as message words in network-byte-order.
+    int64_t word_len;       // Number of words covering bit_len bits.
+    int64_t bit_len;        // Number of bits of stream.
+    size_t map_len;         // Bytes mapped.
+    int fd;                 // Backing file, -1 for anonymous memory.
+    bool writable;
+} bitstream_t;
+
+// Access pattern hints for bitstream_advise.
+#define BITSTREAM_SEQUENTIAL    0
+#define BITSTREAM_RANDOM        1
+#define BITSTREAM_WILLNEED      2
+#define BITSTREAM_DONTNEED      3
+
+extern int bitstream_open(bitstream_t* bs, const char* path, bool writable);
+extern int bitstream_create(bitstream_t* bs, const char* path,
+                    int64_t bit_len);
+extern int bitstream_resize(bitstream_t* bs, int64_t bit_len);
+extern int bitstream_sync(bitstream_t* bs);
+extern int bitstream_advise(bitstream_t* bs, int64_t start_bit,
+                    int64_t bit_len, int advice);
+extern void bitstream_close(bitstream_t* bs);
+extern int64_t bitstream_set_bits(bitstream_t* bs, int64_t start_bit,
+                    int bit_len, const WORD_T value,
+                    bool erase, bool start_low);
+extern int64_t bitstream_get_bits(const bitstream_t* bs, int64_t start_bit,
+                    int bit_len, WORD_T* value, bool start_low);
+extern int64_t bitstream_set_bits3(bitstream_t* bs, int64_t start_bit,
+                    int64_t bit_len, const uint8_t value[],
+                    int64_t value_len, bool erase);
+extern int64_t bitstream_get_bits3(const bitstream_t* bs, int64_t start_bit,
+                    int64_t bit_len, uint8_t value[], int64_t value_len);
+extern int64_t bitstream_insert_bits(bitstream_t* bs, int64_t start_bit,
+                    int64_t bit_len);
+extern int64_t bitstream_delete_bits(bitstream_t* bs, int64_t start_bit,
+                    int64_t bit_len);
+extern int64_t bitstream_find(const bitstream_t* bs, int64_t start_bit,
+                    int64_t bit_len, WORD_T pattern, int pattern_len,
+                    int max_errors);
+extern int64_t bitstream_find_all(const bitstream_t* bs, int64_t start_bit,
+                    int64_t bit_len, WORD_T pattern, int pattern_len,
+                    int max_errors, int64_t positions[],
+                    int64_t max_positions);
+
+
+// Statistics of decode_capture.
+typedef struct {
+    uint64_t packets;       // Packets read from capture.
+    uint64_t bytes;         // Captured bytes of all packets.
+    uint64_t decoded;       // Packets passed to callback.
+    uint64_t skipped;       // Packets too short for layout.
+    double seconds;
+    double packets_per_sec;
+    double bytes_per_sec;
+} capture_stats_t;
+
+// Called by decode_capture with a batch of decoded packets. columns[i][k]
+// is the value of field i of packet k.
+typedef int (*capture_fn)(void* arg, WORD_T* const columns[],
+                    const uint64_t timestamps[], int packet_cnt);
+
+extern int decode_capture(const char* path, const message_layout_t* layout,
+                    int payload_offset, int batch_size,
+                    capture_fn fn, void* arg, capture_stats_t* stats);
+
+// Functions recorded in trace events.
+#define BITTER_TRACE_SET_BITS               1
+#define BITTER_TRACE_GET_BITS               2
+#define BITTER_TRACE_SET_BITS2              3
+#define BITTER_TRACE_GET_BITS2              4
+#define BITTER_TRACE_SET_BITS3              5
+#define BITTER_TRACE_GET_BITS3              6
+#define BITTER_TRACE_SET_BITS_H             7
+#define BITTER_TRACE_GET_BITS_H             8
+#define BITTER_TRACE_SET_BITS_LE            9
+#define BITTER_TRACE_GET_BITS_LE            10
+#define BITTER_TRACE_SET_BITS2_LE           11
+#define BITTER_TRACE_GET_BITS2_LE           12
+#define BITTER_TRACE_SET_BITS3_LE           13
+#define BITTER_TRACE_GET_BITS3_LE           14
+#define BITTER_TRACE_SET_BITS2_H            15
+#define BITTER_TRACE_GET_BITS2_H            16
+#define BITTER_TRACE_SET_BITS3_H            17
+#define BITTER_TRACE_GET_BITS3_H            18
+#define BITTER_TRACE_SET_BUFFER_BITS        19
+#define BITTER_TRACE_GET_BUFFER_BITS        20
+#define BITTER_TRACE_SET_BUFFER_BITS3       21
+#define BITTER_TRACE_GET_BUFFER_BITS3       22
+#define BITTER_TRACE_BIT_WRITER_PUT         23
+#define BITTER_TRACE_BIT_WRITER_FLUSH       24
+#define BITTER_TRACE_BIT_READER_GET         25
+#define BITTER_TRACE_ENCODE_FIELDS          26
+#define BITTER_TRACE_DECODE_FIELDS          27
+#define BITTER_TRACE_ENCODE_COLUMNS         28  // Also _ptr and _mt variants.
+#define BITTER_TRACE_DECODE_COLUMNS         29  // Also _ptr and _mt variants.
+#define BITTER_TRACE_DECODE_COLUMNS_BUFFER  30
+#define BITTER_TRACE_MESSAGE_CRC            31
+#define BITTER_TRACE_MESSAGE_CRC_UPDATE     32
+#define BITTER_TRACE_MESSAGE_FIND           33
+#define BITTER_TRACE_MESSAGE_FIND_ALL       34
+#define BITTER_TRACE_COPY_BITS              35
+#define BITTER_TRACE_FILL_BITS              36
+#define BITTER_TRACE_CLEAR_BITS             37
+#define BITTER_TRACE_INSERT_BITS            38
+#define BITTER_TRACE_DELETE_BITS            39
+#define BITTER_TRACE_MESSAGE_FINALIZE       40
+#define BITTER_TRACE_MESSAGE_LOAD           41
+#define BITTER_TRACE_BITSTREAM_SET_BITS     42
+#define BITTER_TRACE_BITSTREAM_GET_BITS     43
+#define BITTER_TRACE_BITSTREAM_SET_BITS3    44
+#define BITTER_TRACE_BITSTREAM_GET_BITS3    45
+#define BITTER_TRACE_BITSTREAM_INSERT_BITS  46
+#define BITTER_TRACE_BITSTREAM_DELETE_BITS  47
+#define BITTER_TRACE_BITSTREAM_FIND         48
+#define BITTER_TRACE_BITSTREAM_FIND_ALL     49
+#define BITTER_TRACE_FUNCTIONS              50  // Number of ids including 0.
+
+// Event flags.
+#define BITTER_TRACE_CROSSING       0x0001  // Field crosses a word boundary.
+
+// Events kept per thread, older events are overwritten.
+#define BITTER_TRACE_EVENTS         4096
+
+// One recorded call of a bit function.
+typedef struct {
+    uint64_t time_ns;       // CLOCK_MONOTONIC time of call.
+    int64_t start_bit;
+    int64_t bit_len;
+    int64_t result;         // Next bit position or negative error code.
+    uint32_t thread;        // Thread id of caller.
+    uint16_t function;      // BITTER_TRACE_* function.
+    uint16_t flags;         // BITTER_TRACE_* flags.
+} bitter_trace_event_t;
+
+extern void bitter_trace_enable(bool enable);
+extern bool bitter_trace_enabled(void);
+extern void bitter_trace_clear(void);
+extern int bitter_trace_snapshot(bitter_trace_event_t events[],
+                    int max_events);
+extern int bitter_trace_write(const char* path);
+extern const char* bitter_trace_name(int function);
+
+// Error codes counted separately, see bitter_stats_error_code.
+#define BITTER_STATS_ERRORS         10
+// Buckets of the bit_len histogram, see bitter_stats_bit_len.
+#define BITTER_STATS_BIT_LENS       (WORD_BIT_LEN + 32)
+
+// Counters of one bit function.
+typedef struct {
+    uint64_t calls;
+    uint64_t crossing;      // Calls with a field crossing a word boundary.
+    uint64_t errors[BITTER_STATS_ERRORS];
+    uint64_t bit_lens[BITTER_STATS_BIT_LENS];
+} bitter_stats_t;
+
+extern void bitter_stats_enable(bool enable);
+extern bool bitter_stats_enabled(void);
+extern void bitter_stats_clear(void);
+extern int bitter_stats_snapshot(bitter_stats_t stats[]);
+extern int bitter_stats_error_code(int index);
+extern int64_t bitter_stats_bit_len(int index);
+extern int bitter_stats_write(FILE* fd);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
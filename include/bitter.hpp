@@ -0,0 +1,123 @@
+/// @file bitter.hpp
+/// Header only C++ field accessors for fields whose position and length are
+/// known at compile time. Each access compiles down to one or two word loads
+/// plus shift and mask, producing the same bits as set_message_bits and
+/// get_message_bits with start_low set. Requires C++17.
+
+#ifndef _BITTER_HPP_
+#define _BITTER_HPP_
+
+#include <cstddef>
+#include <type_traits>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+
+
+namespace bitter {
+
+// Word with the <n> least significant bits set (1 <= n <= word len).
+constexpr WORD_T mask_low(int n) {
+    return (n < WORD_BIT_LEN ? ((WORD_T)1 << n) - 1 : ~(WORD_T)0);
+}
+
+// Byte order conversion as single swap instruction, WORD_NTOH combines two
+// 32 bit swaps.
+inline WORD_T ntoh(WORD_T w) {
+#if WORD_BIT_LEN == 64 && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap64(w);
+#else
+    return WORD_NTOH(w);
+#endif
+}
+
+inline WORD_T hton(WORD_T w) {
+    return ntoh(w);
+}
+
+
+/**
+ * field - a field of Width bits starting at absolute bit position Offset of
+ * a binary message in network-byte-order, bit 0 is the MSB of word 0.
+ * Values are right aligned like with start_low set in the C functions.
+ *
+ *     using seq = bitter::field<12, 20>;
+ *     seq::set(message, 0x12345);
+ *     WORD_T v = seq::get(message);
+ *
+ * When a message is given as array its length is checked at compile time,
+ * when given as pointer the caller has to guarantee it is long enough.
+ */
+template<int Offset, int Width>
+struct field {
+    static_assert(Offset >= 0, "field offset must not be negative");
+    static_assert(Width >= 1 && Width <= WORD_BIT_LEN,
+                  "field width must be 1 to WORD_BIT_LEN bits");
+
+    static constexpr int offset = Offset;
+    static constexpr int width = Width;
+    static constexpr int end = Offset + Width;
+
+    // Message word index and bit offset in message word.
+    static constexpr std::size_t word = Offset / WORD_BIT_LEN;
+    static constexpr int shift = Offset % WORD_BIT_LEN;
+    // Field continues in the next message word.
+    static constexpr bool crosses = shift + Width > WORD_BIT_LEN;
+    static constexpr WORD_T mask = mask_low(Width);
+
+    // Pointer overloads are templates too, otherwise they would be chosen
+    // for arrays and skip the length check.
+    template<typename P, typename = std::enable_if_t<std::is_pointer_v<P>>>
+    static WORD_T get(P message) {
+        WORD_T m = ntoh(message[word]);
+        if constexpr (!crosses) {
+            return (m >> (WORD_BIT_LEN - shift - Width)) & mask;
+        }
+        else {
+            // Bits in next word.
+            constexpr int r = shift + Width - WORD_BIT_LEN;
+            return ((m & mask_low(WORD_BIT_LEN - shift)) << r) |
+                   (ntoh(message[word + 1]) >> (WORD_BIT_LEN - r));
+        }
+    }
+
+    template<typename P, typename = std::enable_if_t<std::is_pointer_v<P>>>
+    static void set(P message, WORD_T value, bool erase = true) {
+        value &= mask;
+        WORD_T m = ntoh(message[word]);
+        if constexpr (!crosses) {
+            constexpr int ls = WORD_BIT_LEN - shift - Width;
+            if(erase)
+                m &= ~(mask << ls);
+            message[word] = hton(m | (value << ls));
+        }
+        else {
+            constexpr int r = shift + Width - WORD_BIT_LEN;
+            if(erase)
+                m &= ~mask_low(WORD_BIT_LEN - shift);
+            message[word] = hton(m | (value >> r));
+
+            WORD_T m1 = ntoh(message[word + 1]);
+            if(erase)
+                m1 &= mask_low(WORD_BIT_LEN - r);
+            message[word + 1] = hton(m1 | (value << (WORD_BIT_LEN - r)));
+        }
+    }
+
+    template<std::size_t N>
+    static WORD_T get(const WORD_T (&message)[N]) {
+        static_assert(end <= N * WORD_BIT_LEN, "field spans over end of message");
+        return get<const WORD_T*>(&message[0]);
+    }
+
+    template<std::size_t N>
+    static void set(WORD_T (&message)[N], WORD_T value, bool erase = true) {
+        static_assert(end <= N * WORD_BIT_LEN, "field spans over end of message");
+        set<WORD_T*>(&message[0], value, erase);
+    }
+};
+
+} // namespace bitter
+
+#endif
@@ -0,0 +1,194 @@
+/// @file bitter_inline.h
+/// Inline variants of the single field functions. Calls are inlined into the
+/// caller and specialized by the compiler when bit_len, start_low or erase
+/// are constants, instead of calling into libbitter.so through the PLT.
+/// Results and error codes are the same as for the library functions.
+
+#ifndef _BITTER_INLINE_H_
+#define _BITTER_INLINE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bitter.h"
+
+
+#define BITTER_INLINE   static inline __attribute__((always_inline))
+
+// Word byte orders of the message types.
+#define BITTER_NETWORK  0
+#define BITTER_HOST     1
+#define BITTER_LE       2
+
+
+BITTER_INLINE WORD_T bitter_bswap(WORD_T w) {
+#if WORD_BIT_LEN == 64
+    return __builtin_bswap64(w);
+#else
+    return __builtin_bswap32(w);
+#endif
+}
+
+// Converts a message word between host-byte-order and byte order order.
+BITTER_INLINE WORD_T bitter_conv(WORD_T w, int order) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return (order == BITTER_NETWORK ? bitter_bswap(w) : w);
+#else
+    return (order == BITTER_LE ? bitter_bswap(w) : w);
+#endif
+}
+
+BITTER_INLINE WORD_T bitter_mask_low(int n) {
+    return (n < WORD_BIT_LEN ? ((WORD_T)1 << n) - 1 : ~(WORD_T)0);
+}
+
+// Argument checks of set_message_bits and get_message_bits.
+BITTER_INLINE int bitter_check(int message_len, int start_bit, int bit_len) {
+    if(start_bit < 0 || start_bit / WORD_BIT_LEN >= message_len)
+        return -1;
+    if(bit_len > WORD_BIT_LEN || bit_len < 0)
+        return -2;
+    if(start_bit / WORD_BIT_LEN == message_len - 1 &&
+       start_bit % WORD_BIT_LEN + bit_len > WORD_BIT_LEN)
+        return -3;
+    return 0;
+}
+
+
+/*
+ * Fields of MSB-first messages (network and host order) are MSB aligned in
+ * a word v and shifted right by mo into word 0, bits shifted out continue
+ * in word 1. Fields of LSB-first messages are LSB aligned and shifted left.
+ */
+BITTER_INLINE int bitter_set_bits(WORD_T message[], int message_len,
+                                  int start_bit, int bit_len, WORD_T value,
+                                  bool erase, bool start_low, int order) {
+    int rtc = bitter_check(message_len, start_bit, bit_len);
+    if(rtc < 0)
+        return rtc;
+    if(bit_len == 0)
+        return start_bit;
+
+    WORD_T* m = &message[start_bit / WORD_BIT_LEN];
+    int mo = start_bit % WORD_BIT_LEN;
+    bool crosses = mo + bit_len > WORD_BIT_LEN;
+    WORD_T mask = bitter_mask_low(bit_len);
+    WORD_T w = bitter_conv(m[0], order);
+
+    if(order == BITTER_LE) {
+        WORD_T v = (start_low ? value : value >> (WORD_BIT_LEN - bit_len));
+        v &= mask;
+        if(erase)
+            w &= ~(mask << mo);
+        m[0] = bitter_conv(w | (v << mo), order);
+        if(crosses) {
+            w = bitter_conv(m[1], order);
+            if(erase)
+                w &= ~(mask >> (WORD_BIT_LEN - mo));
+            m[1] = bitter_conv(w | (v >> (WORD_BIT_LEN - mo)), order);
+        }
+    }
+    else {
+        mask <<= WORD_BIT_LEN - bit_len;
+        WORD_T v = (start_low ? value << (WORD_BIT_LEN - bit_len) :
+                    value & mask);
+        if(erase)
+            w &= ~(mask >> mo);
+        m[0] = bitter_conv(w | (v >> mo), order);
+        if(crosses) {
+            w = bitter_conv(m[1], order);
+            if(erase)
+                w &= ~(mask << (WORD_BIT_LEN - mo));
+            m[1] = bitter_conv(w | (v << (WORD_BIT_LEN - mo)), order);
+        }
+    }
+    return start_bit + bit_len;
+}
+
+
+BITTER_INLINE int bitter_get_bits(const WORD_T message[], int message_len,
+                                  int start_bit, int bit_len, WORD_T* value,
+                                  bool start_low, int order) {
+    int rtc = bitter_check(message_len, start_bit, bit_len);
+    if(rtc < 0)
+        return rtc;
+
+    WORD_T v = 0;
+    if(bit_len > 0) {
+        const WORD_T* m = &message[start_bit / WORD_BIT_LEN];
+        int mo = start_bit % WORD_BIT_LEN;
+        bool crosses = mo + bit_len > WORD_BIT_LEN;
+
+        if(order == BITTER_LE) {
+            v = bitter_conv(m[0], order) >> mo;
+            if(crosses)
+                v |= bitter_conv(m[1], order) << (WORD_BIT_LEN - mo);
+            v &= bitter_mask_low(bit_len);
+            if(!start_low)
+                v <<= WORD_BIT_LEN - bit_len;
+        }
+        else {
+            v = bitter_conv(m[0], order) << mo;
+            if(crosses)
+                v |= bitter_conv(m[1], order) >> (WORD_BIT_LEN - mo);
+            v &= ~bitter_mask_low(WORD_BIT_LEN - bit_len);
+            if(start_low)
+                v >>= WORD_BIT_LEN - bit_len;
+        }
+    }
+
+    if(value != NULL)
+        *value = v;
+    return start_bit + bit_len;
+}
+
+
+// Inline variant of set_message_bits.
+BITTER_INLINE int set_message_bits_inline(WORD_T message[], int message_len,
+        int start_bit, int bit_len, const WORD_T value,
+        bool erase, bool start_low) {
+    return bitter_set_bits(message, message_len, start_bit, bit_len, value,
+                           erase, start_low, BITTER_NETWORK);
+}
+
+// Inline variant of get_message_bits.
+BITTER_INLINE int get_message_bits_inline(const WORD_T message[],
+        int message_len, int start_bit, int bit_len, WORD_T* value,
+        bool start_low) {
+    return bitter_get_bits(message, message_len, start_bit, bit_len, value,
+                           start_low, BITTER_NETWORK);
+}
+
+// Inline variant of set_message_bits_h.
+BITTER_INLINE int set_message_bits_h_inline(WORD_T message[], int message_len,
+        int start_bit, int bit_len, const WORD_T value,
+        bool erase, bool start_low) {
+    return bitter_set_bits(message, message_len, start_bit, bit_len, value,
+                           erase, start_low, BITTER_HOST);
+}
+
+// Inline variant of get_message_bits_h.
+BITTER_INLINE int get_message_bits_h_inline(const WORD_T message[],
+        int message_len, int start_bit, int bit_len, WORD_T* value,
+        bool start_low) {
+    return bitter_get_bits(message, message_len, start_bit, bit_len, value,
+                           start_low, BITTER_HOST);
+}
+
+// Inline variant of set_message_bits_le.
+BITTER_INLINE int set_message_bits_le_inline(WORD_T message[],
+        int message_len, int start_bit, int bit_len, const WORD_T value,
+        bool erase, bool start_low) {
+    return bitter_set_bits(message, message_len, start_bit, bit_len, value,
+                           erase, start_low, BITTER_LE);
+}
+
+// Inline variant of get_message_bits_le.
+BITTER_INLINE int get_message_bits_le_inline(const WORD_T message[],
+        int message_len, int start_bit, int bit_len, WORD_T* value,
+        bool start_low) {
+    return bitter_get_bits(message, message_len, start_bit, bit_len, value,
+                           start_low, BITTER_LE);
+}
+
+#endif
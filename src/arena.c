@@ -0,0 +1,423 @@
+/// @file arena.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "bitter.h"
+
+
+// Messages are aligned to cache lines, so messages used by different
+// threads never share a cache line.
+#define CACHE_LINE      64
+
+// Memory is mapped in chunks of one huge page (x86-64, aarch64 with 4K
+// pages). Chunks are aligned to their size, so the chunk of a message is
+// found by masking its address.
+#define CHUNK_SIZE      ((size_t)2 << 20)
+
+// Size classes of 64 bytes (8 words) to 256 KiB, larger messages get their
+// own chunk.
+#define CLASS_CNT       13
+#define CLASS_LARGE     -1
+
+// Messages per size class kept in the cache of a thread.
+#define CACHE_BLOCKS    16
+
+
+/*
+ * A chunk starts with its header, the remaining cache lines are carved into
+ * messages of one size class. Free messages of a class are linked through
+ * their first word into a list of the arena. Each thread keeps a small
+ * cache of free messages per class, so most allocations and releases need
+ * no lock. Resetting an arena drops all lists and caches and carves the
+ * chunks again from the start.
+ */
+typedef struct arena_chunk {
+    struct arena_chunk* next;
+    size_t map_len;
+    size_t used;                    // Bytes carved including header.
+    int cls;                        // Size class or CLASS_LARGE.
+} arena_chunk_t;
+
+struct bitter_arena {
+    uint64_t id;                    // Unique id, never reused.
+    int flags;
+    _Atomic uint64_t generation;    // Incremented by bitter_arena_reset.
+    pthread_mutex_t lock;
+    arena_chunk_t* chunks;          // Chunks of size classes.
+    arena_chunk_t* spare;           // Empty chunks after a reset.
+    arena_chunk_t* large;           // Chunks of single large messages.
+    arena_chunk_t* current[CLASS_CNT];
+    void* free_list[CLASS_CNT];
+    struct bitter_arena* next;      // List of all arenas.
+};
+
+// Free messages of one arena cached by a thread.
+typedef struct {
+    uint64_t id;                    // Id of arena, 0 if none.
+    uint64_t generation;
+    int cnt[CLASS_CNT];
+    void* blocks[CLASS_CNT][CACHE_BLOCKS];
+} arena_cache_t;
+
+// Arenas not yet destroyed, to check if a cache still belongs to one.
+static pthread_mutex_t arenas_lock = PTHREAD_MUTEX_INITIALIZER;
+static bitter_arena_t* arenas;
+static uint64_t next_id = 1;
+
+static __thread arena_cache_t* thread_cache;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+
+static size_t class_size(int cls) {
+    return (size_t)CACHE_LINE << cls;
+}
+
+// Smallest size class holding bytes or CLASS_LARGE.
+static int class_of(size_t bytes) {
+    for(int cls=0; cls<CLASS_CNT; cls++)
+        if(bytes <= class_size(cls))
+            return cls;
+    return CLASS_LARGE;
+}
+
+static arena_chunk_t* chunk_of(const void* message) {
+    return (arena_chunk_t*)((uintptr_t)message & ~(CHUNK_SIZE - 1));
+}
+
+
+/*
+ * Maps len bytes (a multiple of CHUNK_SIZE) aligned to CHUNK_SIZE. Huge
+ * pages are taken from the reserved pool if available, otherwise
+ * transparent huge pages are requested.
+ */
+static void* map_chunk(size_t len, bool huge) {
+    void* p;
+#ifdef MAP_HUGETLB
+    if(huge) {
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(p != MAP_FAILED)
+            return p;
+    }
+#endif
+
+    // Map one chunk more and unmap the unaligned parts.
+    p = mmap(NULL, len + CHUNK_SIZE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED)
+        return NULL;
+    uintptr_t start = ((uintptr_t)p + CHUNK_SIZE - 1) & ~(CHUNK_SIZE - 1);
+    if(start > (uintptr_t)p)
+        munmap(p, start - (uintptr_t)p);
+    uintptr_t end = (uintptr_t)p + len + CHUNK_SIZE;
+    if(end > start + len)
+        munmap((void*)(start + len), end - (start + len));
+#ifdef MADV_HUGEPAGE
+    if(huge)
+        madvise((void*)start, len, MADV_HUGEPAGE);
+#endif
+    return (void*)start;
+}
+
+static arena_chunk_t* new_chunk(bitter_arena_t* arena, size_t len, int cls) {
+    arena_chunk_t* chunk = map_chunk(len, arena->flags & BITTER_ARENA_HUGE);
+    if(chunk == NULL)
+        return NULL;
+    chunk->map_len = len;
+    chunk->used = CACHE_LINE;
+    chunk->cls = cls;
+    return chunk;
+}
+
+
+// Takes a free message of class cls, arena must be locked.
+static void* take_block(bitter_arena_t* arena, int cls) {
+    void* block = arena->free_list[cls];
+    if(block != NULL) {
+        arena->free_list[cls] = *(void**)block;
+        return block;
+    }
+
+    size_t size = class_size(cls);
+    arena_chunk_t* chunk = arena->current[cls];
+    if(chunk == NULL || chunk->used + size > chunk->map_len) {
+        if(arena->spare != NULL) {
+            chunk = arena->spare;
+            arena->spare = chunk->next;
+            chunk->used = CACHE_LINE;
+            chunk->cls = cls;
+        }
+        else if((chunk = new_chunk(arena, CHUNK_SIZE, cls)) == NULL)
+            return NULL;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->current[cls] = chunk;
+    }
+    block = (uint8_t*)chunk + chunk->used;
+    chunk->used += size;
+    return block;
+}
+
+// Returns a free message of class cls, arena must be locked.
+static void put_block(bitter_arena_t* arena, int cls, void* block) {
+    *(void**)block = arena->free_list[cls];
+    arena->free_list[cls] = block;
+}
+
+
+// Returns all messages of a cache to its arena if the arena still exists.
+static void flush_cache(arena_cache_t* cache) {
+    pthread_mutex_lock(&arenas_lock);
+    bitter_arena_t* arena = arenas;
+    while(arena != NULL && arena->id != cache->id)
+        arena = arena->next;
+    if(arena != NULL && atomic_load(&arena->generation) == cache->generation) {
+        pthread_mutex_lock(&arena->lock);
+        for(int cls=0; cls<CLASS_CNT; cls++)
+            for(int i=0; i<cache->cnt[cls]; i++)
+                put_block(arena, cls, cache->blocks[cls][i]);
+        pthread_mutex_unlock(&arena->lock);
+    }
+    pthread_mutex_unlock(&arenas_lock);
+    memset(cache->cnt, 0, sizeof(cache->cnt));
+    cache->id = 0;
+}
+
+static void release_cache(void* cache) {
+    flush_cache(cache);
+    free(cache);
+}
+
+static void create_cache_key(void) {
+    pthread_key_create(&cache_key, release_cache);
+}
+
+/*
+ * Returns the cache of the calling thread for arena. A thread caches
+ * messages of the arena used last only, messages cached for another arena
+ * are returned to it first. Messages cached before the arena was reset are
+ * dropped, they are free again anyway.
+ */
+static arena_cache_t* get_cache(bitter_arena_t* arena) {
+    arena_cache_t* cache = thread_cache;
+    if(cache == NULL) {
+        pthread_once(&cache_key_once, create_cache_key);
+        if((cache = calloc(1, sizeof(arena_cache_t))) == NULL)
+            return NULL;
+        pthread_setspecific(cache_key, cache);
+        thread_cache = cache;
+    }
+
+    uint64_t generation = atomic_load_explicit(&arena->generation,
+                                               memory_order_relaxed);
+    if(cache->id != arena->id) {
+        if(cache->id != 0)
+            flush_cache(cache);
+        cache->id = arena->id;
+        cache->generation = generation;
+    }
+    else if(cache->generation != generation) {
+        memset(cache->cnt, 0, sizeof(cache->cnt));
+        cache->generation = generation;
+    }
+    return cache;
+}
+
+
+/**
+ * bitter_arena_create - creates an arena handing out cache line aligned
+ * messages from size classed free lists.
+ * @param[in] flags         BITTER_ARENA_HUGE to back messages by huge pages,
+ *                          BITTER_ARENA_ZERO to zero messages when released
+ *                          so all allocated messages are zeroed
+ * @returns                 Arena or NULL in case of error
+ */
+bitter_arena_t* bitter_arena_create(int flags) {
+    bitter_arena_t* arena = calloc(1, sizeof(bitter_arena_t));
+    if(arena == NULL)
+        return NULL;
+    arena->flags = flags;
+    atomic_init(&arena->generation, 0);
+    pthread_mutex_init(&arena->lock, NULL);
+
+    pthread_mutex_lock(&arenas_lock);
+    arena->id = next_id++;
+    arena->next = arenas;
+    arenas = arena;
+    pthread_mutex_unlock(&arenas_lock);
+    return arena;
+}
+
+
+static void unmap_chunks(arena_chunk_t* chunk) {
+    while(chunk != NULL) {
+        arena_chunk_t* next = chunk->next;
+        munmap(chunk, chunk->map_len);
+        chunk = next;
+    }
+}
+
+
+/**
+ * bitter_arena_destroy - releases an arena and all its messages. The arena
+ * must not be used by other threads anymore.
+ * @param[in] arena         Arena created by bitter_arena_create, may be NULL
+ */
+void bitter_arena_destroy(bitter_arena_t* arena) {
+    if(arena == NULL)
+        return;
+
+    pthread_mutex_lock(&arenas_lock);
+    bitter_arena_t** p = &arenas;
+    while(*p != arena)
+        p = &(*p)->next;
+    *p = arena->next;
+    pthread_mutex_unlock(&arenas_lock);
+
+    if(thread_cache != NULL && thread_cache->id == arena->id) {
+        memset(thread_cache->cnt, 0, sizeof(thread_cache->cnt));
+        thread_cache->id = 0;
+    }
+
+    unmap_chunks(arena->chunks);
+    unmap_chunks(arena->spare);
+    unmap_chunks(arena->large);
+    pthread_mutex_destroy(&arena->lock);
+    free(arena);
+}
+
+
+/**
+ * bitter_arena_alloc - allocates a message from an arena.
+ * @param[in] arena         Arena created by bitter_arena_create
+ * @param[in] message_len   Number of words of message
+ * @returns                 Cache line aligned message or NULL in case of
+ *                          error. Zeroed if the arena was created with
+ *                          BITTER_ARENA_ZERO.
+ */
+WORD_T* bitter_arena_alloc(bitter_arena_t* arena, int64_t message_len) {
+    if(arena == NULL || message_len <= 0)
+        return NULL;
+
+    size_t bytes = (size_t)message_len * WORD_BYTE_LEN;
+    int cls = class_of(bytes);
+    void* block = NULL;
+
+    if(cls == CLASS_LARGE) {
+        size_t len = (CACHE_LINE + bytes + CHUNK_SIZE - 1) &
+                     ~(CHUNK_SIZE - 1);
+        arena_chunk_t* chunk = new_chunk(arena, len, CLASS_LARGE);
+        if(chunk == NULL)
+            return NULL;
+        pthread_mutex_lock(&arena->lock);
+        chunk->next = arena->large;
+        arena->large = chunk;
+        pthread_mutex_unlock(&arena->lock);
+        return (WORD_T*)((uint8_t*)chunk + CACHE_LINE);
+    }
+
+    arena_cache_t* cache = get_cache(arena);
+    if(cache != NULL && cache->cnt[cls] > 0)
+        block = cache->blocks[cls][--cache->cnt[cls]];
+    else {
+        // Refill half of the cache at once.
+        pthread_mutex_lock(&arena->lock);
+        block = take_block(arena, cls);
+        if(cache != NULL) {
+            while(block != NULL && cache->cnt[cls] < CACHE_BLOCKS / 2) {
+                void* b = take_block(arena, cls);
+                if(b == NULL)
+                    break;
+                cache->blocks[cls][cache->cnt[cls]++] = b;
+            }
+        }
+        pthread_mutex_unlock(&arena->lock);
+        if(block == NULL)
+            return NULL;
+    }
+
+    // The first word links free messages.
+    *(void**)block = NULL;
+    return (WORD_T*)block;
+}
+
+
+/**
+ * bitter_arena_free - returns a message to its arena.
+ * @param[in] arena         Arena the message was allocated from
+ * @param[in] message       Message returned by bitter_arena_alloc, may be NULL
+ */
+void bitter_arena_free(bitter_arena_t* arena, WORD_T* message) {
+    if(arena == NULL || message == NULL)
+        return;
+
+    arena_chunk_t* chunk = chunk_of(message);
+    int cls = chunk->cls;
+
+    if(cls == CLASS_LARGE) {
+        pthread_mutex_lock(&arena->lock);
+        arena_chunk_t** p = &arena->large;
+        while(*p != NULL && *p != chunk)
+            p = &(*p)->next;
+        if(*p != NULL)
+            *p = chunk->next;
+        pthread_mutex_unlock(&arena->lock);
+        munmap(chunk, chunk->map_len);
+        return;
+    }
+
+    if(arena->flags & BITTER_ARENA_ZERO)
+        memset(message, 0, class_size(cls));
+
+    arena_cache_t* cache = get_cache(arena);
+    if(cache != NULL && cache->cnt[cls] < CACHE_BLOCKS) {
+        cache->blocks[cls][cache->cnt[cls]++] = message;
+        return;
+    }
+
+    // Cache full, return half of it to the arena.
+    pthread_mutex_lock(&arena->lock);
+    put_block(arena, cls, message);
+    if(cache != NULL) {
+        while(cache->cnt[cls] > CACHE_BLOCKS / 2)
+            put_block(arena, cls, cache->blocks[cls][--cache->cnt[cls]]);
+    }
+    pthread_mutex_unlock(&arena->lock);
+}
+
+
+/**
+ * bitter_arena_reset - releases all messages of an arena at once. Memory of
+ * small messages is kept for reuse, large messages are unmapped. The arena
+ * must not be used by other threads while it is reset.
+ * @param[in] arena         Arena created by bitter_arena_create
+ */
+void bitter_arena_reset(bitter_arena_t* arena) {
+    if(arena == NULL)
+        return;
+
+    pthread_mutex_lock(&arena->lock);
+    atomic_fetch_add(&arena->generation, 1);
+    for(arena_chunk_t* chunk = arena->chunks; chunk != NULL; ) {
+        arena_chunk_t* next = chunk->next;
+        if(arena->flags & BITTER_ARENA_ZERO)
+            memset((uint8_t*)chunk + CACHE_LINE, 0, chunk->used - CACHE_LINE);
+        chunk->next = arena->spare;
+        arena->spare = chunk;
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    unmap_chunks(arena->large);
+    arena->large = NULL;
+    memset(arena->current, 0, sizeof(arena->current));
+    memset(arena->free_list, 0, sizeof(arena->free_list));
+    pthread_mutex_unlock(&arena->lock);
+}
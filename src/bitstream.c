@@ -0,0 +1,567 @@
+/// @file bitstream.c
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bitter.h"
+#include "trace.h"
+
+
+/*
+ * A bitstream is a message of up to 2^63 bits whose words are memory
+ * mapped from a file (or anonymous memory). Bit 0 is the MSB of the first
+ * byte of the file, so a stream file is a message in network-byte-order.
+ * Only the pages of the file which are accessed are loaded by the kernel.
+ * The mapping is rounded up to whole pages, so the last partial word of a
+ * stream can always be accessed.
+ */
+
+static size_t page_size(void) {
+    static size_t size = 0;
+    if(size == 0)
+        size = sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+// Number of bytes to map for a stream of bit_len bits, at least one page.
+static size_t map_size(int64_t bit_len) {
+    size_t bytes = (bit_len + 7) / 8;
+    size_t page = page_size();
+    if(bytes == 0)
+        bytes = 1;
+    return (bytes + page - 1) / page * page;
+}
+
+static void bitstream_reset(bitstream_t* bs) {
+    memset(bs, 0, sizeof(*bs));
+    bs->fd = -1;
+}
+
+static int bitstream_map(bitstream_t* bs, int64_t bit_len) {
+    int prot = PROT_READ | (bs->writable ? PROT_WRITE : 0);
+    int flags = (bs->fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED);
+
+    size_t len = map_size(bit_len);
+    void* p = mmap(NULL, len, prot, flags, bs->fd, 0);
+    if(p == MAP_FAILED)
+        return -5;
+
+    // Streams are usually processed front to back.
+    madvise(p, len, MADV_SEQUENTIAL);
+
+    bs->words = (WORD_T*)p;
+    bs->map_len = len;
+    bs->bit_len = bit_len;
+    bs->word_len = (bit_len + WORD_BIT_LEN - 1) / WORD_BIT_LEN;
+    return 0;
+}
+
+
+/**
+ * bitstream_open - maps an existing file as bitstream. The stream has
+ * 8 bits per byte of the file.
+ * @param[out] bs           Bitstream to initialize
+ * @param[in] path          File to map
+ * @param[in] writable      If true, changes are written to the file
+ * @returns                 0 on success, negative value in case of error
+ *                          (errno is set)
+ */
+int bitstream_open(bitstream_t* bs, const char* path, bool writable) {
+    bitstream_reset(bs);
+    if(path == NULL)
+        return -1;
+
+    bs->fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if(bs->fd < 0)
+        return -6;
+
+    struct stat st;
+    if(fstat(bs->fd, &st) != 0) {
+        bitstream_close(bs);
+        return -6;
+    }
+
+    bs->writable = writable;
+    int rtc = bitstream_map(bs, (int64_t)st.st_size * 8);
+    if(rtc < 0)
+        bitstream_close(bs);
+    return rtc;
+}
+
+
+/**
+ * bitstream_create - creates a writable bitstream of bit_len bits set to 0.
+ * An existing file is truncated.
+ * @param[out] bs           Bitstream to initialize
+ * @param[in] path          File to create, NULL to use anonymous memory
+ * @param[in] bit_len       Number of bits of stream
+ * @returns                 0 on success, negative value in case of error
+ *                          (errno is set)
+ */
+int bitstream_create(bitstream_t* bs, const char* path, int64_t bit_len) {
+    bitstream_reset(bs);
+    if(bit_len < 0)
+        return -2;
+
+    if(path != NULL) {
+        bs->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(bs->fd < 0)
+            return -6;
+        if(ftruncate(bs->fd, (bit_len + 7) / 8) != 0) {
+            bitstream_close(bs);
+            return -6;
+        }
+    }
+
+    bs->writable = true;
+    int rtc = bitstream_map(bs, bit_len);
+    if(rtc < 0)
+        bitstream_close(bs);
+    return rtc;
+}
+
+
+/**
+ * bitstream_resize - changes the length of a writable bitstream and its
+ * file. Added bits are set to 0. The stream words may move in memory.
+ * @param[in] bs            Writable bitstream
+ * @param[in] bit_len       New number of bits of stream
+ * @returns                 0 on success, negative value in case of error
+ */
+int bitstream_resize(bitstream_t* bs, int64_t bit_len) {
+    if(bs->words == NULL || !bs->writable)
+        return -4;
+    if(bit_len < 0)
+        return -2;
+
+    // Bits of the last byte behind the end of a shrunk stream are cleared,
+    // so they read as 0 when the stream grows again.
+    if(bit_len < bs->bit_len && bit_len % 8 != 0) {
+        uint8_t* last = (uint8_t*)bs->words + bit_len / 8;
+        *last &= (uint8_t)(0xff << (8 - bit_len % 8));
+    }
+
+    if(bs->fd >= 0 && ftruncate(bs->fd, (bit_len + 7) / 8) != 0)
+        return -6;
+
+    size_t len = map_size(bit_len);
+    if(len != bs->map_len) {
+        void* p = mremap(bs->words, bs->map_len, len, MREMAP_MAYMOVE);
+        if(p == MAP_FAILED)
+            return -5;
+        bs->words = (WORD_T*)p;
+        bs->map_len = len;
+    }
+
+    // Anonymous memory of a stream shrunk before still holds the old bytes,
+    // files were already cleared by ftruncate.
+    if(bit_len > bs->bit_len) {
+        size_t old_bytes = (bs->bit_len + 7) / 8;
+        size_t new_bytes = (bit_len + 7) / 8;
+        if(bs->fd < 0 && new_bytes > old_bytes)
+            memset((uint8_t*)bs->words + old_bytes, 0, new_bytes - old_bytes);
+    }
+
+    bs->bit_len = bit_len;
+    bs->word_len = (bit_len + WORD_BIT_LEN - 1) / WORD_BIT_LEN;
+    return 0;
+}
+
+
+/**
+ * bitstream_sync - writes changed pages of a file backed bitstream to disk.
+ * @param[in] bs            Bitstream
+ * @returns                 0 on success, negative value in case of error
+ */
+int bitstream_sync(bitstream_t* bs) {
+    if(bs->words == NULL)
+        return -1;
+    if(bs->fd < 0 || !bs->writable)
+        return 0;
+    return (msync(bs->words, bs->map_len, MS_SYNC) == 0 ? 0 : -6);
+}
+
+
+/**
+ * bitstream_advise - tells the kernel how a range of the stream will be
+ * accessed, e.g. to prefetch the next range while processing the current
+ * one (BITSTREAM_WILLNEED) or to release a processed range from the page
+ * cache (BITSTREAM_DONTNEED).
+ * @param[in] bs            Bitstream
+ * @param[in] start_bit     First bit of range
+ * @param[in] bit_len       Number of bits in range
+ * @param[in] advice        BITSTREAM_SEQUENTIAL, BITSTREAM_RANDOM,
+ *                          BITSTREAM_WILLNEED or BITSTREAM_DONTNEED
+ * @returns                 0 on success, negative value in case of error
+ */
+int bitstream_advise(bitstream_t* bs, int64_t start_bit, int64_t bit_len,
+                     int advice) {
+    if(bs->words == NULL || start_bit < 0 || bit_len < 0 ||
+       start_bit + bit_len > bs->bit_len)
+        return -1;
+
+    int madv;
+    switch(advice) {
+        case BITSTREAM_SEQUENTIAL: madv = MADV_SEQUENTIAL; break;
+        case BITSTREAM_RANDOM:     madv = MADV_RANDOM; break;
+        case BITSTREAM_WILLNEED:   madv = MADV_WILLNEED; break;
+        case BITSTREAM_DONTNEED:   madv = MADV_DONTNEED; break;
+        default:
+            return -2;
+    }
+
+    // Range is extended to whole pages.
+    size_t page = page_size();
+    size_t start = (size_t)(start_bit / 8) / page * page;
+    size_t end = (size_t)((start_bit + bit_len + 7) / 8);
+    end = (end + page - 1) / page * page;
+    if(end > bs->map_len)
+        end = bs->map_len;
+    if(end <= start)
+        return 0;
+
+    // Anonymous memory would be discarded by MADV_DONTNEED.
+    if(madv == MADV_DONTNEED && bs->fd < 0)
+        return 0;
+    return (madvise((uint8_t*)bs->words + start, end - start, madv) == 0 ?
+            0 : -6);
+}
+
+
+/**
+ * bitstream_close - unmaps a bitstream and closes its file.
+ * @param[in] bs            Bitstream
+ */
+void bitstream_close(bitstream_t* bs) {
+    if(bs->words != NULL)
+        munmap(bs->words, bs->map_len);
+    if(bs->fd >= 0)
+        close(bs->fd);
+    bitstream_reset(bs);
+}
+
+
+// Checks a field against the stream length, returning the error codes of
+// the message functions.
+static int64_t stream_field_error(const bitstream_t* bs, int64_t start_bit,
+                                  int64_t bit_len, int64_t max_len) {
+    if(start_bit < 0 || start_bit >= bs->bit_len)
+        return -1;
+    if(bit_len < 0 || bit_len > max_len)
+        return -2;
+    if(start_bit + bit_len > bs->bit_len)
+        return -3;
+    return 0;
+}
+
+
+// bitstream_set_bits without tracing.
+static int64_t do_bitstream_set_bits(bitstream_t* bs, int64_t start_bit,
+                                     int bit_len, const WORD_T value,
+                                     bool erase, bool start_low) {
+    int64_t rtc = stream_field_error(bs, start_bit, bit_len, WORD_BIT_LEN);
+    if(rtc < 0)
+        return rtc;
+    if(!bs->writable)
+        return -4;
+    return do_set_message_bits_l(bs->words, bs->word_len, start_bit, bit_len,
+                                 value, erase, start_low);
+}
+
+
+/**
+ * bitstream_set_bits - same as set_message_bits_l on a bitstream. Bits after
+ * the end of the stream can not be set.
+ * @param[in] bs            Writable bitstream
+ * @param[in] start_bit     Absolute bit position where value should be inserted
+ * @param[in] bit_len       Number of bits (1-n) of value to insert
+ * @param[in] value         A single word value to insert bits from into stream
+ *                          starting at MSB of value
+ * @param[in] erase         if true, set range in stream to 0 before inserting
+ *                          value
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in stream where
+ *                          inserted value ends, negative value in case of error
+ */
+int64_t bitstream_set_bits(bitstream_t* bs, int64_t start_bit, int bit_len,
+                           const WORD_T value, bool erase, bool start_low) {
+    int64_t rtc = do_bitstream_set_bits(bs, start_bit, bit_len, value, erase,
+                                        start_low);
+    TRACE(BITTER_TRACE_BITSTREAM_SET_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// bitstream_get_bits without tracing.
+static int64_t do_bitstream_get_bits(const bitstream_t* bs, int64_t start_bit,
+                                     int bit_len, WORD_T* value,
+                                     bool start_low) {
+    int64_t rtc = stream_field_error(bs, start_bit, bit_len, WORD_BIT_LEN);
+    if(rtc < 0)
+        return rtc;
+    return do_get_message_bits_l(bs->words, bs->word_len, start_bit, bit_len,
+                                 value, start_low);
+}
+
+
+/**
+ * bitstream_get_bits - same as get_message_bits_l on a bitstream.
+ * @param[in] bs            Bitstream
+ * @param[in] start_bit     Absolute bit position where value should be extracted
+ * @param[in] bit_len       Number of bits (1-n) of value to extract
+ * @param[out] value        word pointer to receive extracted value starting at MSB
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in stream where
+ *                          read value ends, negative value in case of error
+ */
+int64_t bitstream_get_bits(const bitstream_t* bs, int64_t start_bit,
+                           int bit_len, WORD_T* value, bool start_low) {
+    int64_t rtc = do_bitstream_get_bits(bs, start_bit, bit_len, value,
+                                        start_low);
+    TRACE(BITTER_TRACE_BITSTREAM_GET_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// bitstream_set_bits3 without tracing.
+static int64_t do_bitstream_set_bits3(bitstream_t* bs, int64_t start_bit,
+                                      int64_t bit_len, const uint8_t value[],
+                                      int64_t value_len, bool erase) {
+    if(bit_len > value_len * 8)
+        return -1;
+    int64_t rtc = stream_field_error(bs, start_bit, bit_len, INT64_MAX);
+    if(rtc < 0)
+        return rtc * 10;
+    if(!bs->writable)
+        return -40;
+    return do_set_message_bits3_l(bs->words, bs->word_len, start_bit, bit_len,
+                                  value, value_len, erase);
+}
+
+
+/**
+ * bitstream_set_bits3 - same as set_message_bits3_l on a bitstream.
+ * @param[in] bs            Writable bitstream
+ * @param[in] start_bit     Absolute bit position where value should be inserted
+ * @param[in] bit_len       Number of bits of value to insert
+ * @param[in] value         An array of uint8_t values to insert. Consecutive
+ *                          bytes in network byte order.
+ * @param[in] value_len     Number of uint8_t bytes in value array
+ * @param[in] erase         if true, set range in stream to 0 before inserting
+ *                          value
+ * @returns                 Positive integer of bit position in stream where
+ *                          inserted value ends, negative value in case of error
+ */
+int64_t bitstream_set_bits3(bitstream_t* bs, int64_t start_bit,
+                            int64_t bit_len, const uint8_t value[],
+                            int64_t value_len, bool erase) {
+    int64_t rtc = do_bitstream_set_bits3(bs, start_bit, bit_len, value,
+                                         value_len, erase);
+    TRACE(BITTER_TRACE_BITSTREAM_SET_BITS3, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// bitstream_get_bits3 without tracing.
+static int64_t do_bitstream_get_bits3(const bitstream_t* bs, int64_t start_bit,
+                                      int64_t bit_len, uint8_t value[],
+                                      int64_t value_len) {
+    if(bit_len > value_len * 8)
+        return -1;
+    if(value == NULL)
+        return -2;
+    int64_t rtc = stream_field_error(bs, start_bit, bit_len, INT64_MAX);
+    if(rtc < 0)
+        return rtc * 10;
+    return do_get_message_bits3_l(bs->words, bs->word_len, start_bit, bit_len,
+                                  value, value_len);
+}
+
+
+/**
+ * bitstream_get_bits3 - same as get_message_bits3_l on a bitstream.
+ * @param[in] bs            Bitstream
+ * @param[in] start_bit     Absolute bit position where value should be extracted
+ * @param[in] bit_len       Number of bits of value to extract
+ * @param[out] value        uint8_t pointer to receive extracted values
+ * @param[in] value_len     Number of uint8_t bytes in value array
+ * @returns                 Positive integer of bit position in stream where
+ *                          read value ends, negative value in case of error
+ */
+int64_t bitstream_get_bits3(const bitstream_t* bs, int64_t start_bit,
+                            int64_t bit_len, uint8_t value[],
+                            int64_t value_len) {
+    int64_t rtc = do_bitstream_get_bits3(bs, start_bit, bit_len, value,
+                                         value_len);
+    TRACE(BITTER_TRACE_BITSTREAM_GET_BITS3, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// bitstream_insert_bits without tracing.
+static int64_t do_bitstream_insert_bits(bitstream_t* bs, int64_t start_bit,
+                                        int64_t bit_len) {
+    if(bs->words == NULL || start_bit < 0 || start_bit > bs->bit_len)
+        return -1;
+    if(bit_len < 0 || bit_len > INT64_MAX - bs->bit_len)
+        return -2;
+    if(!bs->writable)
+        return -4;
+
+    int64_t tail = bs->bit_len - start_bit;
+    int rtc = bitstream_resize(bs, bs->bit_len + bit_len);
+    if(rtc < 0)
+        return rtc;
+
+    // Only bits of the stream are moved, added bits are already 0.
+    if(tail > 0 && bit_len > 0) {
+        do_copy_message_bits_l(bs->words, bs->word_len, start_bit + bit_len,
+                               bs->words, bs->word_len, start_bit, tail);
+        do_fill_message_bits_l(bs->words, bs->word_len, start_bit,
+                               bit_len, 0, 1);
+    }
+    return start_bit + bit_len;
+}
+
+
+/**
+ * bitstream_insert_bits - inserts a range of 0 bits into a writable
+ * bitstream. The stream grows by bit_len bits, the bits from start_bit on
+ * are shifted behind the inserted ones (see insert_message_bits). The
+ * stream words may move in memory.
+ * @param[in] bs            Writable bitstream
+ * @param[in] start_bit     Absolute bit position where bits are inserted, may
+ *                          be the length of the stream to append bits
+ * @param[in] bit_len       Number of bits to insert
+ * @returns                 Positive integer of bit position in stream
+ *                          following the inserted bits, negative value in
+ *                          case of error (see bitstream_resize)
+ */
+int64_t bitstream_insert_bits(bitstream_t* bs, int64_t start_bit,
+                              int64_t bit_len) {
+    int64_t rtc = do_bitstream_insert_bits(bs, start_bit, bit_len);
+    TRACE(BITTER_TRACE_BITSTREAM_INSERT_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// bitstream_delete_bits without tracing.
+static int64_t do_bitstream_delete_bits(bitstream_t* bs, int64_t start_bit,
+                                        int64_t bit_len) {
+    // Like insert, start_bit may be the stream length (deleting nothing).
+    if(bs->words == NULL || start_bit < 0 || start_bit > bs->bit_len)
+        return -1;
+    if(bit_len < 0)
+        return -2;
+    if(bit_len > bs->bit_len - start_bit)
+        return -3;
+    if(!bs->writable)
+        return -4;
+
+    int64_t tail = bs->bit_len - start_bit - bit_len;
+    int64_t rtc;
+    if(tail > 0 && bit_len > 0)
+        do_copy_message_bits_l(bs->words, bs->word_len, start_bit, bs->words,
+                               bs->word_len, start_bit + bit_len, tail);
+    if((rtc = bitstream_resize(bs, bs->bit_len - bit_len)) < 0)
+        return rtc;
+    return start_bit;
+}
+
+
+/**
+ * bitstream_delete_bits - removes a bit range from a writable bitstream.
+ * The bits after the range are shifted to start_bit and the stream shrinks
+ * by bit_len bits.
+ * @param[in] bs            Writable bitstream
+ * @param[in] start_bit     Absolute bit position of the first bit to delete,
+ *                          may be the length of the stream if bit_len is 0
+ * @param[in] bit_len       Number of bits to delete
+ * @returns                 start_bit, negative value in case of error
+ */
+int64_t bitstream_delete_bits(bitstream_t* bs, int64_t start_bit,
+                              int64_t bit_len) {
+    int64_t rtc = do_bitstream_delete_bits(bs, start_bit, bit_len);
+    TRACE(BITTER_TRACE_BITSTREAM_DELETE_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// bitstream_find without tracing.
+static int64_t do_bitstream_find(const bitstream_t* bs, int64_t start_bit,
+                                 int64_t bit_len, WORD_T pattern,
+                                 int pattern_len, int max_errors) {
+    int64_t rtc = stream_field_error(bs, start_bit, bit_len, INT64_MAX);
+    if(rtc < 0)
+        return rtc;
+    return do_message_find_l(bs->words, bs->word_len, start_bit, bit_len,
+                             pattern, pattern_len, max_errors);
+}
+
+
+/**
+ * bitstream_find - same as message_find_l on a bitstream.
+ * @param[in] bs            Bitstream
+ * @param[in] start_bit     Absolute bit position where search starts
+ * @param[in] bit_len       Number of bits to search
+ * @param[in] pattern       Pattern to search (in the lower bits)
+ * @param[in] pattern_len   Number of bits (1-n) of pattern
+ * @param[in] max_errors    Number of bits which may differ from pattern
+ * @returns                 Bit position of the first match, -4 if not found,
+ *                          negative value in case of error
+ */
+int64_t bitstream_find(const bitstream_t* bs, int64_t start_bit,
+                       int64_t bit_len, WORD_T pattern, int pattern_len,
+                       int max_errors) {
+    int64_t rtc = do_bitstream_find(bs, start_bit, bit_len, pattern,
+                                    pattern_len, max_errors);
+    TRACE(BITTER_TRACE_BITSTREAM_FIND, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// bitstream_find_all without tracing.
+static int64_t do_bitstream_find_all(const bitstream_t* bs, int64_t start_bit,
+                                     int64_t bit_len, WORD_T pattern,
+                                     int pattern_len, int max_errors,
+                                     int64_t positions[],
+                                     int64_t max_positions) {
+    int64_t rtc = stream_field_error(bs, start_bit, bit_len, INT64_MAX);
+    if(rtc < 0)
+        return rtc;
+    return do_message_find_all(bs->words, bs->word_len, start_bit, bit_len,
+                               pattern, pattern_len, max_errors, positions,
+                               max_positions);
+}
+
+
+/**
+ * bitstream_find_all - same as message_find_all on a bitstream.
+ * @param[in] bs            Bitstream
+ * @param[in] start_bit     Absolute bit position where search starts
+ * @param[in] bit_len       Number of bits to search
+ * @param[in] pattern       Pattern to search (in the lower bits)
+ * @param[in] pattern_len   Number of bits (1-n) of pattern
+ * @param[in] max_errors    Number of bits which may differ from pattern
+ * @param[out] positions    Receives bit positions of matches, may be NULL
+ * @param[in] max_positions Size of positions
+ * @returns                 Number of matches, negative value in case of error
+ */
+int64_t bitstream_find_all(const bitstream_t* bs, int64_t start_bit,
+                           int64_t bit_len, WORD_T pattern, int pattern_len,
+                           int max_errors, int64_t positions[],
+                           int64_t max_positions) {
+    int64_t rtc = do_bitstream_find_all(bs, start_bit, bit_len, pattern,
+                                        pattern_len, max_errors, positions,
+                                        max_positions);
+    TRACE(BITTER_TRACE_BITSTREAM_FIND_ALL, start_bit, bit_len, rtc);
+    return rtc;
+}
@@ -0,0 +1,367 @@
+/// @file buffer.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+
+#include "bitter.h"
+#include "trace.h"
+
+
+/*
+ * Buffer functions access fields directly in byte buffers of any alignment
+ * and length, e.g. received packets. Bytes are loaded as big-endian 64 bit
+ * words using unaligned loads where at least 8 bytes are left in the buffer
+ * and byte by byte near the buffer end, so no byte after the buffer is ever
+ * read or written.
+ */
+
+// Mask with the <n> most significant bits of a 64 bit word set (1 <= n <= 64).
+#define MASK_HIGH64(n)  (~(uint64_t)0 << (64 - (n)))
+
+
+static inline uint64_t load_be64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return be64toh(v);
+}
+
+static inline void store_be64(uint8_t* p, uint64_t v) {
+    v = htobe64(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+// Loads n (at most 8) bytes, missing bytes are read as 0.
+static inline uint64_t load_be64_tail(const uint8_t* p, size_t n) {
+    if(n >= 8)
+        return load_be64(p);
+    uint64_t v = 0;
+    for(size_t i=0; i<n; i++)
+        v |= (uint64_t)p[i] << (56 - 8 * i);
+    return v;
+}
+
+// Stores the n (at most 8) most significant bytes of v.
+static inline void store_be64_tail(uint8_t* p, size_t n, uint64_t v) {
+    if(n >= 8) {
+        store_be64(p, v);
+        return;
+    }
+    for(size_t i=0; i<n; i++)
+        p[i] = (uint8_t)(v >> (56 - 8 * i));
+}
+
+
+// set_buffer_bits without tracing.
+static int do_set_buffer_bits(uint8_t buffer[], size_t buffer_len,
+                              int start_bit, int bit_len,
+                              const WORD_T value,
+                              bool erase, bool start_low) {
+
+    // Is start_bit outside buffer.
+    if(start_bit < 0 || (size_t)start_bit / 8 >= buffer_len)
+        return -1;
+    // If bit length > message word len.
+    if(bit_len > WORD_BIT_LEN || bit_len < 0)
+        return -2;
+    // If value spans over end of buffer.
+    if((uint64_t)start_bit + bit_len > (uint64_t)buffer_len * 8)
+        return -3;
+    if(bit_len == 0)
+        return start_bit;
+
+    uint8_t* p = &buffer[start_bit / 8];
+    int bo = start_bit % 8;                             // Bit offset in byte.
+    int nb = (bo + bit_len + 7) / 8;                    // Bytes of field.
+    size_t avail = buffer_len - start_bit / 8;
+    size_t n = (avail < 8 ? avail : 8);
+
+    // Align value to MSB with all unwanted bits set to 0.
+    uint64_t mask = MASK_HIGH64(bit_len);
+    uint64_t v;
+    if(start_low)
+        v = (uint64_t)value << (64 - bit_len);
+    else
+        v = ((uint64_t)value << (64 - WORD_BIT_LEN)) & mask;
+
+    uint64_t w = load_be64_tail(p, n);
+    if(erase)
+        w &= ~(mask >> bo);
+    w |= v >> bo;
+    store_be64_tail(p, n, w);
+
+    // A 64 bit field not starting at a byte boundary covers a 9th byte.
+    if(nb > 8) {
+        uint8_t b = p[8];
+        if(erase)
+            b &= ~(uint8_t)((mask << (64 - bo)) >> 56);
+        b |= (uint8_t)((v << (64 - bo)) >> 56);
+        p[8] = b;
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * set_buffer_bits sets 1-n bits (where n is the word len) at an arbitrary
+ * position in a byte buffer like set_message_bits does in a message. The
+ * buffer may have any alignment and length, bytes after the buffer end are
+ * never accessed.
+ * @param[in] buffer        Buffer of buffer_len bytes
+ * @param[in] buffer_len    Number of bytes in buffer
+ * @param[in] start_bit     Absolute bit position where bits from value should
+ *                          be inserted into buffer, bit 0 is the MSB of the
+ *                          first byte
+ * @param[in] bit_len       Number of bits (1-n) from value to insert at
+ *                          start_bit position
+ * @param[in] value         A single word value to insert bits from, starting
+ *                          at MSB of value
+ * @param[in] erase         if true, set range in buffer to 0 before inserting
+ *                          value, if false, value is just ORed without erasing
+ *                          before
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in buffer where
+ *                          inserted value ends, negative value in case of error
+ */
+int set_buffer_bits(uint8_t buffer[], size_t buffer_len,
+                    int start_bit, int bit_len,
+                    const WORD_T value,
+                    bool erase, bool start_low) {
+    int rtc = do_set_buffer_bits(buffer, buffer_len, start_bit, bit_len, value,
+                                 erase, start_low);
+    TRACE(BITTER_TRACE_SET_BUFFER_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// get_buffer_bits without tracing.
+static int do_get_buffer_bits(const uint8_t buffer[], size_t buffer_len,
+                              int start_bit, int bit_len, WORD_T* value,
+                              bool start_low) {
+
+    // Is start_bit outside buffer.
+    if(start_bit < 0 || (size_t)start_bit / 8 >= buffer_len)
+        return -1;
+    // If bit length > message word len.
+    if(bit_len > WORD_BIT_LEN || bit_len < 0)
+        return -2;
+    // If value spans over end of buffer.
+    if((uint64_t)start_bit + bit_len > (uint64_t)buffer_len * 8)
+        return -3;
+    if(bit_len == 0)
+        return start_bit;
+
+    const uint8_t* p = &buffer[start_bit / 8];
+    int bo = start_bit % 8;
+    int nb = (bo + bit_len + 7) / 8;
+    size_t avail = buffer_len - start_bit / 8;
+
+    uint64_t v = load_be64_tail(p, (avail < 8 ? avail : 8)) << bo;
+    if(nb > 8)
+        v |= p[8] >> (8 - bo);
+    v &= MASK_HIGH64(bit_len);
+
+    if(value != NULL)
+        *value = (WORD_T)(v >> (start_low ? 64 - bit_len : 64 - WORD_BIT_LEN));
+    return start_bit + bit_len;
+}
+
+
+/**
+ * get_buffer_bits extracts 1-n bits (where n is the word len) from an
+ * arbitrary position of a byte buffer like get_message_bits does from a
+ * message. The buffer may have any alignment and length, bytes after the
+ * buffer end are never accessed.
+ * @param[in] buffer        Buffer of buffer_len bytes
+ * @param[in] buffer_len    Number of bytes in buffer
+ * @param[in] start_bit     Absolute bit position where value should be extracted
+ * @param[in] bit_len       Number of bits (1-n) of value to extract from
+ *                          start_bit position
+ * @param[out] value        word pointer to receive extracted value starting
+ *                          at MSB
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in buffer where
+ *                          read value ends, negative value in case of error
+ */
+int get_buffer_bits(const uint8_t buffer[], size_t buffer_len,
+                    int start_bit, int bit_len, WORD_T* value,
+                    bool start_low) {
+    int rtc = do_get_buffer_bits(buffer, buffer_len, start_bit, bit_len, value,
+                                 start_low);
+    TRACE(BITTER_TRACE_GET_BUFFER_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// set_buffer_bits3 without tracing.
+static int do_set_buffer_bits3(uint8_t buffer[], size_t buffer_len,
+                               int start_bit, int bit_len,
+                               const uint8_t value[], int value_len,
+                               bool erase) {
+
+    // If bits to set in buffer > then bits available in value; exit
+    if(bit_len > (int64_t)value_len * 8)
+        return -1;
+    // Is start_bit outside buffer.
+    if(start_bit < 0 || (size_t)start_bit / 8 >= buffer_len)
+        return -10;
+    if(bit_len < 0)
+        return -20;
+    // Does value span over end of buffer.
+    if((uint64_t)start_bit + bit_len > (uint64_t)buffer_len * 8)
+        return -30;
+    if(bit_len == 0)
+        return start_bit;
+
+    uint8_t* p = &buffer[start_bit / 8];
+    int bo = start_bit % 8;
+    int in_n = (bo + bit_len + 7) / 8;      // Buffer bytes of field.
+    int out_n = (bit_len + 7) / 8;          // Value bytes of field.
+
+    // Masks of field bits in first and last buffer byte.
+    uint8_t first = 0xff >> bo;
+    uint8_t last = (uint8_t)(0xff << (in_n * 8 - bo - bit_len));
+    if(in_n == 1)
+        first &= last;
+
+    int b = 0;
+    while(b < in_n) {
+        // Middle buffer bytes are completely covered by the field. Copy 8
+        // of them at once if the value bytes b-1 to b+7 exist.
+        if(b > 0 && b + 8 < in_n && b + 8 <= out_n) {
+            uint64_t v;
+            if(bo == 0)
+                v = load_be64(&value[b]);
+            else
+                v = (load_be64(&value[b - 1]) << (8 - bo)) |
+                    (value[b + 7] >> bo);
+            if(!erase)
+                v |= load_be64(&p[b]);
+            store_be64(&p[b], v);
+            b += 8;
+            continue;
+        }
+
+        // Value bits shifted into buffer byte b.
+        uint8_t s = 0;
+        if(b < out_n)
+            s = value[b] >> bo;
+        if(b > 0 && bo > 0 && b - 1 < out_n)
+            s |= value[b - 1] << (8 - bo);
+
+        uint8_t m = (b == 0 ? first : (b == in_n - 1 ? last : 0xff));
+        if(erase)
+            p[b] = (p[b] & ~m) | (s & m);
+        else
+            p[b] |= s & m;
+        b++;
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * set_buffer_bits3 sets an arbitrary number of bits at an arbitrary position
+ * in a byte buffer like set_message_bits3 does in a message. Bytes completely
+ * covered by the field are written 8 at a time, only the first and last byte
+ * need a masked read-modify-write.
+ * @param[in] buffer        Buffer of buffer_len bytes
+ * @param[in] buffer_len    Number of bytes in buffer
+ * @param[in] start_bit     Absolute bit position where value should be inserted
+ * @param[in] bit_len       Number of bits of value to insert at start_bit position
+ * @param[in] value         An array of uint8_t values to insert. Consecutive
+ *                          bytes in network byte order.
+ * @param[in] value_len     Number of uint8_t bytes in value array
+ * @param[in] erase         if true, set range in buffer to 0 before inserting
+ *                          value, if false, value is just ORed without erasing
+ *                          before
+ * @returns                 Positive integer of bit position in buffer where
+ *                          inserted value ends, negative value in case of error
+ */
+int set_buffer_bits3(uint8_t buffer[], size_t buffer_len,
+                     int start_bit, int bit_len,
+                     const uint8_t value[], int value_len,
+                     bool erase) {
+    int rtc = do_set_buffer_bits3(buffer, buffer_len, start_bit, bit_len, value,
+                                  value_len, erase);
+    TRACE(BITTER_TRACE_SET_BUFFER_BITS3, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// get_buffer_bits3 without tracing.
+static int do_get_buffer_bits3(const uint8_t buffer[], size_t buffer_len,
+                               int start_bit, int bit_len,
+                               uint8_t value[], int value_len) {
+
+    // If bits to get from buffer > then bits available in value; exit
+    if(bit_len > (int64_t)value_len * 8)
+        return -1;
+    if(value == NULL)
+        return -2;
+    // Is start_bit outside buffer.
+    if(start_bit < 0 || (size_t)start_bit / 8 >= buffer_len)
+        return -10;
+    if(bit_len < 0)
+        return -20;
+    // Does value span over end of buffer.
+    if((uint64_t)start_bit + bit_len > (uint64_t)buffer_len * 8)
+        return -30;
+    if(bit_len == 0)
+        return start_bit;
+
+    const uint8_t* p = &buffer[start_bit / 8];
+    int bo = start_bit % 8;
+    int in_n = (bo + bit_len + 7) / 8;
+    int out_n = (bit_len + 7) / 8;
+    size_t avail = buffer_len - start_bit / 8;
+
+    // 8 value bytes need up to 9 buffer bytes.
+    int j = 0;
+    for(; j + 8 <= out_n && (size_t)j + 9 <= avail; j += 8) {
+        uint64_t v = load_be64(&p[j]);
+        if(bo > 0)
+            v = (v << bo) | (p[j + 8] >> (8 - bo));
+        store_be64(&value[j], v);
+    }
+    for(; j < out_n; j++) {
+        uint8_t v = p[j] << bo;
+        if(bo > 0 && j + 1 < in_n)
+            v |= p[j + 1] >> (8 - bo);
+        value[j] = v;
+    }
+
+    if(bit_len % 8)
+        value[out_n - 1] &= (uint8_t)(0xff << (8 - bit_len % 8));
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * get_buffer_bits3 extracts an arbitrary number of bits from an arbitrary
+ * position of a byte buffer as a value array containing consecutive uint8_t
+ * bytes in network byte order, like get_message_bits3 does from a message.
+ * Unused bits of the last value byte are set to 0.
+ * @param[in] buffer        Buffer of buffer_len bytes
+ * @param[in] buffer_len    Number of bytes in buffer
+ * @param[in] start_bit     Absolute bit position where value should be extracted
+ * @param[in] bit_len       Number of bits of value to extract from start_bit
+ *                          position
+ * @param[out] value        uint8_t pointer to receive extracted values
+ * @param[in] value_len     Number of uint8_t bytes in value array
+ * @returns                 Positive integer of bit position in buffer where
+ *                          read value ends, negative value in case of error
+ */
+int get_buffer_bits3(const uint8_t buffer[], size_t buffer_len,
+                     int start_bit, int bit_len,
+                     uint8_t value[], int value_len) {
+    int rtc = do_get_buffer_bits3(buffer, buffer_len, start_bit, bit_len, value,
+                                  value_len);
+    TRACE(BITTER_TRACE_GET_BUFFER_BITS3, start_bit, bit_len, rtc);
+    return rtc;
+}
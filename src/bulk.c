@@ -0,0 +1,25 @@
+/// @file bulk.c
+
+#include "bulk_impl.h"
+
+
+/*
+ * Portable bulk bit copy kernels, used when no vector instruction set is
+ * available. See bulk_impl.h for the implementation.
+ *
+ * bits_insert       - inserts bit_len bits from a word array in
+ *                     host-byte-order into a message.
+ * bits_insert_bytes - inserts bit_len bits from a byte array in
+ *                     network-byte-order into a message. Only the
+ *                     (bit_len + 7) / 8 bytes covering the field are read.
+ * bits_extract      - extracts bit_len bits from a message into a word
+ *                     array, unused bits of the last word are cleared.
+ * bits_extract_bytes- extracts bit_len bits from a message into a byte
+ *                     array. Only (bit_len + 7) / 8 bytes are written.
+ * bits_copy         - copies word_cnt words from src at bit offset off
+ *                     into dst, see copy_generic.
+ *
+ * All kernels take the first message word touched by the field and the bit
+ * offset mo of the field in this word. bit_len must be > 0.
+ */
+DEFINE_BULK_KERNELS(scalar)
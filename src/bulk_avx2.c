@@ -0,0 +1,143 @@
+/// @file bulk_avx2.c
+
+#include "bitter.h"
+
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+
+#pragma GCC target("avx2")
+#include <immintrin.h>
+
+
+// Reverses the bytes of each 64 bit lane, converting between host- and
+// network-byte-order.
+static inline __m256i bswap64_avx2(__m256i x) {
+    const __m256i idx = _mm256_set_epi8(
+         8,  9, 10, 11, 12, 13, 14, 15,  0,  1,  2,  3,  4,  5,  6,  7,
+         8,  9, 10, 11, 12, 13, 14, 15,  0,  1,  2,  3,  4,  5,  6,  7);
+    return _mm256_shuffle_epi8(x, idx);
+}
+
+// Loads 4 value words starting at word k in host-byte-order.
+static inline __m256i load_value_avx2(const void* value, int64_t k,
+                                      bool bytes) {
+    const __m256i* p = (const __m256i*)((const uint64_t*)value + k);
+    if(bytes)
+        return bswap64_avx2(_mm256_loadu_si256(p));
+    return _mm256_loadu_si256(p);
+}
+
+
+/*
+ * Inserts 4 message words per iteration. Each lane is funnel shifted from
+ * the value words j-1 and j, loaded by two overlapping unaligned loads.
+ * A shift count of 64 (mo == 0) yields 0 in AVX2, so aligned fields need
+ * no special case.
+ */
+static inline int64_t insert_middle_avx2(WORD_T message[], int mo,
+                                         const void* value,
+                                         int64_t j, int64_t j_end,
+                                         bool erase, bool bytes) {
+    const __m128i sl = _mm_cvtsi32_si128(WORD_BIT_LEN - mo);
+    const __m128i sr = _mm_cvtsi32_si128(mo);
+
+    for(; j + 4 <= j_end; j += 4) {
+        __m256i v;
+        if(bytes && mo == 0) {
+            // Already in network-byte-order.
+            v = _mm256_loadu_si256((const __m256i*)((const uint64_t*)value + j));
+        }
+        else {
+            __m256i prev = load_value_avx2(value, j - 1, bytes);
+            __m256i cur = load_value_avx2(value, j, bytes);
+            v = _mm256_or_si256(_mm256_sll_epi64(prev, sl),
+                                _mm256_srl_epi64(cur, sr));
+            v = bswap64_avx2(v);
+        }
+
+        __m256i* m = (__m256i*)&message[j];
+        if(!erase)
+            v = _mm256_or_si256(v, _mm256_loadu_si256(m));
+        _mm256_storeu_si256(m, v);
+    }
+
+    return j;
+}
+
+
+/*
+ * Extracts 4 value words per iteration, each funnel shifted from the
+ * message words k and k+1.
+ */
+static inline int64_t extract_middle_avx2(const WORD_T message[], int mo,
+                                          void* value,
+                                          int64_t k, int64_t k_end,
+                                          bool bytes) {
+    const __m128i sl = _mm_cvtsi32_si128(mo);
+    const __m128i sr = _mm_cvtsi32_si128(WORD_BIT_LEN - mo);
+
+    for(; k + 4 <= k_end; k += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)&message[k]);
+        __m256i* p = (__m256i*)((uint64_t*)value + k);
+
+        if(mo == 0) {
+            if(!bytes)
+                v = bswap64_avx2(v);
+            _mm256_storeu_si256(p, v);
+            continue;
+        }
+
+        __m256i next = _mm256_loadu_si256((const __m256i*)&message[k + 1]);
+        v = _mm256_or_si256(_mm256_sll_epi64(bswap64_avx2(v), sl),
+                            _mm256_srl_epi64(bswap64_avx2(next), sr));
+        if(bytes)
+            v = bswap64_avx2(v);
+        _mm256_storeu_si256(p, v);
+    }
+
+    return k;
+}
+
+
+/*
+ * Copies 4 words per iteration, each funnel shifted from the source words
+ * k and k+1. All source words of an iteration are loaded before its
+ * destination words are stored, so overlapping arrays are fine in the
+ * direction given by backwards.
+ */
+static inline __m256i copy_block_avx2(const WORD_T src[], int64_t k,
+                                      __m128i sl, __m128i sr) {
+    __m256i cur = _mm256_loadu_si256((const __m256i*)&src[k]);
+    __m256i next = _mm256_loadu_si256((const __m256i*)&src[k + 1]);
+    __m256i v = _mm256_or_si256(_mm256_sll_epi64(bswap64_avx2(cur), sl),
+                                _mm256_srl_epi64(bswap64_avx2(next), sr));
+    return bswap64_avx2(v);
+}
+
+static inline int64_t copy_middle_avx2(WORD_T dst[], const WORD_T src[],
+                                       int off, int64_t k, int64_t k_end,
+                                       bool backwards) {
+    const __m128i sl = _mm_cvtsi32_si128(off);
+    const __m128i sr = _mm_cvtsi32_si128(WORD_BIT_LEN - off);
+
+    if(backwards) {
+        for(; k_end - 4 >= k; k_end -= 4)
+            _mm256_storeu_si256((__m256i*)&dst[k_end - 4],
+                                copy_block_avx2(src, k_end - 4, sl, sr));
+        return k_end;
+    }
+
+    for(; k + 4 <= k_end; k += 4)
+        _mm256_storeu_si256((__m256i*)&dst[k],
+                            copy_block_avx2(src, k, sl, sr));
+    return k;
+}
+
+
+#define BULK_INSERT_MIDDLE      insert_middle_avx2
+#define BULK_EXTRACT_MIDDLE     extract_middle_avx2
+#define BULK_COPY_MIDDLE        copy_middle_avx2
+#include "bulk_impl.h"
+
+DEFINE_BULK_KERNELS(avx2)
+
+#endif
@@ -0,0 +1,128 @@
+/// @file bulk_avx512.c
+
+#include "bitter.h"
+
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+
+#pragma GCC target("avx512f,avx512bw")
+#include <immintrin.h>
+
+
+// Reverses the bytes of each 64 bit lane, converting between host- and
+// network-byte-order.
+static inline __m512i bswap64_avx512(__m512i x) {
+    const __m512i idx = _mm512_broadcast_i32x4(_mm_set_epi8(
+         8,  9, 10, 11, 12, 13, 14, 15,  0,  1,  2,  3,  4,  5,  6,  7));
+    return _mm512_shuffle_epi8(x, idx);
+}
+
+// Loads 8 value words starting at word k in host-byte-order.
+static inline __m512i load_value_avx512(const void* value, int64_t k,
+                                        bool bytes) {
+    const void* p = (const uint64_t*)value + k;
+    if(bytes)
+        return bswap64_avx512(_mm512_loadu_si512(p));
+    return _mm512_loadu_si512(p);
+}
+
+
+/*
+ * Same as the AVX2 kernels in bulk_avx2.c, but processing 8 words per
+ * iteration.
+ */
+static inline int64_t insert_middle_avx512(WORD_T message[], int mo,
+                                           const void* value,
+                                           int64_t j, int64_t j_end,
+                                           bool erase, bool bytes) {
+    const __m128i sl = _mm_cvtsi32_si128(WORD_BIT_LEN - mo);
+    const __m128i sr = _mm_cvtsi32_si128(mo);
+
+    for(; j + 8 <= j_end; j += 8) {
+        __m512i v;
+        if(bytes && mo == 0) {
+            // Already in network-byte-order.
+            v = _mm512_loadu_si512((const uint64_t*)value + j);
+        }
+        else {
+            __m512i prev = load_value_avx512(value, j - 1, bytes);
+            __m512i cur = load_value_avx512(value, j, bytes);
+            v = _mm512_or_si512(_mm512_sll_epi64(prev, sl),
+                                _mm512_srl_epi64(cur, sr));
+            v = bswap64_avx512(v);
+        }
+
+        if(!erase)
+            v = _mm512_or_si512(v, _mm512_loadu_si512(&message[j]));
+        _mm512_storeu_si512(&message[j], v);
+    }
+
+    return j;
+}
+
+
+static inline int64_t extract_middle_avx512(const WORD_T message[], int mo,
+                                            void* value,
+                                            int64_t k, int64_t k_end,
+                                            bool bytes) {
+    const __m128i sl = _mm_cvtsi32_si128(mo);
+    const __m128i sr = _mm_cvtsi32_si128(WORD_BIT_LEN - mo);
+
+    for(; k + 8 <= k_end; k += 8) {
+        __m512i v = _mm512_loadu_si512(&message[k]);
+        void* p = (uint64_t*)value + k;
+
+        if(mo == 0) {
+            if(!bytes)
+                v = bswap64_avx512(v);
+            _mm512_storeu_si512(p, v);
+            continue;
+        }
+
+        __m512i next = _mm512_loadu_si512(&message[k + 1]);
+        v = _mm512_or_si512(_mm512_sll_epi64(bswap64_avx512(v), sl),
+                            _mm512_srl_epi64(bswap64_avx512(next), sr));
+        if(bytes)
+            v = bswap64_avx512(v);
+        _mm512_storeu_si512(p, v);
+    }
+
+    return k;
+}
+
+
+static inline __m512i copy_block_avx512(const WORD_T src[], int64_t k,
+                                        __m128i sl, __m128i sr) {
+    __m512i cur = _mm512_loadu_si512(&src[k]);
+    __m512i next = _mm512_loadu_si512(&src[k + 1]);
+    __m512i v = _mm512_or_si512(_mm512_sll_epi64(bswap64_avx512(cur), sl),
+                                _mm512_srl_epi64(bswap64_avx512(next), sr));
+    return bswap64_avx512(v);
+}
+
+static inline int64_t copy_middle_avx512(WORD_T dst[], const WORD_T src[],
+                                         int off, int64_t k, int64_t k_end,
+                                         bool backwards) {
+    const __m128i sl = _mm_cvtsi32_si128(off);
+    const __m128i sr = _mm_cvtsi32_si128(WORD_BIT_LEN - off);
+
+    if(backwards) {
+        for(; k_end - 8 >= k; k_end -= 8)
+            _mm512_storeu_si512(&dst[k_end - 8],
+                                copy_block_avx512(src, k_end - 8, sl, sr));
+        return k_end;
+    }
+
+    for(; k + 8 <= k_end; k += 8)
+        _mm512_storeu_si512(&dst[k], copy_block_avx512(src, k, sl, sr));
+    return k;
+}
+
+
+#define BULK_INSERT_MIDDLE      insert_middle_avx512
+#define BULK_EXTRACT_MIDDLE     extract_middle_avx512
+#define BULK_COPY_MIDDLE        copy_middle_avx512
+#include "bulk_impl.h"
+
+DEFINE_BULK_KERNELS(avx512)
+
+#endif
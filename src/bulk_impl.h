@@ -0,0 +1,305 @@
+/// @file bulk_impl.h
+/// Generic implementation of the bulk bit copy kernels. This file is
+/// included by the per instruction set kernel files, each of them
+/// instantiating the kernels with DEFINE_BULK_KERNELS(<suffix>).
+///
+/// A file may define BULK_INSERT_MIDDLE and BULK_EXTRACT_MIDDLE before
+/// including this file to process the middle words of a field with vector
+/// instructions:
+///
+///   int64_t BULK_INSERT_MIDDLE(WORD_T message[], int mo, const void* value,
+///                              int64_t j, int64_t j_end, bool erase,
+///                              bool bytes);
+///   int64_t BULK_EXTRACT_MIDDLE(const WORD_T message[], int mo, void* value,
+///                               int64_t k, int64_t k_end, bool bytes);
+///
+/// Both process as many words starting at j (k) and ending before j_end
+/// (k_end) as they like and return the index of the first word not
+/// processed. Remaining words are processed by the scalar code.
+///
+/// BULK_COPY_MIDDLE may be defined the same way for bits_copy:
+///
+///   int64_t BULK_COPY_MIDDLE(WORD_T dst[], const WORD_T src[], int off,
+///                            int64_t k, int64_t k_end, bool backwards);
+///
+/// Forwards it works like the functions above, backwards it processes words
+/// from k_end down and returns the end of the words not processed.
+
+#ifndef _BULK_IMPL_H_
+#define _BULK_IMPL_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "kernels.h"
+
+
+#define ONES            (~(WORD_T)0)
+#define ALWAYS_INLINE   static inline __attribute__((always_inline))
+
+
+// The bulk kernels below are written once for both kinds of value arrays;
+// word arrays in host-byte-order and byte arrays in network-byte-order.
+// They are always inlined with a constant 'bytes' argument, so each
+// exported kernel gets its own specialized copy.
+
+
+// Loads a complete value word k.
+ALWAYS_INLINE WORD_T load_value(const void* value, int64_t k, bool bytes) {
+    if(!bytes)
+        return ((const WORD_T*)value)[k];
+
+    WORD_T v;
+    memcpy(&v, (const uint8_t*)value + k * WORD_BYTE_LEN, WORD_BYTE_LEN);
+    return WORD_NTOH(v);
+}
+
+// Loads value word k which may be incomplete or outside of value (k < 0 or
+// k >= value_words). Missing bits are returned as 0.
+ALWAYS_INLINE WORD_T fetch_value(const void* value, int64_t k,
+                                 int64_t value_words, int tail_bytes,
+                                 bool bytes) {
+    if(k < 0 || k >= value_words)
+        return 0;
+    if(!bytes || k < value_words - 1)
+        return load_value(value, k, bytes);
+
+    WORD_T v = 0;
+    memcpy(&v, (const uint8_t*)value + k * WORD_BYTE_LEN, tail_bytes);
+    return WORD_NTOH(v);
+}
+
+// Stores a complete value word k.
+ALWAYS_INLINE void store_value(void* value, int64_t k, WORD_T v, bool bytes) {
+    if(!bytes) {
+        ((WORD_T*)value)[k] = v;
+        return;
+    }
+
+    v = WORD_HTON(v);
+    memcpy((uint8_t*)value + k * WORD_BYTE_LEN, &v, WORD_BYTE_LEN);
+}
+
+// Inserts masked bits of v into message word m.
+ALWAYS_INLINE void merge_word(WORD_T* m, WORD_T v, WORD_T mask, bool erase) {
+    WORD_T x = WORD_NTOH(*m);
+    if(erase)
+        x &= ~mask;
+    x |= v & mask;
+    *m = WORD_HTON(x);
+}
+
+
+/*
+ * Message word j of the field receives the funnel shifted value words j-1
+ * and j:
+ *
+ *   out[j] = (value[j-1] << (word_bit_len - mo)) | (value[j] >> mo)
+ *
+ * Only the first (head) and last (tail) message word need a masked
+ * read-modify-write, all words in between are completely overwritten
+ * (or ORed if erase is false). If the field starts at a word boundary
+ * (mo == 0), the middle words are just byte swapped copies.
+ */
+ALWAYS_INLINE void insert_generic(WORD_T message[], int mo,
+                                  const void* value, int64_t bit_len,
+                                  bool erase, bool bytes) {
+
+    int64_t msg_words = (mo + bit_len + WORD_BIT_LEN - 1) / WORD_BIT_LEN;
+    int64_t value_words = (bit_len + WORD_BIT_LEN - 1) / WORD_BIT_LEN;
+    int end_off = (mo + bit_len) % WORD_BIT_LEN;
+    int tail_bytes = WORD_BYTE_LEN;
+    int64_t full_words = value_words;
+    if(bytes) {
+        tail_bytes = (bit_len + 7) / 8 - (value_words - 1) * WORD_BYTE_LEN;
+        if(tail_bytes < WORD_BYTE_LEN)
+            full_words--;
+    }
+
+    // Head word.
+    WORD_T mask = ONES >> mo;
+    if(msg_words == 1 && end_off != 0)
+        mask &= ~(ONES >> end_off);
+    WORD_T cur = fetch_value(value, 0, value_words, tail_bytes, bytes);
+    merge_word(&message[0], cur >> mo, mask, erase);
+
+    // Middle words, only using complete value words. Word msg_words-1 is
+    // always handled as tail.
+    int64_t j_end = (full_words < msg_words - 1 ? full_words : msg_words - 1);
+    int64_t j = 1;
+#ifdef BULK_INSERT_MIDDLE
+    if(j_end > j)
+        j = BULK_INSERT_MIDDLE(message, mo, value, j, j_end, erase, bytes);
+#endif
+    if(mo == 0) {
+        for(; j<j_end; j++) {
+            WORD_T v = WORD_HTON(load_value(value, j, bytes));
+            if(erase)
+                message[j] = v;
+            else
+                message[j] |= v;
+        }
+    }
+    else {
+        WORD_T prev = (j > 1 ? load_value(value, j - 1, bytes) : cur);
+        for(; j<j_end; j++) {
+            cur = load_value(value, j, bytes);
+            WORD_T v = (prev << (WORD_BIT_LEN - mo)) | (cur >> mo);
+            v = WORD_HTON(v);
+            if(erase)
+                message[j] = v;
+            else
+                message[j] |= v;
+            prev = cur;
+        }
+    }
+
+    // Remaining words where value words may be incomplete, including tail.
+    for(; j<msg_words; j++) {
+        WORD_T v = fetch_value(value, j, value_words, tail_bytes, bytes);
+        if(mo > 0)
+            v = (fetch_value(value, j - 1, value_words, tail_bytes, bytes) <<
+                    (WORD_BIT_LEN - mo)) | (v >> mo);
+        mask = ONES;
+        if(j == msg_words - 1 && end_off != 0)
+            mask = ~(ONES >> end_off);
+        merge_word(&message[j], v, mask, erase);
+    }
+}
+
+
+/*
+ * Value word k receives the funnel shifted message words k and k+1:
+ *
+ *   value[k] = (message[k] << mo) | (message[k+1] >> (word_bit_len - mo))
+ *
+ * Message word k+1 is only read when it still belongs to the field. Unused
+ * bits of the last value word are cleared.
+ */
+ALWAYS_INLINE void extract_generic(const WORD_T message[], int mo,
+                                   void* value, int64_t bit_len, bool bytes) {
+
+    int64_t msg_words = (mo + bit_len + WORD_BIT_LEN - 1) / WORD_BIT_LEN;
+    int64_t value_words = (bit_len + WORD_BIT_LEN - 1) / WORD_BIT_LEN;
+    if(value_words == 0)
+        return;
+
+    // All value words except the last one.
+    int64_t k = 0;
+#ifdef BULK_EXTRACT_MIDDLE
+    if(value_words - 1 > k)
+        k = BULK_EXTRACT_MIDDLE(message, mo, value, k, value_words - 1, bytes);
+#endif
+    if(mo == 0) {
+        for(; k<value_words-1; k++)
+            store_value(value, k, WORD_NTOH(message[k]), bytes);
+    }
+    else {
+        WORD_T cur = WORD_NTOH(message[k]);
+        for(; k<value_words-1; k++) {
+            WORD_T next = WORD_NTOH(message[k + 1]);
+            store_value(value, k,
+                (cur << mo) | (next >> (WORD_BIT_LEN - mo)), bytes);
+            cur = next;
+        }
+    }
+
+    // Last value word.
+    WORD_T v = WORD_NTOH(message[k]) << mo;
+    if(k + 1 < msg_words)
+        v |= WORD_NTOH(message[k + 1]) >> (WORD_BIT_LEN - mo);
+    int last_bits = bit_len - k * WORD_BIT_LEN;
+    if(last_bits < WORD_BIT_LEN)
+        v &= ~(ONES >> last_bits);
+
+    if(!bytes || last_bits == WORD_BIT_LEN) {
+        store_value(value, k, v, bytes);
+        return;
+    }
+    v = WORD_HTON(v);
+    memcpy((uint8_t*)value + k * WORD_BYTE_LEN, &v, (last_bits + 7) / 8);
+}
+
+
+/*
+ * Message word k of dst receives the funnel shifted words k and k+1 of src:
+ *
+ *   dst[k] = (src[k] << off) | (src[k+1] >> (word_bit_len - off))
+ *
+ * Both arrays are in network-byte-order, so for off == 0 this is a plain
+ * memmove. dst and src may overlap, backwards has to be set if dst is
+ * behind src in memory.
+ */
+ALWAYS_INLINE void copy_generic(WORD_T dst[], const WORD_T src[], int off,
+                                int64_t word_cnt, bool backwards) {
+    if(off == 0) {
+        memmove(dst, src, word_cnt * WORD_BYTE_LEN);
+        return;
+    }
+
+    if(!backwards) {
+        int64_t k = 0;
+#ifdef BULK_COPY_MIDDLE
+        k = BULK_COPY_MIDDLE(dst, src, off, k, word_cnt, false);
+#endif
+        WORD_T cur = WORD_NTOH(src[k]);
+        for(; k<word_cnt; k++) {
+            WORD_T next = WORD_NTOH(src[k + 1]);
+            dst[k] = WORD_HTON((cur << off) | (next >> (WORD_BIT_LEN - off)));
+            cur = next;
+        }
+    }
+    else {
+        int64_t k = word_cnt;
+#ifdef BULK_COPY_MIDDLE
+        k = BULK_COPY_MIDDLE(dst, src, off, 0, k, true);
+#endif
+        WORD_T next = WORD_NTOH(src[k]);
+        for(; k>0; k--) {
+            WORD_T cur = WORD_NTOH(src[k - 1]);
+            dst[k - 1] = WORD_HTON((cur << off) |
+                                   (next >> (WORD_BIT_LEN - off)));
+            next = cur;
+        }
+    }
+}
+
+
+// Instantiates the exported kernels of one instruction set.
+#define DEFINE_BULK_KERNELS(suffix)                                         \
+void bits_insert_##suffix(WORD_T message[], int mo,                         \
+        const WORD_T value[], int64_t bit_len, bool erase) {                \
+    if(erase)                                                               \
+        insert_generic(message, mo, value, bit_len, true, false);          \
+    else                                                                    \
+        insert_generic(message, mo, value, bit_len, false, false);         \
+}                                                                           \
+void bits_insert_bytes_##suffix(WORD_T message[], int mo,                   \
+        const uint8_t value[], int64_t bit_len, bool erase) {               \
+    if(erase)                                                               \
+        insert_generic(message, mo, value, bit_len, true, true);           \
+    else                                                                    \
+        insert_generic(message, mo, value, bit_len, false, true);          \
+}                                                                           \
+void bits_extract_##suffix(const WORD_T message[], int mo,                  \
+        WORD_T value[], int64_t bit_len) {                                  \
+    extract_generic(message, mo, value, bit_len, false);                    \
+}                                                                           \
+void bits_extract_bytes_##suffix(const WORD_T message[], int mo,            \
+        uint8_t value[], int64_t bit_len) {                                 \
+    extract_generic(message, mo, value, bit_len, true);                     \
+}                                                                           \
+void bits_copy_##suffix(WORD_T dst[], const WORD_T src[], int off,          \
+        int64_t word_cnt, bool backwards) {                                 \
+    if(backwards)                                                           \
+        copy_generic(dst, src, off, word_cnt, true);                        \
+    else                                                                    \
+        copy_generic(dst, src, off, word_cnt, false);                       \
+}
+
+#endif
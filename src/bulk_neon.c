@@ -0,0 +1,98 @@
+/// @file bulk_neon.c
+
+#include "bitter.h"
+
+#if WORD_BIT_LEN == 64 && defined(__aarch64__)
+
+#include <arm_neon.h>
+
+
+// Reverses the bytes of each 64 bit lane, converting between host- and
+// network-byte-order.
+static inline uint64x2_t bswap64_neon(uint64x2_t x) {
+    return vreinterpretq_u64_u8(vrev64q_u8(vreinterpretq_u8_u64(x)));
+}
+
+// Loads 2 value words starting at word k in host-byte-order.
+static inline uint64x2_t load_value_neon(const void* value, int64_t k,
+                                         bool bytes) {
+    uint64x2_t v = vreinterpretq_u64_u8(
+        vld1q_u8((const uint8_t*)((const uint64_t*)value + k)));
+    if(bytes)
+        return bswap64_neon(v);
+    return v;
+}
+
+
+/*
+ * Same as the AVX2 kernels in bulk_avx2.c, but processing 2 words per
+ * iteration. NEON shifts by register, a negative count shifts right and
+ * a count of +-64 yields 0.
+ */
+static inline int64_t insert_middle_neon(WORD_T message[], int mo,
+                                         const void* value,
+                                         int64_t j, int64_t j_end,
+                                         bool erase, bool bytes) {
+    const int64x2_t sl = vdupq_n_s64(WORD_BIT_LEN - mo);
+    const int64x2_t sr = vdupq_n_s64(-mo);
+
+    for(; j + 2 <= j_end; j += 2) {
+        uint64x2_t v;
+        if(bytes && mo == 0) {
+            // Already in network-byte-order.
+            v = vreinterpretq_u64_u8(
+                vld1q_u8((const uint8_t*)((const uint64_t*)value + j)));
+        }
+        else {
+            uint64x2_t prev = load_value_neon(value, j - 1, bytes);
+            uint64x2_t cur = load_value_neon(value, j, bytes);
+            v = vorrq_u64(vshlq_u64(prev, sl), vshlq_u64(cur, sr));
+            v = bswap64_neon(v);
+        }
+
+        if(!erase)
+            v = vorrq_u64(v, vld1q_u64(&message[j]));
+        vst1q_u64(&message[j], v);
+    }
+
+    return j;
+}
+
+
+static inline int64_t extract_middle_neon(const WORD_T message[], int mo,
+                                          void* value,
+                                          int64_t k, int64_t k_end,
+                                          bool bytes) {
+    const int64x2_t sl = vdupq_n_s64(mo);
+    const int64x2_t sr = vdupq_n_s64(mo - WORD_BIT_LEN);
+
+    for(; k + 2 <= k_end; k += 2) {
+        uint64x2_t v = vld1q_u64(&message[k]);
+        uint8_t* p = (uint8_t*)((uint64_t*)value + k);
+
+        if(mo == 0) {
+            if(!bytes)
+                v = bswap64_neon(v);
+            vst1q_u8(p, vreinterpretq_u8_u64(v));
+            continue;
+        }
+
+        uint64x2_t next = vld1q_u64(&message[k + 1]);
+        v = vorrq_u64(vshlq_u64(bswap64_neon(v), sl),
+                      vshlq_u64(bswap64_neon(next), sr));
+        if(bytes)
+            v = bswap64_neon(v);
+        vst1q_u8(p, vreinterpretq_u8_u64(v));
+    }
+
+    return k;
+}
+
+
+#define BULK_INSERT_MIDDLE      insert_middle_neon
+#define BULK_EXTRACT_MIDDLE     extract_middle_neon
+#include "bulk_impl.h"
+
+DEFINE_BULK_KERNELS(neon)
+
+#endif
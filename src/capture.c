@@ -0,0 +1,139 @@
+/// @file capture.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pcap.h>
+
+#include "bitter.h"
+
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void update_rates(capture_stats_t* stats, double start) {
+    stats->seconds = now() - start;
+    if(stats->seconds > 0) {
+        stats->packets_per_sec = stats->packets / stats->seconds;
+        stats->bytes_per_sec = stats->bytes / stats->seconds;
+    }
+}
+
+
+/**
+ * decode_capture - streams all packets of a pcap or pcapng capture file
+ * and applies a field layout to the payload of every packet. Payloads are
+ * decoded in place from the libpcap packet buffer, without copying them
+ * into a message first. Decoded values are collected in one column per
+ * field and handed to a callback in batches of batch_size packets.
+ * Packets too short for the layout are skipped.
+ * @param[in] path          Capture file (pcap or pcapng)
+ * @param[in] layout        Layout created by message_layout_init, start_bit
+ *                          of fields is relative to payload_offset
+ * @param[in] payload_offset Number of bytes at start of each packet to skip,
+ *                          e.g. 42 for Ethernet/IPv4/UDP headers
+ * @param[in] batch_size    Maximum number of packets per callback call
+ * @param[in] fn            Callback called with the value columns and
+ *                          capture timestamps (in microseconds) of a batch
+ *                          of packets. Returning a value other than 0 stops
+ *                          decoding.
+ * @param[in] arg           Argument passed to fn
+ * @param[out] stats        Packet and byte counts and rates, may be NULL
+ * @returns                 0 if the whole capture was decoded, 1 if stopped
+ *                          by the callback, negative value in case of error
+ */
+int decode_capture(const char* path, const message_layout_t* layout,
+                   int payload_offset, int batch_size,
+                   capture_fn fn, void* arg, capture_stats_t* stats) {
+
+    if(path == NULL || layout == NULL || layout->ops == NULL ||
+       payload_offset < 0 || batch_size < 1 || fn == NULL)
+        return -1;
+
+    capture_stats_t local_stats;
+    if(stats == NULL)
+        stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_t* pcap = pcap_open_offline(path, errbuf);
+    if(pcap == NULL) {
+        fprintf(stderr, "bitter: %s\n", errbuf);
+        return -6;
+    }
+
+    // Column memory of all fields and timestamps in one block.
+    int field_cnt = layout->field_cnt;
+    WORD_T** columns = calloc(field_cnt, sizeof(WORD_T*));
+    WORD_T* data = calloc((size_t)(field_cnt + 1) * batch_size, sizeof(WORD_T));
+    if(columns == NULL || data == NULL) {
+        free(columns);
+        free(data);
+        pcap_close(pcap);
+        return -5;
+    }
+    for(int i=0; i<field_cnt; i++)
+        columns[i] = &data[(size_t)i * batch_size];
+    uint64_t* timestamps = &data[(size_t)field_cnt * batch_size];
+
+    size_t min_len = (size_t)payload_offset + ((size_t)layout->end_bit + 7) / 8;
+    double start = now();
+    int rtc = 0;
+    int cnt = 0;
+
+    struct pcap_pkthdr* hdr;
+    const u_char* packet;
+    int r;
+    while((r = pcap_next_ex(pcap, &hdr, &packet)) >= 0) {
+        // Timeout, only used for live captures.
+        if(r == 0)
+            continue;
+
+        stats->packets++;
+        stats->bytes += hdr->caplen;
+        if(hdr->caplen < min_len) {
+            stats->skipped++;
+            continue;
+        }
+
+        // The packet buffer is only valid until the next packet is read,
+        // so each packet is decoded into its column row right away.
+        const uint8_t* payload = packet + payload_offset;
+        size_t payload_len = hdr->caplen - payload_offset;
+        decode_columns_buffer(layout, &payload, &payload_len, 1,
+                              columns, cnt);
+        timestamps[cnt] = (uint64_t)hdr->ts.tv_sec * 1000000 + hdr->ts.tv_usec;
+        stats->decoded++;
+
+        if(++cnt == batch_size) {
+            update_rates(stats, start);
+            if(fn(arg, columns, timestamps, cnt) != 0) {
+                rtc = 1;
+                cnt = 0;
+                break;
+            }
+            cnt = 0;
+        }
+    }
+
+    if(r == -1) {
+        fprintf(stderr, "bitter: %s\n", pcap_geterr(pcap));
+        rtc = -7;
+    }
+    else if(cnt > 0) {
+        update_rates(stats, start);
+        if(fn(arg, columns, timestamps, cnt) != 0)
+            rtc = 1;
+    }
+
+    update_rates(stats, start);
+    free(columns);
+    free(data);
+    pcap_close(pcap);
+    return rtc;
+}
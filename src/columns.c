@@ -0,0 +1,283 @@
+/// @file columns.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "trace.h"
+
+// Block loops use the vector instructions every CPU of the architecture
+// has, e.g. SSE2 on x86-64.
+#pragma GCC optimize("tree-vectorize")
+#include "columns_impl.h"
+
+
+// Portable batch kernels, see columns_impl.h for the implementation.
+DEFINE_COLUMN_KERNELS(scalar)
+
+
+// Checks arguments common to all batch functions.
+static bool columns_valid(const message_layout_t* layout, const void* messages,
+                          int message_cnt, const void* columns) {
+    if(layout->ops == NULL || messages == NULL || columns == NULL)
+        return false;
+    return message_cnt >= 0;
+}
+
+
+// encode_columns without tracing.
+static int do_encode_columns(const message_layout_t* layout, WORD_T messages[],
+                             int message_cnt, const WORD_T* const columns[]) {
+
+    if(!columns_valid(layout, messages, message_cnt, columns))
+        return -1;
+
+    WORD_T* rows[COLUMN_BLOCK];
+    for(int k=0; k<message_cnt; k+=COLUMN_BLOCK) {
+        int cnt = (message_cnt - k < COLUMN_BLOCK ? message_cnt - k
+                                                  : COLUMN_BLOCK);
+        for(int j=0; j<cnt; j++)
+            rows[j] = &messages[(size_t)(k + j) * layout->message_len];
+        bitter_kernels.encode_block(layout, rows, cnt, columns, k);
+    }
+
+    return message_cnt;
+}
+
+
+/**
+ * encode_columns - inserts all fields of a layout into a batch of binary
+ * messages stored one after the other. Values are given as one column per
+ * field, column i holding the values of field i of the field descriptor
+ * table for all messages. The value_offset of the fields is not used.
+ * Messages are processed in blocks, each operation of the layout is applied
+ * to all messages of a block at once.
+ * A binary message is an array of words in network-byte-order.
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] messages      Array of message_cnt messages of layout
+ *                          message_len words each
+ * @param[in] message_cnt   Number of messages
+ * @param[in] columns       Array of field_cnt value columns, each holding
+ *                          message_cnt WORD_T values
+ * @returns                 Number of messages encoded, negative value in
+ *                          case of error
+ */
+int encode_columns(const message_layout_t* layout, WORD_T messages[],
+                   int message_cnt, const WORD_T* const columns[]) {
+    int rtc = do_encode_columns(layout, messages, message_cnt, columns);
+    TRACE(BITTER_TRACE_ENCODE_COLUMNS, -1, layout->end_bit, rtc);
+    return rtc;
+}
+
+
+// encode_columns_ptr without tracing.
+static int do_encode_columns_ptr(const message_layout_t* layout,
+                                 WORD_T* const messages[], int message_cnt,
+                                 const WORD_T* const columns[]) {
+
+    if(!columns_valid(layout, messages, message_cnt, columns))
+        return -1;
+
+    for(int k=0; k<message_cnt; k+=COLUMN_BLOCK) {
+        int cnt = (message_cnt - k < COLUMN_BLOCK ? message_cnt - k
+                                                  : COLUMN_BLOCK);
+        bitter_kernels.encode_block(layout, &messages[k], cnt, columns, k);
+    }
+
+    return message_cnt;
+}
+
+
+/**
+ * encode_columns_ptr - same as encode_columns but for messages which are
+ * not stored one after the other.
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] messages      Array of message_cnt pointers to messages of
+ *                          layout message_len words each
+ * @param[in] message_cnt   Number of messages
+ * @param[in] columns       Array of field_cnt value columns, each holding
+ *                          message_cnt WORD_T values
+ * @returns                 Number of messages encoded, negative value in
+ *                          case of error
+ */
+int encode_columns_ptr(const message_layout_t* layout,
+                       WORD_T* const messages[], int message_cnt,
+                       const WORD_T* const columns[]) {
+    int rtc = do_encode_columns_ptr(layout, messages, message_cnt, columns);
+    TRACE(BITTER_TRACE_ENCODE_COLUMNS, -1, layout->end_bit, rtc);
+    return rtc;
+}
+
+
+// decode_columns without tracing.
+static int do_decode_columns(const message_layout_t* layout,
+                             const WORD_T messages[], int message_cnt,
+                             WORD_T* const columns[]) {
+
+    if(!columns_valid(layout, messages, message_cnt, columns))
+        return -1;
+
+    const WORD_T* rows[COLUMN_BLOCK];
+    for(int k=0; k<message_cnt; k+=COLUMN_BLOCK) {
+        int cnt = (message_cnt - k < COLUMN_BLOCK ? message_cnt - k
+                                                  : COLUMN_BLOCK);
+        for(int j=0; j<cnt; j++)
+            rows[j] = &messages[(size_t)(k + j) * layout->message_len];
+        bitter_kernels.decode_block(layout, rows, cnt, columns, k);
+    }
+
+    return message_cnt;
+}
+
+
+/**
+ * decode_columns - extracts all fields of a layout from a batch of binary
+ * messages stored one after the other into one value column per field.
+ * A binary message is an array of words in network-byte-order.
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] messages      Array of message_cnt messages of layout
+ *                          message_len words each
+ * @param[in] message_cnt   Number of messages
+ * @param[out] columns      Array of field_cnt value columns, each receiving
+ *                          message_cnt WORD_T values
+ * @returns                 Number of messages decoded, negative value in
+ *                          case of error
+ */
+int decode_columns(const message_layout_t* layout, const WORD_T messages[],
+                   int message_cnt, WORD_T* const columns[]) {
+    int rtc = do_decode_columns(layout, messages, message_cnt, columns);
+    TRACE(BITTER_TRACE_DECODE_COLUMNS, -1, layout->end_bit, rtc);
+    return rtc;
+}
+
+
+// decode_columns_ptr without tracing.
+static int do_decode_columns_ptr(const message_layout_t* layout,
+                                 const WORD_T* const messages[],
+                                 int message_cnt, WORD_T* const columns[]) {
+
+    if(!columns_valid(layout, messages, message_cnt, columns))
+        return -1;
+
+    for(int k=0; k<message_cnt; k+=COLUMN_BLOCK) {
+        int cnt = (message_cnt - k < COLUMN_BLOCK ? message_cnt - k
+                                                  : COLUMN_BLOCK);
+        bitter_kernels.decode_block(layout, &messages[k], cnt, columns, k);
+    }
+
+    return message_cnt;
+}
+
+
+/**
+ * decode_columns_ptr - same as decode_columns but for messages which are
+ * not stored one after the other.
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] messages      Array of message_cnt pointers to messages of
+ *                          layout message_len words each
+ * @param[in] message_cnt   Number of messages
+ * @param[out] columns      Array of field_cnt value columns, each receiving
+ *                          message_cnt WORD_T values
+ * @returns                 Number of messages decoded, negative value in
+ *                          case of error
+ */
+int decode_columns_ptr(const message_layout_t* layout,
+                       const WORD_T* const messages[], int message_cnt,
+                       WORD_T* const columns[]) {
+    int rtc = do_decode_columns_ptr(layout, messages, message_cnt, columns);
+    TRACE(BITTER_TRACE_DECODE_COLUMNS, -1, layout->end_bit, rtc);
+    return rtc;
+}
+
+
+// Loads message word w of a byte buffer of len bytes. Bytes after the
+// buffer end are read as 0.
+static inline WORD_T load_buffer_word(const uint8_t* buffer, size_t len,
+                                      int w) {
+    size_t offset = (size_t)w * WORD_BYTE_LEN;
+    WORD_T m = 0;
+    if(offset + WORD_BYTE_LEN <= len) {
+        memcpy(&m, &buffer[offset], WORD_BYTE_LEN);
+        return WORD_NTOH(m);
+    }
+    for(size_t i=offset; i<len; i++)
+        m |= (WORD_T)buffer[i] << (WORD_BIT_LEN - 8 - 8 * (i - offset));
+    return m;
+}
+
+
+// decode_columns_buffer without tracing.
+static int do_decode_columns_buffer(const message_layout_t* layout,
+                                    const uint8_t* const buffers[],
+                                    const size_t buffer_lens[], int buffer_cnt,
+                                    WORD_T* const columns[], int column_idx) {
+
+    if(!columns_valid(layout, buffers, buffer_cnt, columns) ||
+       buffer_lens == NULL || column_idx < 0)
+        return -1;
+
+    // Buffers too short for the layout.
+    size_t len = ((size_t)layout->end_bit + 7) / 8;
+    for(int k=0; k<buffer_cnt; k++)
+        if(buffer_lens[k] < len)
+            return -3;
+
+    for(int k=0; k<buffer_cnt; k+=COLUMN_BLOCK) {
+        int cnt = (buffer_cnt - k < COLUMN_BLOCK ? buffer_cnt - k
+                                                 : COLUMN_BLOCK);
+        const uint8_t* const* rows = &buffers[k];
+        size_t base = (size_t)column_idx + k;
+
+        for(int g=0; g<layout->group_cnt; g++) {
+            const field_group_t* grp = &layout->groups[g];
+            const field_op_t* op = &layout->ops[grp->op_start];
+            const field_op_t* op_end = op + grp->op_cnt;
+            WORD_T m[COLUMN_BLOCK];
+
+            // Only the bytes used by the layout are read from all buffers.
+            for(int j=0; j<cnt; j++)
+                m[j] = load_buffer_word(rows[j], len, grp->word_idx);
+
+            for(; op < op_end; op++) {
+                WORD_T* c = columns[op->field_idx] + base;
+                for(int j=0; j<cnt; j++)
+                    c[j] = (c[j] & op->keep) |
+                           (((m[j] & op->mask) >> op->lshift) << op->rshift);
+            }
+        }
+    }
+
+    return buffer_cnt;
+}
+
+
+/**
+ * decode_columns_buffer - extracts all fields of a layout from a batch of
+ * byte buffers of any alignment and length, e.g. received packets, into one
+ * value column per field. Buffers are decoded in place, bytes after the
+ * end of a buffer are never read. Each buffer must hold at least the bytes
+ * up to the highest bit position used by a field.
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] buffers       Array of buffer_cnt pointers to buffers
+ * @param[in] buffer_lens   Array of buffer_cnt buffer lengths in bytes
+ * @param[in] buffer_cnt    Number of buffers
+ * @param[out] columns      Array of field_cnt value columns
+ * @param[in] column_idx    Index in the value columns receiving the values
+ *                          of the first buffer, allows to fill columns
+ *                          incrementally
+ * @returns                 Number of buffers decoded, negative value in
+ *                          case of error
+ */
+int decode_columns_buffer(const message_layout_t* layout,
+                          const uint8_t* const buffers[],
+                          const size_t buffer_lens[], int buffer_cnt,
+                          WORD_T* const columns[], int column_idx) {
+    int rtc = do_decode_columns_buffer(layout, buffers, buffer_lens, buffer_cnt,
+                                       columns, column_idx);
+    TRACE(BITTER_TRACE_DECODE_COLUMNS_BUFFER, -1, layout->end_bit, rtc);
+    return rtc;
+}
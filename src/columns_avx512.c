@@ -0,0 +1,14 @@
+/// @file columns_avx512.c
+
+#include "bitter.h"
+
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+
+// The block loops of columns_impl.h are vectorized with AVX-512 instructions.
+#pragma GCC target("avx512f,avx512bw")
+#pragma GCC optimize("tree-vectorize")
+#include "columns_impl.h"
+
+DEFINE_COLUMN_KERNELS(avx512)
+
+#endif
@@ -0,0 +1,125 @@
+/// @file columns_impl.h
+/// Generic implementation of the batch kernels used by encode_columns and
+/// decode_columns. This file is included by the per instruction set kernel
+/// files, each of them instantiating the kernels with
+/// DEFINE_COLUMN_KERNELS(<suffix>).
+
+#ifndef _COLUMNS_IMPL_H_
+#define _COLUMNS_IMPL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "kernels.h"
+
+
+/*
+ * All messages of a batch share one layout, so every operation uses the
+ * same word index, shifts and masks for all of them. Messages are processed
+ * in blocks of COLUMN_BLOCK: the words of one group are gathered from all
+ * messages of the block into a small array, then each operation is applied
+ * to the whole array. This inner loop runs over consecutive column values
+ * with uniform shift counts and is vectorized by the compiler using the
+ * instruction set the kernel file is compiled for.
+ */
+static inline __attribute__((always_inline))
+void encode_block_generic(const message_layout_t* layout,
+                          WORD_T* const rows[], int cnt,
+                          const WORD_T* const columns[], size_t base) {
+
+    for(int g=0; g<layout->group_cnt; g++) {
+        const field_group_t* grp = &layout->groups[g];
+        const field_op_t* op = &layout->ops[grp->op_start];
+        const field_op_t* op_end = op + grp->op_cnt;
+        int w = grp->word_idx;
+        WORD_T m[COLUMN_BLOCK];
+
+        if(grp->load) {
+            for(int j=0; j<cnt; j++)
+                m[j] = rows[j][w];
+            for(int j=0; j<cnt; j++)
+                m[j] = WORD_NTOH(m[j]);
+        }
+        else {
+            for(int j=0; j<cnt; j++)
+                m[j] = 0;
+        }
+
+        for(; op < op_end; op++) {
+            const WORD_T* c = columns[op->field_idx] + base;
+            WORD_T clear = ~op->clear;
+            WORD_T mask = op->mask;
+            int rs = op->rshift;
+            int ls = op->lshift;
+            for(int j=0; j<cnt; j++)
+                m[j] = (m[j] & clear) | (((c[j] >> rs) << ls) & mask);
+        }
+
+        for(int j=0; j<cnt; j++)
+            m[j] = WORD_HTON(m[j]);
+        for(int j=0; j<cnt; j++)
+            rows[j][w] = m[j];
+    }
+}
+
+
+static inline __attribute__((always_inline))
+void decode_block_generic(const message_layout_t* layout,
+                          const WORD_T* const rows[], int cnt,
+                          WORD_T* const columns[], size_t base) {
+
+    for(int g=0; g<layout->group_cnt; g++) {
+        const field_group_t* grp = &layout->groups[g];
+        const field_op_t* op = &layout->ops[grp->op_start];
+        const field_op_t* op_end = op + grp->op_cnt;
+        int w = grp->word_idx;
+        WORD_T m[COLUMN_BLOCK];
+
+        for(int j=0; j<cnt; j++)
+            m[j] = rows[j][w];
+        for(int j=0; j<cnt; j++)
+            m[j] = WORD_NTOH(m[j]);
+
+        for(; op < op_end; op++) {
+            WORD_T* c = columns[op->field_idx] + base;
+            WORD_T keep = op->keep;
+            WORD_T mask = op->mask;
+            int rs = op->rshift;
+            int ls = op->lshift;
+            for(int j=0; j<cnt; j++)
+                c[j] = (c[j] & keep) | (((m[j] & mask) >> ls) << rs);
+        }
+    }
+}
+
+
+// Instantiates the exported kernels of one instruction set. Full blocks
+// get their own copy with a constant trip count. swap_words converts
+// messages between host- and network-byte-order, its loop is vectorized
+// to byte shuffles.
+#define DEFINE_COLUMN_KERNELS(suffix)                                       \
+void encode_block_##suffix(const message_layout_t* layout,                  \
+        WORD_T* const rows[], int cnt,                                      \
+        const WORD_T* const columns[], size_t base) {                       \
+    if(cnt == COLUMN_BLOCK)                                                 \
+        encode_block_generic(layout, rows, COLUMN_BLOCK, columns, base);    \
+    else                                                                    \
+        encode_block_generic(layout, rows, cnt, columns, base);             \
+}                                                                           \
+void decode_block_##suffix(const message_layout_t* layout,                  \
+        const WORD_T* const rows[], int cnt,                                \
+        WORD_T* const columns[], size_t base) {                             \
+    if(cnt == COLUMN_BLOCK)                                                 \
+        decode_block_generic(layout, rows, COLUMN_BLOCK, columns, base);    \
+    else                                                                    \
+        decode_block_generic(layout, rows, cnt, columns, base);             \
+}                                                                           \
+void swap_words_##suffix(WORD_T words[], int64_t word_len) {                \
+    for(int64_t i=0; i<word_len; i++)                                       \
+        words[i] = WORD_HTON(words[i]);                                     \
+}
+
+#endif
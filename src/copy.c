@@ -0,0 +1,404 @@
+/// @file copy.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "kernels.h"
+#include "trace.h"
+
+
+// Word of the src bits b to b + word len - 1 in host-byte-order, b may be
+// negative. Bits outside src are 0.
+static inline WORD_T load_src_bits(const WORD_T src[], int64_t src_len,
+                                   int64_t b) {
+    int64_t j = (b >= 0 ? b / WORD_BIT_LEN : -((-b + WORD_BIT_LEN - 1) /
+                                               WORD_BIT_LEN));
+    int off = b - j * WORD_BIT_LEN;
+    WORD_T v = (j >= 0 && j < src_len ? WORD_NTOH(src[j]) : 0);
+    if(off != 0) {
+        WORD_T n = (j + 1 >= 0 && j + 1 < src_len ? WORD_NTOH(src[j + 1]) : 0);
+        v = (v << off) | (n >> (WORD_BIT_LEN - off));
+    }
+    return v;
+}
+
+// Stores the bits of v selected by mask into message word k.
+static inline void store_masked(WORD_T message[], int64_t k, WORD_T v,
+                                WORD_T mask) {
+    if(mask != ~(WORD_T)0)
+        v = (WORD_NTOH(message[k]) & ~mask) | (v & mask);
+    message[k] = WORD_HTON(v);
+}
+
+// Mask of the bits of message word k inside the range [start_bit, end_bit).
+static inline WORD_T range_mask(int64_t k, int64_t start_bit,
+                                int64_t end_bit) {
+    WORD_T mask = ~(WORD_T)0;
+    if(start_bit > k * WORD_BIT_LEN)
+        mask >>= start_bit - k * WORD_BIT_LEN;
+    if(end_bit < (k + 1) * WORD_BIT_LEN)
+        mask &= ~(~(WORD_T)0 >> (end_bit - k * WORD_BIT_LEN));
+    return mask;
+}
+
+
+// Copies the bits of dst word k inside [dst_bit, end_bit) from src, which
+// is delta bits ahead.
+static inline void copy_edge_word(WORD_T dst[], int64_t k, int64_t dst_bit,
+                                  int64_t end_bit, const WORD_T src[],
+                                  int64_t src_len, int64_t delta) {
+    store_masked(dst, k, load_src_bits(src, src_len,
+                 k * WORD_BIT_LEN + delta), range_mask(k, dst_bit, end_bit));
+}
+
+
+// Validates a range of a message, 0 if valid.
+static int range_error(int64_t message_len, int64_t start_bit,
+                       int64_t bit_len) {
+    if(start_bit < 0 || start_bit >= message_len * WORD_BIT_LEN)
+        return -1;
+    if(bit_len < 0)
+        return -2;
+    if(bit_len > message_len * WORD_BIT_LEN - start_bit)
+        return -3;
+    return 0;
+}
+
+
+/**
+ * copy_message_bits copies a bit range from one binary message to another
+ * at a different bit offset in a single pass, without a temporary buffer.
+ * Each destination word is funnel shifted from two source words (using
+ * vector instructions if available), only the first and last destination
+ * word need a masked read-modify-write. The
+ * ranges may overlap, also inside one message (like memmove).
+ * @param[out] dst          Destination message array of n words
+ * @param[in] dst_len       Number of words in dst
+ * @param[in] dst_bit       Absolute bit position in dst where bits are copied
+ *                          to
+ * @param[in] src           Source message array of n words, may be dst
+ * @param[in] src_len       Number of words in src
+ * @param[in] src_bit       Absolute bit position in src where bits are copied
+ *                          from
+ * @param[in] bit_len       Number of bits to copy
+ * @returns                 Positive integer of bit position in dst following
+ *                          the copied bits.
+ *                          -1 if dst_bit is outside dst (-10 src_bit outside
+ *                          src).
+ *                          -2 if bit_len is negative.
+ *                          -3 if the range spans over the end of dst (-30 of
+ *                          src).
+ */
+int copy_message_bits(WORD_T dst[], int dst_len, int dst_bit,
+                      const WORD_T src[], int src_len, int src_bit,
+                      int bit_len) {
+    return (int)copy_message_bits_l(dst, dst_len, dst_bit, src, src_len,
+                                    src_bit, bit_len);
+}
+
+
+// copy_message_bits_l without tracing.
+int64_t do_copy_message_bits_l(WORD_T dst[], int64_t dst_len, int64_t dst_bit,
+                               const WORD_T src[], int64_t src_len,
+                               int64_t src_bit, int64_t bit_len) {
+    int rtc = range_error(dst_len, dst_bit, bit_len);
+    if(rtc < 0)
+        return rtc;
+    if((rtc = range_error(src_len, src_bit, bit_len)) < 0)
+        return rtc * 10;
+
+    int64_t end_bit = dst_bit + bit_len;
+    if(bit_len == 0)
+        return end_bit;
+
+    int64_t first = dst_bit / WORD_BIT_LEN;
+    int64_t last = (end_bit - 1) / WORD_BIT_LEN;
+    int64_t delta = src_bit - dst_bit;
+
+    // Words between first and last take the bits of src words k + jo and
+    // k + jo + 1 at a fixed offset and are copied by the bulk kernel.
+    int64_t jo = (delta >= 0 ? delta / WORD_BIT_LEN :
+                  -((-delta + WORD_BIT_LEN - 1) / WORD_BIT_LEN));
+    int off = delta - jo * WORD_BIT_LEN;
+    int64_t middle = last - first - 1;
+
+    // Copy backwards if dst is behind src in memory, so overlapping source
+    // words are read before they are overwritten.
+    bool backwards = ((uintptr_t)&dst[first + 1] >
+                      (uintptr_t)&src[first + 1 + jo]);
+
+    if(!backwards) {
+        copy_edge_word(dst, first, dst_bit, end_bit, src, src_len, delta);
+        if(middle > 0)
+            bitter_kernels.copy(&dst[first + 1], &src[first + 1 + jo], off,
+                                middle, false);
+        if(last > first)
+            copy_edge_word(dst, last, dst_bit, end_bit, src, src_len, delta);
+    }
+    else {
+        if(last > first)
+            copy_edge_word(dst, last, dst_bit, end_bit, src, src_len, delta);
+        if(middle > 0)
+            bitter_kernels.copy(&dst[first + 1], &src[first + 1 + jo], off,
+                                middle, true);
+        copy_edge_word(dst, first, dst_bit, end_bit, src, src_len, delta);
+    }
+
+    // Return next bit position.
+    return end_bit;
+}
+
+
+/**
+ * copy_message_bits_l - same as copy_message_bits but with 64 bit message
+ * lengths, bit positions and lengths for messages larger than 2^31 bits.
+ */
+int64_t copy_message_bits_l(WORD_T dst[], int64_t dst_len, int64_t dst_bit,
+                            const WORD_T src[], int64_t src_len,
+                            int64_t src_bit, int64_t bit_len) {
+    int64_t rtc = do_copy_message_bits_l(dst, dst_len, dst_bit, src, src_len,
+                                         src_bit, bit_len);
+    TRACE(BITTER_TRACE_COPY_BITS, dst_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// Word of pattern repeated, starting at bit phase (0 <= phase < pattern_len)
+// of pattern. The pattern is rotated to the phase and then doubled until it
+// fills the word.
+static WORD_T pattern_word(WORD_T pattern, int pattern_len, int phase) {
+    if(phase != 0) {
+        pattern = (pattern << phase) | (pattern >> (pattern_len - phase));
+        if(pattern_len < WORD_BIT_LEN)
+            pattern &= ((WORD_T)1 << pattern_len) - 1;
+    }
+    WORD_T v = pattern << (WORD_BIT_LEN - pattern_len);
+    for(int len=pattern_len; len<WORD_BIT_LEN; len*=2)
+        v |= v >> len;
+    return v;
+}
+
+
+/**
+ * fill_message_bits fills a bit range of a binary message with a repeated
+ * bit pattern, e.g. all ones or HDLC idle flags. Words inside the range are
+ * written without reading them.
+ * @param[in,out] message   Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where the range starts
+ * @param[in] bit_len       Number of bits of the range
+ * @param[in] pattern       Pattern (in the lower bits), its MSB is written to
+ *                          start_bit
+ * @param[in] pattern_len   Number of bits (1-n) of pattern
+ * @returns                 Positive integer of bit position in message
+ *                          following the range.
+ *                          -1 if start_bit is outside message.
+ *                          -2 if bit_len or pattern_len is out of range.
+ *                          -3 if the range spans over the end of message.
+ */
+int fill_message_bits(WORD_T message[], int message_len, int start_bit,
+                      int bit_len, WORD_T pattern, int pattern_len) {
+    return (int)fill_message_bits_l(message, message_len, start_bit, bit_len,
+                                    pattern, pattern_len);
+}
+
+
+// fill_message_bits_l without tracing.
+int64_t do_fill_message_bits_l(WORD_T message[], int64_t message_len,
+                               int64_t start_bit, int64_t bit_len,
+                               WORD_T pattern, int pattern_len) {
+    int rtc = range_error(message_len, start_bit, bit_len);
+    if(rtc < 0)
+        return rtc;
+    if(pattern_len < 1 || pattern_len > WORD_BIT_LEN)
+        return -2;
+
+    int64_t end_bit = start_bit + bit_len;
+    if(bit_len == 0)
+        return end_bit;
+    if(pattern_len < WORD_BIT_LEN)
+        pattern &= ((WORD_T)1 << pattern_len) - 1;
+
+    int64_t first = start_bit / WORD_BIT_LEN;
+    int64_t last = (end_bit - 1) / WORD_BIT_LEN;
+
+    // Pattern bit at the first bit of word k, continued word by word.
+    int64_t phase = (first * WORD_BIT_LEN - start_bit) % pattern_len;
+    if(phase < 0)
+        phase += pattern_len;
+    int step = WORD_BIT_LEN % pattern_len;
+
+    for(int64_t k=first; k<=last; k++) {
+        WORD_T v = pattern_word(pattern, pattern_len, phase);
+        if(k == first || k == last)
+            store_masked(message, k, v, range_mask(k, start_bit, end_bit));
+        else
+            message[k] = WORD_HTON(v);
+        phase += step;
+        if(phase >= pattern_len)
+            phase -= pattern_len;
+    }
+
+    // Return next bit position.
+    return end_bit;
+}
+
+
+/**
+ * fill_message_bits_l - same as fill_message_bits but with 64 bit message
+ * length, bit positions and lengths for messages larger than 2^31 bits.
+ */
+int64_t fill_message_bits_l(WORD_T message[], int64_t message_len,
+                            int64_t start_bit, int64_t bit_len,
+                            WORD_T pattern, int pattern_len) {
+    int64_t rtc = do_fill_message_bits_l(message, message_len, start_bit,
+                                         bit_len, pattern, pattern_len);
+    TRACE(BITTER_TRACE_FILL_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+/**
+ * clear_message_bits sets a bit range of a binary message to 0.
+ * @param[in,out] message   Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where the range starts
+ * @param[in] bit_len       Number of bits of the range
+ * @returns                 Positive integer of bit position in message
+ *                          following the range, negative value in case of
+ *                          error (see fill_message_bits)
+ */
+int clear_message_bits(WORD_T message[], int message_len, int start_bit,
+                       int bit_len) {
+    return (int)clear_message_bits_l(message, message_len, start_bit,
+                                     bit_len);
+}
+
+
+/**
+ * clear_message_bits_l - same as clear_message_bits but with 64 bit message
+ * length, bit positions and lengths for messages larger than 2^31 bits.
+ */
+int64_t clear_message_bits_l(WORD_T message[], int64_t message_len,
+                             int64_t start_bit, int64_t bit_len) {
+    int64_t rtc = do_fill_message_bits_l(message, message_len, start_bit,
+                                         bit_len, 0, 1);
+    TRACE(BITTER_TRACE_CLEAR_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+/**
+ * insert_message_bits inserts a range of 0 bits into a binary message,
+ * e.g. when a variable length field grows. The bits from start_bit on are
+ * shifted right by bit_len bits with a single pass of word wide funnel
+ * shifts (see copy_message_bits), bits shifted over the end of the message
+ * are lost.
+ * @param[in,out] message   Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where bits are inserted
+ * @param[in] bit_len       Number of bits to insert
+ * @returns                 Positive integer of bit position in message
+ *                          following the inserted bits.
+ *                          -1 if start_bit is outside message.
+ *                          -2 if bit_len is negative.
+ *                          -3 if the inserted bits span over the end of
+ *                          message.
+ */
+int insert_message_bits(WORD_T message[], int message_len, int start_bit,
+                        int bit_len) {
+    return (int)insert_message_bits_l(message, message_len, start_bit,
+                                      bit_len);
+}
+
+
+// insert_message_bits_l without tracing.
+static int64_t do_insert_message_bits_l(WORD_T message[], int64_t message_len,
+                                        int64_t start_bit, int64_t bit_len) {
+    int rtc = range_error(message_len, start_bit, bit_len);
+    if(rtc < 0)
+        return rtc;
+
+    int64_t tail = message_len * WORD_BIT_LEN - start_bit - bit_len;
+    if(tail > 0)
+        do_copy_message_bits_l(message, message_len, start_bit + bit_len,
+                               message, message_len, start_bit, tail);
+    if(bit_len > 0)
+        do_fill_message_bits_l(message, message_len, start_bit, bit_len,
+                               0, 1);
+
+    // Return next bit position.
+    return start_bit + bit_len;
+}
+
+
+/**
+ * insert_message_bits_l - same as insert_message_bits but with 64 bit
+ * message length, bit positions and lengths for messages larger than 2^31
+ * bits.
+ */
+int64_t insert_message_bits_l(WORD_T message[], int64_t message_len,
+                              int64_t start_bit, int64_t bit_len) {
+    int64_t rtc = do_insert_message_bits_l(message, message_len, start_bit,
+                                           bit_len);
+    TRACE(BITTER_TRACE_INSERT_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+/**
+ * delete_message_bits removes a bit range from a binary message, e.g. when
+ * a variable length field shrinks. The bits after the range are shifted
+ * left by bit_len bits, the bits freed at the end of the message are set
+ * to 0.
+ * @param[in,out] message   Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of the first bit to delete
+ * @param[in] bit_len       Number of bits to delete
+ * @returns                 start_bit, negative value in case of error (see
+ *                          insert_message_bits)
+ */
+int delete_message_bits(WORD_T message[], int message_len, int start_bit,
+                        int bit_len) {
+    return (int)delete_message_bits_l(message, message_len, start_bit,
+                                      bit_len);
+}
+
+
+// delete_message_bits_l without tracing.
+static int64_t do_delete_message_bits_l(WORD_T message[], int64_t message_len,
+                                        int64_t start_bit, int64_t bit_len) {
+    int rtc = range_error(message_len, start_bit, bit_len);
+    if(rtc < 0)
+        return rtc;
+
+    int64_t message_bits = message_len * WORD_BIT_LEN;
+    int64_t tail = message_bits - start_bit - bit_len;
+    if(tail > 0)
+        do_copy_message_bits_l(message, message_len, start_bit, message,
+                               message_len, start_bit + bit_len, tail);
+    if(bit_len > 0)
+        do_fill_message_bits_l(message, message_len, message_bits - bit_len,
+                               bit_len, 0, 1);
+    return start_bit;
+}
+
+
+/**
+ * delete_message_bits_l - same as delete_message_bits but with 64 bit
+ * message length, bit positions and lengths for messages larger than 2^31
+ * bits.
+ */
+int64_t delete_message_bits_l(WORD_T message[], int64_t message_len,
+                              int64_t start_bit, int64_t bit_len) {
+    int64_t rtc = do_delete_message_bits_l(message, message_len, start_bit,
+                                           bit_len);
+    TRACE(BITTER_TRACE_DELETE_BITS, start_bit, bit_len, rtc);
+    return rtc;
+}
@@ -0,0 +1,135 @@
+/// @file cpu.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "bitter.h"
+#include "kernels.h"
+
+
+#define KERNELS(isa, single, bulk, columns, crc) {                          \
+    .name = isa,                                                            \
+    .set_bits = set_bits_##single,                                          \
+    .get_bits = get_bits_##single,                                          \
+    .set_bits_h = set_bits_h_##single,                                      \
+    .get_bits_h = get_bits_h_##single,                                      \
+    .insert = bits_insert_##bulk,                                           \
+    .insert_bytes = bits_insert_bytes_##bulk,                               \
+    .extract = bits_extract_##bulk,                                         \
+    .extract_bytes = bits_extract_bytes_##bulk,                             \
+    .copy = bits_copy_##bulk,                                               \
+    .encode_block = encode_block_##columns,                                 \
+    .decode_block = decode_block_##columns,                                 \
+    .swap_words = swap_words_##columns,                                     \
+    .crc_words = crc_words_##crc,                                           \
+}
+
+// Kernel sets, ordered from lowest to highest instruction set level.
+// The NEON bulk kernels of bulk_neon.c are built on aarch64, but not
+// selected until they were tested against the scalar kernels there.
+static const bitter_kernels_t isa_kernels[] = {
+    KERNELS("scalar", scalar, scalar, scalar, scalar),
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+    KERNELS("bmi2", bmi2, scalar, scalar, clmul),
+    KERNELS("avx2", bmi2, avx2, avx2, clmul),
+    KERNELS("avx512", bmi2, avx512, avx512, clmul),
+#endif
+};
+#define ISA_CNT (int)(sizeof(isa_kernels) / sizeof(isa_kernels[0]))
+
+// Portable kernels are used until the CPU was inspected.
+bitter_kernels_t bitter_kernels = KERNELS("scalar", scalar, scalar, scalar,
+                                          scalar);
+
+// Highest kernel set level supported by the CPU.
+static int isa_max = 0;
+
+
+// Checks if the CPU supports all instructions used by a kernel set.
+static bool isa_supported(const char* isa) {
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+    __builtin_cpu_init();
+    // All CPUs with BMI2 have PCLMULQDQ used by the CRC kernels too.
+    if(strcmp(isa, "bmi2") == 0)
+        return __builtin_cpu_supports("bmi") &&
+               __builtin_cpu_supports("bmi2") &&
+               __builtin_cpu_supports("pclmul");
+    if(strcmp(isa, "avx2") == 0)
+        return isa_supported("bmi2") && __builtin_cpu_supports("avx2");
+    if(strcmp(isa, "avx512") == 0)
+        return isa_supported("bmi2") &&
+               __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512bw");
+#endif
+    // Scalar kernels run everywhere.
+    return true;
+}
+
+
+/**
+ * bitter_set_isa - Selects the kernels of an instruction set. Intended to
+ * compare the different implementations; must not be called while other
+ * threads use bitter functions.
+ * @param[in] isa   "scalar", "bmi2", "avx2" or "avx512"
+ * @return          0 on success, -1 if isa is unknown or not supported by
+ *                  the CPU
+ */
+int bitter_set_isa(const char* isa) {
+    for(int i=0; i<=isa_max; i++) {
+        if(strcmp(isa_kernels[i].name, isa) == 0) {
+            bitter_kernels = isa_kernels[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * bitter_isa - Name of the instruction set used by the bitter kernels.
+ * @return          "scalar", "bmi2", "avx2" or "avx512"
+ */
+const char* bitter_isa(void) {
+    return bitter_kernels.name;
+}
+
+
+/**
+ * bitter_isa_list - Names of all instruction sets supported by the CPU.
+ * @param[out] cnt  Receives number of names
+ * @return          Array of names, lowest instruction set first
+ */
+const char* const* bitter_isa_list(int* cnt) {
+    static const char* names[ISA_CNT];
+    for(int i=0; i<=isa_max; i++)
+        names[i] = isa_kernels[i].name;
+    if(cnt != NULL)
+        *cnt = isa_max + 1;
+    return names;
+}
+
+
+/*
+ * select_kernels - runs once when the library is loaded and selects the
+ * best kernels for the instruction sets supported by the CPU, so the same
+ * library binary can be used on all hosts of an architecture.
+ * The environment variable BITTER_ISA overrides the selection, e.g. to
+ * compare implementations in production.
+ */
+__attribute__((constructor))
+static void select_kernels(void) {
+    for(int i=1; i<ISA_CNT; i++) {
+        if(!isa_supported(isa_kernels[i].name))
+            break;
+        isa_max = i;
+    }
+    bitter_kernels = isa_kernels[isa_max];
+
+    const char* env = getenv("BITTER_ISA");
+    if(env != NULL && *env != '\0' && bitter_set_isa(env) < 0)
+        fprintf(stderr, "bitter: BITTER_ISA '%s' not supported, using '%s'\n",
+            env, bitter_kernels.name);
+}
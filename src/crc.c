@@ -0,0 +1,344 @@
+/// @file crc.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "bitter.h"
+#include "trace.h"
+#include "crc_impl.h"
+
+
+/*
+ * Portable CRC kernel. See crc_impl.h for the implementation.
+ *
+ * crc_words - feeds word_cnt words of message bits starting at bit offset
+ * mo of message word 0 into the CRC register, one slice-by-8 step per word.
+ */
+DEFINE_CRC_KERNELS(scalar)
+
+
+// Parameters of the crc_init_preset presets, see the CRC catalogue of
+// Greg Cook for check values.
+typedef struct {
+    int width;
+    uint64_t poly;
+    uint64_t init;
+    bool reflect_in;
+    bool reflect_out;
+    uint64_t xor_out;
+} crc_preset_t;
+
+static const crc_preset_t crc_presets[] = {
+    [CRC_15_CAN] = { 15, 0x4599, 0, false, false, 0 },
+    [CRC_16_HDLC] = { 16, 0x1021, 0xFFFF, true, true, 0xFFFF },
+    [CRC_16_CCITT_FALSE] = { 16, 0x1021, 0xFFFF, false, false, 0 },
+    [CRC_24Q] = { 24, 0x864CFB, 0, false, false, 0 },
+    [CRC_32] = { 32, 0x04C11DB7, 0xFFFFFFFF, true, true, 0xFFFFFFFF },
+    [CRC_32C] = { 32, 0x1EDC6F41, 0xFFFFFFFF, true, true, 0xFFFFFFFF },
+    [CRC_64_XZ] = { 64, 0x42F0E1EBA9EA3693ULL, ~0ULL, true, true, ~0ULL },
+};
+#define PRESET_CNT (int)(sizeof(crc_presets) / sizeof(crc_presets[0]))
+
+
+// Mask with the <width> least significant bits set.
+static uint64_t width_mask(int width) {
+    return (width == 64 ? ~0ULL : (1ULL << width) - 1);
+}
+
+// Polynomial MSB aligned to the register, the x^width term is implicit.
+static uint64_t reg_poly(const crc_t* crc) {
+    return crc->poly << (64 - crc->width);
+}
+
+// Multiplies the register by x, i.e. feeds one 0 bit.
+static inline uint64_t reg_mul_x(uint64_t reg, uint64_t poly) {
+    return ((reg >> 63) ? (reg << 1) ^ poly : reg << 1);
+}
+
+// Product a * b modulo the MSB aligned polynomial.
+static uint64_t reg_mul(uint64_t a, uint64_t b, uint64_t poly) {
+    uint64_t r = 0;
+    for(int i=63; i>=0; i--) {
+        r = reg_mul_x(r, poly);
+        if((b >> i) & 1)
+            r ^= a;
+    }
+    return r;
+}
+
+// x^n modulo the MSB aligned polynomial for small n.
+static uint64_t reg_x_pow(int n, uint64_t poly) {
+    uint64_t r = 1;
+    for(int i=0; i<n; i++)
+        r = reg_mul_x(r, poly);
+    return r;
+}
+
+
+/**
+ * crc_init - computes the tables of a CRC.
+ * @param[out] crc          CRC to initialize
+ * @param[in] width         Number of CRC bits, 1 to 64
+ * @param[in] poly          Polynomial without the x^width term, e.g.
+ *                          0x04C11DB7 for CRC-32
+ * @param[in] init          Initial register value
+ * @param[in] reflect_in    If true, the bits of each byte are fed least
+ *                          significant bit first
+ * @param[in] reflect_out   If true, the register is reflected before xor_out
+ * @param[in] xor_out       Value xored to the final register value
+ * @returns                 0 on success, -1 if crc is NULL or width is not
+ *                          1 to 64
+ */
+int crc_init(crc_t* crc, int width, uint64_t poly, uint64_t init,
+             bool reflect_in, bool reflect_out, uint64_t xor_out) {
+    if(crc == NULL || width < 1 || width > 64)
+        return -1;
+
+    uint64_t mask = width_mask(width);
+    crc->width = width;
+    crc->poly = poly & mask;
+    crc->init = init & mask;
+    crc->reflect_in = reflect_in;
+    crc->reflect_out = reflect_out;
+    crc->xor_out = xor_out & mask;
+
+    uint64_t p = reg_poly(crc);
+    for(int b=0; b<256; b++) {
+        uint64_t r = (uint64_t)b << 56;
+        for(int i=0; i<8; i++)
+            r = reg_mul_x(r, p);
+        crc->table[0][b] = r;
+    }
+    // Table k feeds a byte followed by k zero bytes.
+    for(int k=1; k<8; k++) {
+        for(int b=0; b<256; b++) {
+            uint64_t r = crc->table[k - 1][b];
+            crc->table[k][b] = (r << 8) ^ crc->table[0][r >> 56];
+        }
+    }
+
+    crc->fold[0] = reg_x_pow(576, p);
+    crc->fold[1] = reg_x_pow(512, p);
+    crc->fold[2] = reg_x_pow(192, p);
+    crc->fold[3] = reg_x_pow(128, p);
+    crc->zeros[0] = reg_x_pow(1, p);
+    for(int k=1; k<63; k++)
+        crc->zeros[k] = reg_mul(crc->zeros[k - 1], crc->zeros[k - 1], p);
+    return 0;
+}
+
+
+/**
+ * crc_init_preset - computes the tables of a well known CRC.
+ * @param[out] crc          CRC to initialize
+ * @param[in] preset        CRC_15_CAN, CRC_16_HDLC, CRC_16_CCITT_FALSE,
+ *                          CRC_24Q, CRC_32, CRC_32C or CRC_64_XZ
+ * @returns                 0 on success, -1 if crc is NULL or preset is
+ *                          unknown
+ */
+int crc_init_preset(crc_t* crc, int preset) {
+    if(preset < 1 || preset >= PRESET_CNT)
+        return -1;
+    const crc_preset_t* p = &crc_presets[preset];
+    return crc_init(crc, p->width, p->poly, p->init, p->reflect_in,
+                    p->reflect_out, p->xor_out);
+}
+
+
+/*
+ * Feeds bit_len message bits starting at start_bit into the register.
+ * Whole words are handled by the CRC kernel, the remaining bytes by table
+ * 0 and the last 0-7 bits one by one. With reflect_in the last bits are
+ * reflected as a value of their own length.
+ */
+static uint64_t crc_bits(const crc_t* crc, uint64_t reg,
+                         const WORD_T message[], int64_t start_bit,
+                         int64_t bit_len) {
+    int64_t mbi = start_bit / WORD_BIT_LEN;
+    int mo = start_bit % WORD_BIT_LEN;
+
+    int64_t word_cnt = bit_len / WORD_BIT_LEN;
+    if(word_cnt > 0)
+        reg = bitter_kernels.crc_words(crc, reg, &message[mbi], mo, word_cnt);
+    mbi += word_cnt;
+
+    int rest = bit_len % WORD_BIT_LEN;
+    if(rest == 0)
+        return reg;
+
+    WORD_T v = WORD_NTOH(message[mbi]) << mo;
+    if(mo + rest > WORD_BIT_LEN)
+        v |= WORD_NTOH(message[mbi + 1]) >> (WORD_BIT_LEN - mo);
+    uint64_t t = (uint64_t)v << (64 - WORD_BIT_LEN);
+
+    for(; rest >= 8; rest -= 8, t <<= 8) {
+        uint64_t b = t >> 56;
+        if(crc->reflect_in)
+            b = reflect_bytes(b);
+        reg = (reg << 8) ^ crc->table[0][(reg >> 56) ^ b];
+    }
+    if(rest > 0) {
+        uint64_t b = t >> (64 - rest);
+        if(crc->reflect_in)
+            b = reflect_bytes(b) >> (8 - rest);
+        uint64_t p = reg_poly(crc);
+        for(int i=rest-1; i>=0; i--)
+            reg = reg_mul_x(reg ^ (((b >> i) & 1) << 63), p);
+    }
+    return reg;
+}
+
+
+// CRC value of the register without xor_out.
+static uint64_t crc_result(const crc_t* crc, uint64_t reg) {
+    if(crc->reflect_out)
+        return reflect_bytes(__builtin_bswap64(reg)) & width_mask(crc->width);
+    return reg >> (64 - crc->width);
+}
+
+
+/**
+ * message_crc computes the CRC over an arbitrary bit range of a binary
+ * message without copying the range. The range neither needs to start nor
+ * to end on a byte boundary. Bits are fed in message order, with
+ * reflect_in the bits of each byte (counted from start_bit) are fed least
+ * significant bit first, trailing bits of a partial byte as a value of
+ * their own length.
+ * @param[in] crc           CRC initialized by crc_init or crc_init_preset
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of the first bit of the
+ *                          range
+ * @param[in] bit_len       Number of bits of the range
+ * @param[out] value        Receives the CRC, may be NULL
+ * @returns                 Positive integer of bit position in message
+ *                          following the range.
+ *                          -1 if start_bit is outside message or crc is NULL.
+ *                          -2 if bit_len is negative.
+ *                          -3 if the range spans over the end of message.
+ */
+int message_crc(const crc_t* crc, const WORD_T message[], int message_len,
+                int start_bit, int bit_len, uint64_t* value) {
+    return (int)message_crc_l(crc, message, message_len, start_bit, bit_len,
+                              value);
+}
+
+
+// message_crc_l without tracing.
+static int64_t do_message_crc_l(const crc_t* crc, const WORD_T message[],
+                                int64_t message_len, int64_t start_bit,
+                                int64_t bit_len, uint64_t* value) {
+    int64_t msg_bits = message_len * WORD_BIT_LEN;
+
+    if(crc == NULL || start_bit < 0 || start_bit >= msg_bits)
+        return -1;
+    if(bit_len < 0)
+        return -2;
+    if(bit_len > msg_bits - start_bit)
+        return -3;
+
+    uint64_t reg = crc->init << (64 - crc->width);
+    reg = crc_bits(crc, reg, message, start_bit, bit_len);
+    if(value != NULL)
+        *value = crc_result(crc, reg) ^ crc->xor_out;
+
+    // Return next bit position.
+    return start_bit + bit_len;
+}
+
+
+/**
+ * message_crc_l - same as message_crc but with 64 bit message length, bit
+ * positions and lengths for messages larger than 2^31 bits.
+ */
+int64_t message_crc_l(const crc_t* crc, const WORD_T message[],
+                      int64_t message_len, int64_t start_bit, int64_t bit_len,
+                      uint64_t* value) {
+    int64_t rtc = do_message_crc_l(crc, message, message_len, start_bit,
+                                   bit_len, value);
+    TRACE(BITTER_TRACE_MESSAGE_CRC, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// message_crc_update without tracing.
+static int do_message_crc_update(const crc_t* crc, uint64_t* value,
+                                 int64_t start_bit, int64_t bit_len,
+                                 int64_t field_start_bit, int field_bit_len,
+                                 WORD_T old_value, WORD_T new_value) {
+    if(crc == NULL || value == NULL)
+        return -1;
+    if(field_bit_len < 0 || field_bit_len > WORD_BIT_LEN)
+        return -2;
+    if(start_bit < 0 || bit_len < 0 || field_start_bit < start_bit ||
+       field_start_bit - start_bit > bit_len - field_bit_len)
+        return -3;
+
+    WORD_T delta = old_value ^ new_value;
+    if(field_bit_len < WORD_BIT_LEN)
+        delta &= ((WORD_T)1 << field_bit_len) - 1;
+    if(field_bit_len == 0 || delta == 0)
+        return 0;
+
+    // Bytes of the range holding the field, with reflect_in bits are
+    // reflected per byte counted from start_bit.
+    int64_t o = field_start_bit - start_bit;
+    int64_t s = o & ~7;
+    int64_t e = (o + field_bit_len + 7) & ~7;
+    if(e > bit_len)
+        e = bit_len;
+    int p = o - s;
+
+    // Changed bits at their offset in a zero message of these bytes.
+    WORD_T d = delta << (WORD_BIT_LEN - field_bit_len);
+    WORD_T buf[2] = {
+        WORD_HTON(d >> p),
+        (p != 0 ? WORD_HTON(d << (WORD_BIT_LEN - p)) : 0)
+    };
+    uint64_t reg = crc_bits(crc, 0, buf, 0, e - s);
+
+    // Feed the remaining bits of the range as zeros.
+    uint64_t poly = reg_poly(crc);
+    uint64_t n = bit_len - e;
+    for(int k=0; n!=0; k++, n>>=1)
+        if(n & 1)
+            reg = reg_mul(reg, crc->zeros[k], poly);
+
+    *value ^= crc_result(crc, reg);
+    return 0;
+}
+
+
+/**
+ * message_crc_update - updates the CRC of a range after a single field in
+ * that range changed, without reading the message again. CRCs are affine,
+ * so the CRC changes by the CRC of the changed bits alone followed by the
+ * remaining bits of the range as zeros. Those are skipped in O(log n) by
+ * multiplying with x^n.
+ * @param[in] crc           CRC initialized by crc_init or crc_init_preset
+ * @param[in,out] value     CRC of the range computed by message_crc
+ * @param[in] start_bit     Absolute bit position of the first bit of the
+ *                          range
+ * @param[in] bit_len       Number of bits of the range
+ * @param[in] field_start_bit Absolute bit position of the changed field
+ * @param[in] field_bit_len Number of bits of the field, 0 to word len
+ * @param[in] old_value     Previous field value (in the lower bits)
+ * @param[in] new_value     New field value (in the lower bits)
+ * @returns                 0 on success.
+ *                          -1 if crc or value is NULL.
+ *                          -2 if field_bit_len is out of range.
+ *                          -3 if the field is not inside the range.
+ */
+int message_crc_update(const crc_t* crc, uint64_t* value,
+                       int64_t start_bit, int64_t bit_len,
+                       int64_t field_start_bit, int field_bit_len,
+                       WORD_T old_value, WORD_T new_value) {
+    int rtc = do_message_crc_update(crc, value, start_bit, bit_len,
+                                    field_start_bit, field_bit_len, old_value,
+                                    new_value);
+    TRACE(BITTER_TRACE_MESSAGE_CRC_UPDATE, field_start_bit, field_bit_len, rtc);
+    return rtc;
+}
@@ -0,0 +1,98 @@
+/// @file crc_clmul.c
+
+#include "bitter.h"
+
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+
+#pragma GCC target("pclmul,ssse3,sse4.1")
+#include <immintrin.h>
+
+#include "crc_impl.h"
+
+
+// Loads the 128 message bits starting at bit offset mo of message word k,
+// the first 64 bits in the upper lane. Reads message words k to k+2.
+static inline __m128i load_block_clmul(const WORD_T message[], int64_t k,
+                                       int mo, bool reflect) {
+    // Reversing all 16 bytes turns two network-byte-order words into one
+    // 128 bit host-byte-order value.
+    const __m128i rev = _mm_set_epi8(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i a = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*)&message[k]), rev);
+    __m128i b = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*)&message[k + 1]), rev);
+    // A shift count of 64 (mo == 0) yields 0.
+    __m128i v = _mm_or_si128(_mm_sll_epi64(a, _mm_cvtsi32_si128(mo)),
+        _mm_srl_epi64(b, _mm_cvtsi32_si128(WORD_BIT_LEN - mo)));
+
+    if(reflect) {
+        // Reflects the bits of each byte by two nibble lookups.
+        const __m128i nibbles = _mm_set_epi8(
+            15, 7, 11, 3, 13, 5, 9, 1, 14, 6, 10, 2, 12, 4, 8, 0);
+        const __m128i low = _mm_set1_epi8(0x0F);
+        __m128i lo = _mm_shuffle_epi8(nibbles, _mm_and_si128(v, low));
+        __m128i hi = _mm_shuffle_epi8(nibbles,
+            _mm_and_si128(_mm_srli_epi16(v, 4), low));
+        v = _mm_or_si128(_mm_slli_epi16(lo, 4), hi);
+    }
+    return v;
+}
+
+
+// Multiplies v = hi * x^64 + lo by x^d, k holding x^(d+64) in the lower
+// and x^d mod poly in the upper lane. The product is not reduced.
+static inline __m128i fold_clmul(__m128i v, __m128i k) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(v, k, 0x01),
+                         _mm_clmulepi64_si128(v, k, 0x10));
+}
+
+
+/*
+ * Folds 4 independent 128 bit lanes by 512 bits per iteration with
+ * PCLMULQDQ, hiding its latency, and keeps the products unreduced. The
+ * lanes are folded into one at the end, which is fed through the
+ * slice-by-8 tables. Loads read one word past the last block, so the last
+ * word of the range is always left to the portable kernel.
+ */
+uint64_t crc_words_clmul(const crc_t* crc, uint64_t reg,
+                         const WORD_T message[], int mo, int64_t word_cnt) {
+    if(word_cnt < 9)
+        return crc_words_scalar(crc, reg, message, mo, word_cnt);
+
+    bool reflect = crc->reflect_in;
+    const __m128i k512 = _mm_set_epi64x(crc->fold[1], crc->fold[0]);
+    const __m128i k128 = _mm_set_epi64x(crc->fold[3], crc->fold[2]);
+
+    __m128i v0 = load_block_clmul(message, 0, mo, reflect);
+    __m128i v1 = load_block_clmul(message, 2, mo, reflect);
+    __m128i v2 = load_block_clmul(message, 4, mo, reflect);
+    __m128i v3 = load_block_clmul(message, 6, mo, reflect);
+    v0 = _mm_xor_si128(v0, _mm_set_epi64x(reg, 0));
+
+    int64_t k = 8;
+    for(; k + 9 <= word_cnt; k += 8) {
+        v0 = _mm_xor_si128(fold_clmul(v0, k512),
+            load_block_clmul(message, k, mo, reflect));
+        v1 = _mm_xor_si128(fold_clmul(v1, k512),
+            load_block_clmul(message, k + 2, mo, reflect));
+        v2 = _mm_xor_si128(fold_clmul(v2, k512),
+            load_block_clmul(message, k + 4, mo, reflect));
+        v3 = _mm_xor_si128(fold_clmul(v3, k512),
+            load_block_clmul(message, k + 6, mo, reflect));
+    }
+
+    v1 = _mm_xor_si128(fold_clmul(v0, k128), v1);
+    v2 = _mm_xor_si128(fold_clmul(v1, k128), v2);
+    v3 = _mm_xor_si128(fold_clmul(v2, k128), v3);
+    for(; k + 3 <= word_cnt; k += 2)
+        v3 = _mm_xor_si128(fold_clmul(v3, k128),
+            load_block_clmul(message, k, mo, reflect));
+
+    // The folded lanes are already reflected.
+    reg = crc_step(crc, 0, _mm_extract_epi64(v3, 1));
+    reg = crc_step(crc, reg, _mm_extract_epi64(v3, 0));
+    return crc_words_scalar(crc, reg, &message[k], mo, word_cnt - k);
+}
+
+#endif
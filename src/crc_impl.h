@@ -0,0 +1,79 @@
+/// @file crc_impl.h
+/// Helpers shared by the CRC kernels. The CRC register is kept MSB aligned
+/// in bit 63 of a uint64_t for all widths, so one set of tables and one
+/// update step serve every polynomial. Reflected CRCs reflect the bits of
+/// each input byte and are otherwise computed like non reflected ones.
+
+#ifndef _CRC_IMPL_H_
+#define _CRC_IMPL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "kernels.h"
+
+
+// Reflects the bits of every byte of v.
+static inline __attribute__((always_inline))
+uint64_t reflect_bytes(uint64_t v) {
+    const uint64_t m1 = 0x5555555555555555ULL;
+    const uint64_t m2 = 0x3333333333333333ULL;
+    const uint64_t m4 = 0x0F0F0F0F0F0F0F0FULL;
+    v = ((v >> 1) & m1) | ((v & m1) << 1);
+    v = ((v >> 2) & m2) | ((v & m2) << 2);
+    v = ((v >> 4) & m4) | ((v & m4) << 4);
+    return v;
+}
+
+
+// Loads the word_bit_len message bits starting at bit offset mo of message
+// word k. Word k+1 is only read if mo is not 0.
+static inline __attribute__((always_inline))
+WORD_T load_chunk(const WORD_T message[], int64_t k, int mo) {
+    WORD_T v = WORD_NTOH(message[k]);
+    if(mo != 0)
+        v = (v << mo) | (WORD_NTOH(message[k + 1]) >> (WORD_BIT_LEN - mo));
+    return v;
+}
+
+
+// Feeds one word of bits (already reflected if reflect_in) into the
+// register using one table lookup per byte (slice-by-8 for 64 bit words).
+static inline __attribute__((always_inline))
+uint64_t crc_step(const crc_t* crc, uint64_t reg, WORD_T chunk) {
+    uint64_t x = reg ^ ((uint64_t)chunk << (64 - WORD_BIT_LEN));
+#if WORD_BIT_LEN == 64
+    // Independent lookups, written out as GCC does not unroll at -O2.
+    return crc->table[7][x >> 56] ^ crc->table[6][(x >> 48) & 0xFF] ^
+           crc->table[5][(x >> 40) & 0xFF] ^ crc->table[4][(x >> 32) & 0xFF] ^
+           crc->table[3][(x >> 24) & 0xFF] ^ crc->table[2][(x >> 16) & 0xFF] ^
+           crc->table[1][(x >> 8) & 0xFF] ^ crc->table[0][x & 0xFF];
+#else
+    uint64_t r = reg << WORD_BIT_LEN;
+    for(int k=0; k<(int)WORD_BYTE_LEN; k++)
+        r ^= crc->table[WORD_BYTE_LEN - 1 - k][(x >> (56 - 8 * k)) & 0xFF];
+    return r;
+#endif
+}
+
+
+// Instantiates the portable CRC kernel.
+#define DEFINE_CRC_KERNELS(suffix)                                          \
+uint64_t crc_words_##suffix(const crc_t* crc, uint64_t reg,                 \
+        const WORD_T message[], int mo, int64_t word_cnt) {                 \
+    if(crc->reflect_in) {                                                   \
+        for(int64_t k=0; k<word_cnt; k++)                                   \
+            reg = crc_step(crc, reg,                                        \
+                (WORD_T)reflect_bytes(load_chunk(message, k, mo)));         \
+    }                                                                       \
+    else {                                                                  \
+        for(int64_t k=0; k<word_cnt; k++)                                   \
+            reg = crc_step(crc, reg, load_chunk(message, k, mo));           \
+    }                                                                       \
+    return reg;                                                             \
+}
+
+#endif
@@ -0,0 +1,232 @@
+/// @file cursor.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "trace.h"
+
+
+// Mask with the <n> most significant bits of a word set (1 <= n <= word len).
+#define MASK_HIGH(n)    (~(WORD_T)0 << (WORD_BIT_LEN - (n)))
+
+
+/**
+ * bit_writer_init - prepares a cursor to sequentially append fields to a
+ * binary message starting at bit position start_bit.
+ * Bits in front of start_bit in the first message word are preserved.
+ * @param[out] writer       Cursor to initialize
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of first field to append
+ * @returns                 start_bit, negative value in case of error
+ */
+int bit_writer_init(bit_writer_t* writer, WORD_T message[], int message_len,
+                    int start_bit) {
+
+    int mbi = start_bit / WORD_BIT_LEN; // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;  // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+
+    writer->message = message;
+    writer->message_len = message_len;
+    writer->word_idx = mbi;
+    writer->bit_pos = start_bit;
+    writer->bits_free = message_len * WORD_BIT_LEN - start_bit;
+
+    // Keep bits in front of start position, they are written back together
+    // with the first appended field.
+    writer->acc = 0;
+    writer->acc_bits = mo;
+    if(mo > 0)
+        writer->acc = WORD_NTOH(message[mbi]) & MASK_HIGH(mo);
+
+    return start_bit;
+}
+
+
+// bit_writer_put without tracing.
+static int do_bit_writer_put(bit_writer_t* writer, int bit_len,
+                             const WORD_T value, bool start_low) {
+
+    // If bit length > message word len.
+    if(bit_len < 1 || bit_len > WORD_BIT_LEN)
+        return -2;
+    // If value spans over end of message.
+    if(bit_len > writer->bits_free)
+        return -3;
+
+    // Align value to MSB with all unwanted bits set to 0.
+    WORD_T v;
+    if(start_low)
+        v = value << (WORD_BIT_LEN - bit_len);
+    else
+        v = value & MASK_HIGH(bit_len);
+
+    int acc_bits = writer->acc_bits;
+    writer->acc |= v >> acc_bits;
+    acc_bits += bit_len;
+
+    // Word is filled; write it to message and keep remaining bits of value.
+    if(acc_bits >= WORD_BIT_LEN) {
+        writer->message[writer->word_idx] = WORD_HTON(writer->acc);
+        writer->word_idx++;
+        acc_bits -= WORD_BIT_LEN;
+        writer->acc = (acc_bits > 0 ? v << (bit_len - acc_bits) : 0);
+    }
+
+    writer->acc_bits = acc_bits;
+    writer->bits_free -= bit_len;
+    writer->bit_pos += bit_len;
+    return writer->bit_pos;
+}
+
+
+/**
+ * bit_writer_put - appends 1-n bits (where n is the word len) at the current
+ * cursor position. Bits are collected in the cursor accumulator and a message
+ * word is only written when it is completely filled. The range of bits
+ * written is always erased before, like set_message_bits with erase=true.
+ * Call bit_writer_flush to write a partially filled last word.
+ * @param[in] writer        Cursor initialized with bit_writer_init
+ * @param[in] bit_len       Number of bits (1-n) of value to append
+ * @param[in] value         A single word value to append bits from, starting
+ *                          at MSB of value
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in message where
+ *                          appended value ends, negative value in case of error
+ */
+int bit_writer_put(bit_writer_t* writer, int bit_len, const WORD_T value,
+                   bool start_low) {
+    int start_bit = writer->bit_pos;
+    int rtc = do_bit_writer_put(writer, bit_len, value, start_low);
+    TRACE(BITTER_TRACE_BIT_WRITER_PUT, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// bit_writer_flush without tracing.
+static int do_bit_writer_flush(bit_writer_t* writer) {
+    if(writer->acc_bits > 0) {
+        WORD_T m = WORD_NTOH(writer->message[writer->word_idx]);
+        m &= ~MASK_HIGH(writer->acc_bits);
+        m |= writer->acc;
+        writer->message[writer->word_idx] = WORD_HTON(m);
+    }
+
+    return writer->bit_pos;
+}
+
+
+/**
+ * bit_writer_flush - writes a partially filled accumulator word to the
+ * message. Bits following the cursor position in that word are preserved.
+ * The cursor stays valid, so further fields can be appended after a flush.
+ * @param[in] writer        Cursor initialized with bit_writer_init
+ * @returns                 Current cursor bit position
+ */
+int bit_writer_flush(bit_writer_t* writer) {
+    int bit_len = writer->acc_bits;
+    int rtc = do_bit_writer_flush(writer);
+    TRACE(BITTER_TRACE_BIT_WRITER_FLUSH, rtc - bit_len, bit_len, rtc);
+    return rtc;
+}
+
+
+/**
+ * bit_reader_init - prepares a cursor to sequentially extract fields from a
+ * binary message starting at bit position start_bit.
+ * @param[out] reader       Cursor to initialize
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of first field to extract
+ * @returns                 start_bit, negative value in case of error
+ */
+int bit_reader_init(bit_reader_t* reader, const WORD_T message[],
+                    int message_len, int start_bit) {
+
+    int mbi = start_bit / WORD_BIT_LEN; // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;  // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+
+    reader->message = message;
+    reader->message_len = message_len;
+    reader->bit_pos = start_bit;
+    reader->bits_left = message_len * WORD_BIT_LEN - start_bit;
+
+    // Preload first word with already consumed bits shifted out.
+    reader->acc = WORD_NTOH(message[mbi]) << mo;
+    reader->acc_bits = WORD_BIT_LEN - mo;
+    reader->word_idx = mbi + 1;
+
+    return start_bit;
+}
+
+
+// bit_reader_get without tracing.
+static int do_bit_reader_get(bit_reader_t* reader, int bit_len, WORD_T* value,
+                             bool start_low) {
+
+    // If bit length > message word len.
+    if(bit_len < 1 || bit_len > WORD_BIT_LEN)
+        return -2;
+    // If value spans over end of message.
+    if(bit_len > reader->bits_left)
+        return -3;
+
+    WORD_T v;
+    int acc_bits = reader->acc_bits;
+    if(bit_len <= acc_bits) {
+        v = reader->acc & MASK_HIGH(bit_len);
+        reader->acc = (bit_len < WORD_BIT_LEN ? reader->acc << bit_len : 0);
+        reader->acc_bits = acc_bits - bit_len;
+    }
+    else {
+        // Value crosses into next message word.
+        WORD_T m = WORD_NTOH(reader->message[reader->word_idx]);
+        reader->word_idx++;
+        int rem = bit_len - acc_bits;
+        v = (reader->acc | (m >> acc_bits)) & MASK_HIGH(bit_len);
+        reader->acc = (rem < WORD_BIT_LEN ? m << rem : 0);
+        reader->acc_bits = WORD_BIT_LEN - rem;
+    }
+
+    if(start_low)
+        v = v >> (WORD_BIT_LEN - bit_len);
+    if(value != NULL)
+        *value = v;
+
+    reader->bits_left -= bit_len;
+    reader->bit_pos += bit_len;
+    return reader->bit_pos;
+}
+
+
+/**
+ * bit_reader_get - extracts 1-n bits (where n is the word len) at the current
+ * cursor position and advances the cursor. Each message word is loaded only
+ * once.
+ * @param[in] reader        Cursor initialized with bit_reader_init
+ * @param[in] bit_len       Number of bits (1-n) to extract
+ * @param[out] value        word pointer to receive extracted value starting
+ *                          at MSB
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in message where
+ *                          read value ends, negative value in case of error
+ */
+int bit_reader_get(bit_reader_t* reader, int bit_len, WORD_T* value,
+                   bool start_low) {
+    int start_bit = reader->bit_pos;
+    int rtc = do_bit_reader_get(reader, bit_len, value, start_low);
+    TRACE(BITTER_TRACE_BIT_READER_GET, start_bit, bit_len, rtc);
+    return rtc;
+}
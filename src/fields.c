@@ -0,0 +1,269 @@
+/// @file fields.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "trace.h"
+
+
+// Mask with the <n> least significant bits of a word set (0 <= n <= word len).
+#define MASK_LOW(n)     ((n) >= WORD_BIT_LEN ? ~(WORD_T)0 : \
+                                               (((WORD_T)1 << (n)) - 1))
+
+
+// Appends the operation for one field part to the ops array.
+static void add_op(field_op_t* op, int word_idx, const field_desc_t* f,
+                   int field_idx, int lshift, int rshift, WORD_T mask,
+                   bool first) {
+    op->word_idx = word_idx;
+    op->field_idx = field_idx;
+    op->value_offset = f->value_offset;
+    op->lshift = lshift;
+    // A value starting at MSB is moved down to the LSB first.
+    op->rshift = rshift + (f->start_low ? 0 : WORD_BIT_LEN - f->bit_len);
+    op->mask = mask;
+    op->clear = (f->erase ? mask : 0);
+    op->keep = (first ? 0 : ~(WORD_T)0);
+}
+
+
+/**
+ * message_layout_init - validates a field descriptor table once and compiles
+ * it into a list of per message word operations used by encode_fields and
+ * decode_fields. Fields which land in the same message word are merged into
+ * a single read-modify-write of that word. Fields are applied in table order,
+ * so overlapping fields behave as with consecutive set_message_bits calls.
+ * @param[out] layout       Layout to initialize, release with
+ *                          message_layout_free
+ * @param[in] fields        Array of field descriptors
+ * @param[in] field_cnt     Number of field descriptors in fields array
+ * @param[in] message_len   Number of words of messages using this layout
+ * @returns                 Positive integer of highest bit position used by
+ *                          a field, negative value in case of error
+ */
+int message_layout_init(message_layout_t* layout,
+                        const field_desc_t fields[], int field_cnt,
+                        int message_len) {
+
+    memset(layout, 0, sizeof(*layout));
+    if(fields == NULL || field_cnt < 1 || message_len < 1)
+        return -1;
+
+    // Validate all fields and count needed operations.
+    int message_bits = message_len * WORD_BIT_LEN;
+    int op_cnt = 0;
+    int end_bit = 0;
+    for(int i=0; i<field_cnt; i++) {
+        const field_desc_t* f = &fields[i];
+        // Is start_bit outside message.
+        if(f->start_bit < 0 || f->start_bit >= message_bits)
+            return -1;
+        // If bit length > message word len.
+        if(f->bit_len < 1 || f->bit_len > WORD_BIT_LEN)
+            return -2;
+        // If field spans over end of message.
+        if(f->start_bit + f->bit_len > message_bits)
+            return -3;
+        // Values must be properly aligned words.
+        if(f->value_offset % sizeof(WORD_T) != 0)
+            return -4;
+
+        int mo = f->start_bit % WORD_BIT_LEN;
+        op_cnt += (mo + f->bit_len > WORD_BIT_LEN ? 2 : 1);
+        if(f->start_bit + f->bit_len > end_bit)
+            end_bit = f->start_bit + f->bit_len;
+    }
+
+    field_op_t* ops = calloc(op_cnt, sizeof(field_op_t));
+    int* word_ops = calloc(message_len + 1, sizeof(int));
+    if(ops == NULL || word_ops == NULL) {
+        free(ops);
+        free(word_ops);
+        return -5;
+    }
+
+    // Split fields into parts per message word. Bits of a part are
+    // described by shifting the LSB aligned value right by rshift, then
+    // left by lshift and masking it.
+    field_op_t* tmp = ops;
+    for(int i=0; i<field_cnt; i++) {
+        const field_desc_t* f = &fields[i];
+        int mbi = f->start_bit / WORD_BIT_LEN;
+        int mo = f->start_bit % WORD_BIT_LEN;
+        int n = f->bit_len;
+
+        if(mo + n <= WORD_BIT_LEN) {
+            int ls = WORD_BIT_LEN - mo - n;
+            add_op(tmp++, mbi, f, i, ls, 0, MASK_LOW(n) << ls, true);
+            word_ops[mbi + 1]++;
+        }
+        else {
+            // Handle message word crossing.
+            int n0 = WORD_BIT_LEN - mo;
+            int n1 = n - n0;
+            add_op(tmp++, mbi, f, i, 0, n1, MASK_LOW(n0), true);
+            add_op(tmp++, mbi + 1, f, i, WORD_BIT_LEN - n1, 0,
+                   MASK_LOW(n1) << (WORD_BIT_LEN - n1), false);
+            word_ops[mbi + 1]++;
+            word_ops[mbi + 2]++;
+        }
+    }
+
+    // Stable sort operations by message word, so that all operations on
+    // one word are applied together but still in field table order.
+    int group_cnt = 0;
+    for(int i=1; i<=message_len; i++) {
+        if(word_ops[i] > 0)
+            group_cnt++;
+        word_ops[i] += word_ops[i-1];
+    }
+
+    field_op_t* sorted = calloc(op_cnt, sizeof(field_op_t));
+    field_group_t* groups = calloc(group_cnt, sizeof(field_group_t));
+    if(sorted == NULL || groups == NULL) {
+        free(ops);
+        free(word_ops);
+        free(sorted);
+        free(groups);
+        return -5;
+    }
+    for(int i=0; i<op_cnt; i++)
+        sorted[word_ops[ops[i].word_idx]++] = ops[i];
+    free(ops);
+    free(word_ops);
+
+    // Build groups of operations per message word. A word only has to be
+    // read before encoding if not all of its bits get erased.
+    int g = -1;
+    WORD_T cleared = 0;
+    for(int i=0; i<op_cnt; i++) {
+        if(g < 0 || sorted[i].word_idx != groups[g].word_idx) {
+            g++;
+            groups[g].word_idx = sorted[i].word_idx;
+            groups[g].op_start = i;
+            cleared = 0;
+        }
+        groups[g].op_cnt++;
+        cleared |= sorted[i].clear;
+        groups[g].load = (cleared != ~(WORD_T)0);
+    }
+
+    layout->message_len = message_len;
+    layout->field_cnt = field_cnt;
+    layout->op_cnt = op_cnt;
+    layout->ops = sorted;
+    layout->group_cnt = group_cnt;
+    layout->groups = groups;
+    layout->end_bit = end_bit;
+    return end_bit;
+}
+
+
+/**
+ * message_layout_free - releases resources allocated by message_layout_init.
+ * @param[in] layout        Layout to release
+ */
+void message_layout_free(message_layout_t* layout) {
+    free(layout->ops);
+    free(layout->groups);
+    memset(layout, 0, sizeof(*layout));
+}
+
+
+// encode_fields without tracing.
+static int do_encode_fields(const message_layout_t* layout, WORD_T message[],
+                            const void* values) {
+
+    if(layout->ops == NULL || values == NULL)
+        return -1;
+
+    const uint8_t* vb = (const uint8_t*)values;
+    for(int g=0; g<layout->group_cnt; g++) {
+        const field_group_t* grp = &layout->groups[g];
+        const field_op_t* op = &layout->ops[grp->op_start];
+        const field_op_t* op_end = op + grp->op_cnt;
+
+        WORD_T m = 0;
+        if(grp->load)
+            m = WORD_NTOH(message[grp->word_idx]);
+
+        for(; op < op_end; op++) {
+            WORD_T v = *(const WORD_T*)(vb + op->value_offset);
+            m &= ~op->clear;
+            m |= ((v >> op->rshift) << op->lshift) & op->mask;
+        }
+
+        message[grp->word_idx] = WORD_HTON(m);
+    }
+
+    return layout->end_bit;
+}
+
+
+/**
+ * encode_fields - inserts all fields of a layout into a binary message.
+ * No bounds checks are done as the layout was validated once by
+ * message_layout_init. Each message word is read and written at most once.
+ * A binary message is an array of words in network-byte-order.
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] message       Message array of layout message_len words
+ * @param[in] values        Struct (or array) holding a WORD_T value at the
+ *                          value_offset of each field
+ * @returns                 Positive integer of highest bit position used by
+ *                          a field, negative value in case of error
+ */
+int encode_fields(const message_layout_t* layout, WORD_T message[],
+                  const void* values) {
+    int rtc = do_encode_fields(layout, message, values);
+    TRACE(BITTER_TRACE_ENCODE_FIELDS, -1, layout->end_bit, rtc);
+    return rtc;
+}
+
+
+// decode_fields without tracing.
+static int do_decode_fields(const message_layout_t* layout,
+                            const WORD_T message[], void* values) {
+
+    if(layout->ops == NULL || values == NULL)
+        return -1;
+
+    uint8_t* vb = (uint8_t*)values;
+    for(int g=0; g<layout->group_cnt; g++) {
+        const field_group_t* grp = &layout->groups[g];
+        const field_op_t* op = &layout->ops[grp->op_start];
+        const field_op_t* op_end = op + grp->op_cnt;
+
+        WORD_T m = WORD_NTOH(message[grp->word_idx]);
+
+        for(; op < op_end; op++) {
+            WORD_T* v = (WORD_T*)(vb + op->value_offset);
+            *v = (*v & op->keep) | (((m & op->mask) >> op->lshift) << op->rshift);
+        }
+    }
+
+    return layout->end_bit;
+}
+
+
+/**
+ * decode_fields - extracts all fields of a layout from a binary message in
+ * one pass. Each message word is read only once.
+ * A binary message is an array of words in network-byte-order.
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] message       Message array of layout message_len words
+ * @param[out] values       Struct (or array) receiving a WORD_T value at the
+ *                          value_offset of each field
+ * @returns                 Positive integer of highest bit position used by
+ *                          a field, negative value in case of error
+ */
+int decode_fields(const message_layout_t* layout, const WORD_T message[],
+                  void* values) {
+    int rtc = do_decode_fields(layout, message, values);
+    TRACE(BITTER_TRACE_DECODE_FIELDS, -1, layout->end_bit, rtc);
+    return rtc;
+}
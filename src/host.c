@@ -0,0 +1,432 @@
+/// @file host.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "bitter.h"
+#include "kernels.h"
+#include "trace.h"
+
+
+/*
+ * Working messages keep their words in host-byte-order while fields are
+ * inserted or extracted, so building a message of many fields does not
+ * byte swap the same words again and again. message_finalize converts a
+ * working message to network-byte-order once before it is sent,
+ * message_load converts a received message to a working message.
+ */
+
+
+// set_message_bits_h without tracing.
+static int do_set_message_bits_h(WORD_T message[], int message_len,
+                                 int start_bit, int bit_len,
+                                 const WORD_T value,
+                                 bool erase, bool start_low) {
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+    // If bit length > message word len.
+    if(bit_len > WORD_BIT_LEN || bit_len < 0)
+        return -2;
+    // If value spans over end of message.
+    if((mbi == (message_len-1)) & ((mo + bit_len) > WORD_BIT_LEN))
+        return -3;
+
+    if(bit_len > 0)
+        bitter_kernels.set_bits_h(&message[mbi], mo, bit_len, value,
+                                  erase, start_low);
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * set_message_bits_h - same as set_message_bits but on a working message in
+ * host-byte-order.
+ * @param[in] message       Working message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where value should be inserted
+ * @param[in] bit_len       Number of bits (1-n) of value to insert at start_bit
+ *                          position
+ * @param[in] value         A single word value to insert bits from into message
+ *                          starting at MSB of value
+ * @param[in] erase         if true, set range in message to 0 before inserting
+ *                          value, if false, value is just ORed without erasing
+ *                          before
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in message where
+ *                          inserted value ends, negative value in case of error
+ */
+int set_message_bits_h(WORD_T message[], int message_len,
+                       int start_bit, int bit_len,
+                       const WORD_T value,
+                       bool erase, bool start_low) {
+    int rtc = do_set_message_bits_h(message, message_len, start_bit, bit_len,
+                                    value, erase, start_low);
+    TRACE(BITTER_TRACE_SET_BITS_H, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// get_message_bits_h without tracing.
+static int do_get_message_bits_h(const WORD_T message[], int message_len,
+                                 int start_bit, int bit_len, WORD_T* value,
+                                 bool start_low) {
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+    // If bit length > message word len.
+    if(bit_len > WORD_BIT_LEN || bit_len < 0)
+        return -2;
+    // If value spans over end of message.
+    if((mbi == (message_len-1)) & ((mo + bit_len) > WORD_BIT_LEN))
+        return -3;
+
+    WORD_T v = 0;
+    if(bit_len > 0)
+        v = bitter_kernels.get_bits_h(&message[mbi], mo, bit_len, start_low);
+
+    if(value != NULL)
+        *value = v;
+    return start_bit + bit_len;
+}
+
+
+/**
+ * get_message_bits_h - same as get_message_bits but on a working message in
+ * host-byte-order.
+ * @param[in] message       Working message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where value should be extracted
+ * @param[in] bit_len       Number of bits (1-n) of value to extract from
+ *                          start_bit position
+ * @param[out] value        word pointer to receive extracted value starting at MSB
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in message where
+ *                          read value ends, negative value in case of error
+ */
+int get_message_bits_h(const WORD_T message[], int message_len,
+                       int start_bit, int bit_len, WORD_T* value,
+                       bool start_low) {
+    int rtc = do_get_message_bits_h(message, message_len, start_bit, bit_len,
+                                    value, start_low);
+    TRACE(BITTER_TRACE_GET_BITS_H, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+/*
+ * Inserts bit_len bits of a value word array (bytes false) or a byte array
+ * in network-byte-order (bytes true) into a working message, one word
+ * sized chunk after the other. Each chunk may span two message words.
+ */
+static void insert_h(WORD_T message[], int mo, const void* value, bool bytes,
+                     int64_t bit_len, bool erase) {
+    for(int64_t k=0; k*WORD_BIT_LEN<bit_len; k++) {
+        int n = (bit_len - k * WORD_BIT_LEN < WORD_BIT_LEN ?
+                 bit_len - k * WORD_BIT_LEN : WORD_BIT_LEN);
+        WORD_T v = 0;
+        if(!bytes)
+            v = ((const WORD_T*)value)[k];
+        else {
+            const uint8_t* p = (const uint8_t*)value + k * WORD_BYTE_LEN;
+            for(int i=0; i<(n + 7) / 8; i++)
+                v |= (WORD_T)p[i] << (WORD_BIT_LEN - 8 - 8 * i);
+        }
+        bitter_kernels.set_bits_h(&message[k], mo, n, v, erase, false);
+    }
+}
+
+// Extracts bit_len bits of a working message, see insert_h.
+static void extract_h(const WORD_T message[], int mo, void* value, bool bytes,
+                      int64_t bit_len) {
+    for(int64_t k=0; k*WORD_BIT_LEN<bit_len; k++) {
+        int n = (bit_len - k * WORD_BIT_LEN < WORD_BIT_LEN ?
+                 bit_len - k * WORD_BIT_LEN : WORD_BIT_LEN);
+        WORD_T v = bitter_kernels.get_bits_h(&message[k], mo, n, false);
+        if(!bytes)
+            ((WORD_T*)value)[k] = v;
+        else {
+            uint8_t* p = (uint8_t*)value + k * WORD_BYTE_LEN;
+            for(int i=0; i<(n + 7) / 8; i++)
+                p[i] = (uint8_t)(v >> (WORD_BIT_LEN - 8 - 8 * i));
+        }
+    }
+}
+
+
+// set_message_bits2_h without tracing.
+static int do_set_message_bits2_h(WORD_T message[], int message_len,
+                                  int start_bit, int bit_len,
+                                  const WORD_T value[], int value_len,
+                                  bool erase) {
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+
+    // Not more bits than available in value are inserted.
+    int64_t l = bit_len;
+    if(l > (int64_t)value_len * WORD_BIT_LEN)
+        l = (int64_t)value_len * WORD_BIT_LEN;
+
+    if(l > 0) {
+        // Does value span over end of message.
+        if(start_bit + l > (int64_t)message_len * WORD_BIT_LEN)
+            return field_end_error(message_len, start_bit) * 10;
+        insert_h(&message[mbi], mo, value, false, l, erase);
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * set_message_bits2_h - same as set_message_bits2 but on a working message
+ * in host-byte-order.
+ * @param[in] message       Working message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where bits from value should
+ *                          be inserted into message
+ * @param[in] bit_len       Number of bits from value to insert at start_bit
+ *                          position
+ * @param[in] value         An array of word values to insert bits from. Each
+ *                          word in value is in host byte order
+ * @param[in] value_len     Number of words in value array
+ * @param[in] erase         if true, set range in message to 0 before inserting
+ *                          value, if false, value is just ORed without erasing
+ *                          before
+ * @returns                 Positive integer of bit position in message where
+ *                          inserted value ends, negative value in case of error
+ */
+int set_message_bits2_h(WORD_T message[], int message_len,
+                        int start_bit, int bit_len,
+                        const WORD_T value[], int value_len,
+                        bool erase) {
+    int rtc = do_set_message_bits2_h(message, message_len, start_bit, bit_len,
+                                     value, value_len, erase);
+    TRACE(BITTER_TRACE_SET_BITS2_H, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// get_message_bits2_h without tracing.
+static int do_get_message_bits2_h(const WORD_T message[], int message_len,
+                                  int start_bit, int bit_len,
+                                  WORD_T value[], int value_len) {
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+    if(value == NULL)
+        return -2;
+
+    // Not more bits than fitting into value are extracted.
+    int64_t l = bit_len;
+    if(l > (int64_t)value_len * WORD_BIT_LEN)
+        l = (int64_t)value_len * WORD_BIT_LEN;
+
+    if(l > 0) {
+        // Does value span over end of message.
+        if(start_bit + l > (int64_t)message_len * WORD_BIT_LEN)
+            return field_end_error(message_len, start_bit) * 10;
+        extract_h(&message[mbi], mo, value, false, l);
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * get_message_bits2_h - same as get_message_bits2 but on a working message
+ * in host-byte-order.
+ * @param[in] message       Working message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where value should be extracted
+ * @param[in] bit_len       Number of bits of value to extract from start_bit
+ *                          position
+ * @param[out] value        word pointer to receive extracted value, unused
+ *                          bits of the last word are set to 0
+ * @param[in] value_len     Number of words in value array
+ * @returns                 Positive integer of bit position in message where
+ *                          read value ends, negative value in case of error
+ */
+int get_message_bits2_h(const WORD_T message[], int message_len,
+                        int start_bit, int bit_len,
+                        WORD_T value[], int value_len) {
+    int rtc = do_get_message_bits2_h(message, message_len, start_bit, bit_len,
+                                     value, value_len);
+    TRACE(BITTER_TRACE_GET_BITS2_H, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// set_message_bits3_h without tracing.
+static int do_set_message_bits3_h(WORD_T message[], int message_len,
+                                  int start_bit, int bit_len,
+                                  const uint8_t value[], int value_len,
+                                  bool erase) {
+
+    // If bits to set in message > then bits available in value; exit
+    if(bit_len > (int64_t)value_len * 8)
+        return -1;
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -10;
+
+    if(bit_len > 0) {
+        // Does value span over end of message.
+        if((int64_t)start_bit + bit_len > (int64_t)message_len * WORD_BIT_LEN)
+            return field_end_error(message_len, start_bit) * 100;
+        insert_h(&message[mbi], mo, value, true, bit_len, erase);
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * set_message_bits3_h - same as set_message_bits3 but on a working message
+ * in host-byte-order.
+ * @param[in] message       Working message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where value should be inserted
+ * @param[in] bit_len       Number of bits of value to insert at start_bit position
+ * @param[in] value         An array of uint8_t values to insert. Consecutive
+ *                          bytes in network byte order.
+ * @param[in] value_len     Number of uint8_t bytes in value array
+ * @param[in] erase         if true, set range in message to 0 before inserting
+ *                          value, if false, value is just ORed without erasing
+ *                          before
+ * @returns                 Positive integer of bit position in message where
+ *                          inserted value ends, negative value in case of error
+ */
+int set_message_bits3_h(WORD_T message[], int message_len,
+                        int start_bit, int bit_len,
+                        const uint8_t value[], int value_len,
+                        bool erase) {
+    int rtc = do_set_message_bits3_h(message, message_len, start_bit, bit_len,
+                                     value, value_len, erase);
+    TRACE(BITTER_TRACE_SET_BITS3_H, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// get_message_bits3_h without tracing.
+static int do_get_message_bits3_h(const WORD_T message[], int message_len,
+                                  int start_bit, int bit_len,
+                                  uint8_t value[], int value_len) {
+
+    // If bits to get from message > then bits available in value; exit
+    if(bit_len > (int64_t)value_len * 8)
+        return -1;
+    if(value == NULL)
+        return -2;
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -10;
+
+    if(bit_len > 0) {
+        // Does value span over end of message.
+        if((int64_t)start_bit + bit_len > (int64_t)message_len * WORD_BIT_LEN)
+            return field_end_error(message_len, start_bit) * 100;
+        extract_h(&message[mbi], mo, value, true, bit_len);
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * get_message_bits3_h - same as get_message_bits3 but on a working message
+ * in host-byte-order.
+ * @param[in] message       Working message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where value should be extracted
+ * @param[in] bit_len       Number of bits of value to extract from start_bit
+ *                          position
+ * @param[out] value        Array of uint8_t bytes to receive the value in
+ *                          network byte order, only (bit_len + 7) / 8 bytes
+ *                          are written
+ * @param[in] value_len     Number of uint8_t bytes in value array
+ * @returns                 Positive integer of bit position in message where
+ *                          read value ends, negative value in case of error
+ */
+int get_message_bits3_h(const WORD_T message[], int message_len,
+                        int start_bit, int bit_len,
+                        uint8_t value[], int value_len) {
+    int rtc = do_get_message_bits3_h(message, message_len, start_bit, bit_len,
+                                     value, value_len);
+    TRACE(BITTER_TRACE_GET_BITS3_H, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// message_finalize without tracing.
+static int do_message_finalize(WORD_T message[], int64_t message_len) {
+    if(message == NULL || message_len < 0)
+        return -1;
+    bitter_kernels.swap_words(message, message_len);
+    return 0;
+}
+
+
+/**
+ * message_finalize - converts a working message from host- to
+ * network-byte-order in place. The result is the same message as built
+ * with set_message_bits.
+ * @param[in] message       Working message array of n words
+ * @param[in] message_len   Number of words in message
+ * @returns                 0 on success, negative value in case of error
+ */
+int message_finalize(WORD_T message[], int64_t message_len) {
+    int rtc = do_message_finalize(message, message_len);
+    TRACE(BITTER_TRACE_MESSAGE_FINALIZE, -1, message_len * WORD_BIT_LEN, rtc);
+    return rtc;
+}
+
+
+// message_load without tracing.
+static int do_message_load(WORD_T message[], int64_t message_len) {
+    if(message == NULL || message_len < 0)
+        return -1;
+    bitter_kernels.swap_words(message, message_len);
+    return 0;
+}
+
+
+/**
+ * message_load - converts a message from network- to host-byte-order in
+ * place, so its fields can be accessed with the _h functions.
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @returns                 0 on success, negative value in case of error
+ */
+int message_load(WORD_T message[], int64_t message_len) {
+    int rtc = do_message_load(message, message_len);
+    TRACE(BITTER_TRACE_MESSAGE_LOAD, -1, message_len * WORD_BIT_LEN, rtc);
+    return rtc;
+}
@@ -0,0 +1,121 @@
+/// @file kernels.h
+/// Internal bit copy kernels shared by the bitter functions. These functions
+/// do no bounds checks at all, callers have to validate arguments before.
+
+#ifndef _KERNELS_H_
+#define _KERNELS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bitter.h"
+
+
+// Declares the bulk kernels of one instruction set.
+#define DECLARE_BULK_KERNELS(suffix)                                        \
+extern void bits_insert_##suffix(WORD_T message[], int mo,                  \
+        const WORD_T value[], int64_t bit_len, bool erase);                 \
+extern void bits_insert_bytes_##suffix(WORD_T message[], int mo,            \
+        const uint8_t value[], int64_t bit_len, bool erase);                \
+extern void bits_extract_##suffix(const WORD_T message[], int mo,           \
+        WORD_T value[], int64_t bit_len);                                   \
+extern void bits_extract_bytes_##suffix(const WORD_T message[], int mo,     \
+        uint8_t value[], int64_t bit_len);                                  \
+extern void bits_copy_##suffix(WORD_T dst[], const WORD_T src[], int off,   \
+        int64_t word_cnt, bool backwards);
+
+// Declares the single field kernels of one instruction set.
+#define DECLARE_SINGLE_KERNELS(suffix)                                      \
+extern void set_bits_##suffix(WORD_T message[], int mo, int bit_len,        \
+        WORD_T value, bool erase, bool start_low);                          \
+extern WORD_T get_bits_##suffix(const WORD_T message[], int mo,             \
+        int bit_len, bool start_low);                                       \
+extern void set_bits_h_##suffix(WORD_T message[], int mo, int bit_len,      \
+        WORD_T value, bool erase, bool start_low);                          \
+extern WORD_T get_bits_h_##suffix(const WORD_T message[], int mo,           \
+        int bit_len, bool start_low);
+// Declares the batch kernels of one instruction set. They process up to
+// COLUMN_BLOCK messages per call.
+#define COLUMN_BLOCK 16
+#define DECLARE_COLUMN_KERNELS(suffix)                                      \
+extern void encode_block_##suffix(const message_layout_t* layout,           \
+        WORD_T* const rows[], int cnt,                                      \
+        const WORD_T* const columns[], size_t base);                        \
+extern void decode_block_##suffix(const message_layout_t* layout,           \
+        const WORD_T* const rows[], int cnt,                                \
+        WORD_T* const columns[], size_t base);                              \
+extern void swap_words_##suffix(WORD_T words[], int64_t word_len);
+
+// Declares the CRC kernels of one instruction set. They feed word_cnt
+// message words worth of bits starting at bit offset mo of message word 0
+// into the MSB aligned CRC register reg.
+#define DECLARE_CRC_KERNELS(suffix)                                         \
+extern uint64_t crc_words_##suffix(const crc_t* crc, uint64_t reg,          \
+        const WORD_T message[], int mo, int64_t word_cnt);
+
+DECLARE_SINGLE_KERNELS(scalar)
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+DECLARE_SINGLE_KERNELS(bmi2)
+#endif
+
+DECLARE_BULK_KERNELS(scalar)
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+DECLARE_BULK_KERNELS(avx2)
+DECLARE_BULK_KERNELS(avx512)
+#endif
+#if WORD_BIT_LEN == 64 && defined(__aarch64__)
+DECLARE_BULK_KERNELS(neon)
+#endif
+
+DECLARE_COLUMN_KERNELS(scalar)
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+DECLARE_COLUMN_KERNELS(avx2)
+DECLARE_COLUMN_KERNELS(avx512)
+#endif
+
+
+DECLARE_CRC_KERNELS(scalar)
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+DECLARE_CRC_KERNELS(clmul)
+#endif
+
+// Kernels used by the bitter functions, selected once at load time
+// depending on the instruction sets supported by the CPU.
+typedef struct {
+    const char* name;
+    void (*set_bits)(WORD_T message[], int mo, int bit_len,
+                   WORD_T value, bool erase, bool start_low);
+    WORD_T (*get_bits)(const WORD_T message[], int mo, int bit_len,
+                   bool start_low);
+    void (*set_bits_h)(WORD_T message[], int mo, int bit_len,
+                   WORD_T value, bool erase, bool start_low);
+    WORD_T (*get_bits_h)(const WORD_T message[], int mo, int bit_len,
+                   bool start_low);
+    void (*insert)(WORD_T message[], int mo,
+                   const WORD_T value[], int64_t bit_len, bool erase);
+    void (*insert_bytes)(WORD_T message[], int mo,
+                   const uint8_t value[], int64_t bit_len, bool erase);
+    void (*extract)(const WORD_T message[], int mo,
+                   WORD_T value[], int64_t bit_len);
+    void (*extract_bytes)(const WORD_T message[], int mo,
+                   uint8_t value[], int64_t bit_len);
+    void (*copy)(WORD_T dst[], const WORD_T src[], int off,
+                   int64_t word_cnt, bool backwards);
+    void (*encode_block)(const message_layout_t* layout,
+                   WORD_T* const rows[], int cnt,
+                   const WORD_T* const columns[], size_t base);
+    void (*decode_block)(const message_layout_t* layout,
+                   const WORD_T* const rows[], int cnt,
+                   WORD_T* const columns[], size_t base);
+    void (*swap_words)(WORD_T words[], int64_t word_len);
+    uint64_t (*crc_words)(const crc_t* crc, uint64_t reg,
+                   const WORD_T message[], int mo, int64_t word_cnt);
+} bitter_kernels_t;
+
+extern bitter_kernels_t bitter_kernels;
+
+// Error code of a field reaching over the end of a message, see bitter.c.
+extern int field_end_error(int64_t message_len, int64_t start_bit);
+
+#endif
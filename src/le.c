@@ -0,0 +1,492 @@
+/// @file le.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+
+#include "bitter.h"
+#include "kernels.h"
+#include "trace.h"
+
+
+/*
+ * LSB-first messages as used by CAN (Intel byte order), USB and many radio
+ * protocols: bit 0 is the LSB of message byte 0 and a field starting at
+ * start_bit has its least significant bit there. The words of such a
+ * message are stored in little-endian byte order, so a message word loaded
+ * as little-endian holds message bits i..i+n-1 with bit i as its LSB.
+ * On little-endian hosts the conversion is a plain load and the kernels
+ * below are as cheap as their big-endian counterparts.
+ */
+
+#if WORD_BIT_LEN == 64
+    #define WORD_HTOLE  htole64
+    #define WORD_LETOH  le64toh
+#else
+    #define WORD_HTOLE  htole32
+    #define WORD_LETOH  le32toh
+#endif
+
+#define ALWAYS_INLINE   static inline __attribute__((always_inline))
+
+
+// Mask with the <n> least significant bits of a word set (0 <= n <= word len).
+ALWAYS_INLINE WORD_T mask_low(int n) {
+    return (n < WORD_BIT_LEN ? ((WORD_T)1 << n) - 1 : ~(WORD_T)0);
+}
+
+
+// Inserts the n low bits of v at bit offset mo of message word 0. Message
+// word 1 is only accessed if the field crosses into it.
+ALWAYS_INLINE void set_bits_le(WORD_T message[], int mo, int n,
+                               WORD_T v, bool erase) {
+    WORD_T mask = mask_low(n);
+    v &= mask;
+
+    WORD_T m = WORD_LETOH(message[0]);
+    if(erase)
+        m &= ~(mask << mo);
+    m |= v << mo;
+    message[0] = WORD_HTOLE(m);
+
+    if(mo + n > WORD_BIT_LEN) {
+        m = WORD_LETOH(message[1]);
+        if(erase)
+            m &= ~(mask >> (WORD_BIT_LEN - mo));
+        m |= v >> (WORD_BIT_LEN - mo);
+        message[1] = WORD_HTOLE(m);
+    }
+}
+
+
+// Extracts n bits at bit offset mo of message word 0 as low bits.
+ALWAYS_INLINE WORD_T get_bits_le(const WORD_T message[], int mo, int n) {
+    WORD_T v = WORD_LETOH(message[0]) >> mo;
+    if(mo + n > WORD_BIT_LEN)
+        v |= WORD_LETOH(message[1]) << (WORD_BIT_LEN - mo);
+    return v & mask_low(n);
+}
+
+
+// Word k of a value given as words or as bytes. Missing bytes after the
+// last byte of the field are read as 0.
+ALWAYS_INLINE WORD_T value_word(const void* value, bool bytes, int64_t k,
+                                int64_t bit_len) {
+    if(!bytes)
+        return ((const WORD_T*)value)[k];
+
+    const uint8_t* p = (const uint8_t*)value + k * WORD_BYTE_LEN;
+    int64_t n = (bit_len + 7) / 8 - k * WORD_BYTE_LEN;
+    WORD_T v = 0;
+    if(n >= (int64_t)WORD_BYTE_LEN) {
+        memcpy(&v, p, WORD_BYTE_LEN);
+        return WORD_LETOH(v);
+    }
+    for(int64_t i=0; i<n; i++)
+        v |= (WORD_T)p[i] << (8 * i);
+    return v;
+}
+
+
+// n (1-word len) value bits starting at value bit p as low bits.
+ALWAYS_INLINE WORD_T value_bits(const void* value, bool bytes, int64_t p,
+                                int n, int64_t bit_len) {
+    int64_t k = p / WORD_BIT_LEN;
+    int s = p % WORD_BIT_LEN;
+    WORD_T v = value_word(value, bytes, k, bit_len) >> s;
+    if(s + n > WORD_BIT_LEN)
+        v |= value_word(value, bytes, k + 1, bit_len) << (WORD_BIT_LEN - s);
+    return v & mask_low(n);
+}
+
+
+/*
+ * Inserts bit_len bits of value at bit offset mo of message word 0. Only
+ * the first and last message word need a masked read-modify-write, words
+ * in between are stored once.
+ */
+ALWAYS_INLINE void insert_le(WORD_T message[], int mo, const void* value,
+                             bool bytes, int64_t bit_len, bool erase) {
+    int64_t n = WORD_BIT_LEN - mo;
+    if(n > bit_len)
+        n = bit_len;
+    set_bits_le(message, mo, n, value_bits(value, bytes, 0, n, bit_len),
+                erase);
+
+    int64_t p = n;
+    WORD_T* m = &message[1];
+    for(; bit_len - p >= WORD_BIT_LEN; p += WORD_BIT_LEN, m++) {
+        WORD_T v = value_bits(value, bytes, p, WORD_BIT_LEN, bit_len);
+        *m = (erase ? WORD_HTOLE(v) : *m | WORD_HTOLE(v));
+    }
+    if(p < bit_len)
+        set_bits_le(m, 0, bit_len - p,
+                    value_bits(value, bytes, p, bit_len - p, bit_len), erase);
+}
+
+
+// Extracts bit_len bits at bit offset mo of message word 0 into value
+// words, unused bits of the last word are set to 0.
+static void extract_le(const WORD_T message[], int mo, WORD_T value[],
+                       int64_t bit_len) {
+    int64_t k = 0;
+    for(; bit_len >= WORD_BIT_LEN; bit_len -= WORD_BIT_LEN, k++)
+        value[k] = get_bits_le(&message[k], mo, WORD_BIT_LEN);
+    if(bit_len > 0)
+        value[k] = get_bits_le(&message[k], mo, bit_len);
+}
+
+
+// Same as extract_le into value bytes.
+static void extract_bytes_le(const WORD_T message[], int mo, uint8_t value[],
+                             int64_t bit_len) {
+    int64_t k = 0;
+    for(; bit_len >= WORD_BIT_LEN; bit_len -= WORD_BIT_LEN, k++) {
+        WORD_T v = WORD_HTOLE(get_bits_le(&message[k], mo, WORD_BIT_LEN));
+        memcpy(&value[k * WORD_BYTE_LEN], &v, WORD_BYTE_LEN);
+    }
+    if(bit_len > 0) {
+        WORD_T v = get_bits_le(&message[k], mo, bit_len);
+        for(int i=0; i<(bit_len + 7) / 8; i++)
+            value[k * WORD_BYTE_LEN + i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+
+// set_message_bits_le without tracing.
+static int do_set_message_bits_le(WORD_T message[], int message_len,
+                                  int start_bit, int bit_len,
+                                  const WORD_T value,
+                                  bool erase, bool start_low) {
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+    // If bit length > message word len.
+    if(bit_len > WORD_BIT_LEN || bit_len < 0)
+        return -2;
+    // If value spans over end of message.
+    if((mbi == (message_len-1)) & ((mo + bit_len) > WORD_BIT_LEN))
+        return -3;
+
+    if(bit_len > 0)
+        set_bits_le(&message[mbi], mo, bit_len,
+            (start_low ? value : value >> (WORD_BIT_LEN - bit_len)), erase);
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * set_message_bits_le - sets 1-n bits at an arbitrary position in a LSB-first
+ * binary message (where n is the word len).
+ * A LSB-first message is an array of words in little-endian byte order,
+ * bit 0 is the LSB of the first message byte.
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of the LSB of the field
+ * @param[in] bit_len       Number of bits (1-n) of value to insert at start_bit
+ *                          position
+ * @param[in] value         A single word value to insert bits from into message
+ *                          starting at MSB of value
+ * @param[in] erase         if true, set range in message to 0 before inserting
+ *                          value, if false, value is just ORed without erasing
+ *                          before
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in message where
+ *                          inserted value ends, negative value in case of error
+ */
+int set_message_bits_le(WORD_T message[], int message_len,
+                        int start_bit, int bit_len,
+                        const WORD_T value,
+                        bool erase, bool start_low) {
+    int rtc = do_set_message_bits_le(message, message_len, start_bit, bit_len,
+                                     value, erase, start_low);
+    TRACE(BITTER_TRACE_SET_BITS_LE, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// get_message_bits_le without tracing.
+static int do_get_message_bits_le(const WORD_T message[], int message_len,
+                                  int start_bit, int bit_len, WORD_T* value,
+                                  bool start_low) {
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+    // If bit length > message word len.
+    if(bit_len > WORD_BIT_LEN || bit_len < 0)
+        return -2;
+    // If value spans over end of message.
+    if((mbi == (message_len-1)) & ((mo + bit_len) > WORD_BIT_LEN))
+        return -3;
+
+    WORD_T v = 0;
+    if(bit_len > 0) {
+        v = get_bits_le(&message[mbi], mo, bit_len);
+        if(!start_low)
+            v <<= WORD_BIT_LEN - bit_len;
+    }
+
+    if(value != NULL)
+        *value = v;
+    return start_bit + bit_len;
+}
+
+
+/**
+ * get_message_bits_le - extracts 1-n bits from an arbitrary position of a
+ * LSB-first binary message.
+ * A LSB-first message is an array of words in little-endian byte order,
+ * bit 0 is the LSB of the first message byte.
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of the LSB of the field
+ * @param[in] bit_len       Number of bits (1-n) of value to extract from
+ *                          start_bit position
+ * @param[out] value        word pointer to receive extracted value starting at MSB
+ * @param[in] start_low     If true, start at bit position <bit_len> of value
+ * @returns                 Positive integer of bit position in message where
+ *                          read value ends, negative value in case of error
+ */
+int get_message_bits_le(const WORD_T message[], int message_len,
+                        int start_bit, int bit_len, WORD_T* value,
+                        bool start_low) {
+    int rtc = do_get_message_bits_le(message, message_len, start_bit, bit_len,
+                                     value, start_low);
+    TRACE(BITTER_TRACE_GET_BITS_LE, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// set_message_bits2_le without tracing.
+static int do_set_message_bits2_le(WORD_T message[], int message_len,
+                                   int start_bit, int bit_len,
+                                   const WORD_T value[], int value_len,
+                                   bool erase) {
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+
+    // Not more bits than available in value are inserted.
+    int64_t l = bit_len;
+    if(l > (int64_t)value_len * WORD_BIT_LEN)
+        l = (int64_t)value_len * WORD_BIT_LEN;
+
+    if(l > 0) {
+        // Does value span over end of message.
+        if(start_bit + l > (int64_t)message_len * WORD_BIT_LEN)
+            return field_end_error(message_len, start_bit) * 10;
+        insert_le(&message[mbi], mo, value, false, l, erase);
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * set_message_bits2_le - sets an arbitrary number of bits at an arbitrary
+ * position in a LSB-first binary message.
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of the LSB of the field
+ * @param[in] bit_len       Number of bits from value to insert at start_bit
+ *                          position
+ * @param[in] value         An array of word values to insert bits from, bit
+ *                          0 of the field is the LSB of value[0]. Each word
+ *                          in value is in host byte order
+ * @param[in] value_len     Number of words in value array
+ * @param[in] erase         if true, set range in message to 0 before inserting
+ *                          value, if false, value is just ORed without erasing
+ *                          before
+ * @returns                 Positive integer of bit position in message where
+ *                          inserted value ends, negative value in case of error
+ */
+int set_message_bits2_le(WORD_T message[], int message_len,
+                         int start_bit, int bit_len,
+                         const WORD_T value[], int value_len,
+                         bool erase) {
+    int rtc = do_set_message_bits2_le(message, message_len, start_bit, bit_len,
+                                      value, value_len, erase);
+    TRACE(BITTER_TRACE_SET_BITS2_LE, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// get_message_bits2_le without tracing.
+static int do_get_message_bits2_le(const WORD_T message[], int message_len,
+                                   int start_bit, int bit_len,
+                                   WORD_T value[], int value_len) {
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -1;
+    if(value == NULL)
+        return -2;
+
+    // Not more bits than fitting into value are extracted.
+    int64_t l = bit_len;
+    if(l > (int64_t)value_len * WORD_BIT_LEN)
+        l = (int64_t)value_len * WORD_BIT_LEN;
+
+    if(l > 0) {
+        // Does value span over end of message.
+        if(start_bit + l > (int64_t)message_len * WORD_BIT_LEN)
+            return field_end_error(message_len, start_bit) * 10;
+        extract_le(&message[mbi], mo, value, l);
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * get_message_bits2_le - extracts an arbitrary number of bits from an
+ * arbitrary position of a LSB-first binary message as a value array
+ * containing words.
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of the LSB of the field
+ * @param[in] bit_len       Number of bits of value to extract from start_bit
+ *                          position
+ * @param[out] value        word pointer to receive extracted value, bit 0 of
+ *                          the field is the LSB of value[0], unused bits of
+ *                          the last word are set to 0
+ * @param[in] value_len     Number of words in value array
+ * @returns                 Positive integer of bit position in message where
+ *                          read value ends, negative value in case of error
+ */
+int get_message_bits2_le(const WORD_T message[], int message_len,
+                         int start_bit, int bit_len,
+                         WORD_T value[], int value_len) {
+    int rtc = do_get_message_bits2_le(message, message_len, start_bit, bit_len,
+                                      value, value_len);
+    TRACE(BITTER_TRACE_GET_BITS2_LE, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// set_message_bits3_le without tracing.
+static int do_set_message_bits3_le(WORD_T message[], int message_len,
+                                   int start_bit, int bit_len,
+                                   const uint8_t value[], int value_len,
+                                   bool erase) {
+
+    // If bits to set in message > then bits available in value; exit
+    if(bit_len > (int64_t)value_len * 8)
+        return -1;
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -10;
+
+    if(bit_len > 0) {
+        // Does value span over end of message.
+        if((int64_t)start_bit + bit_len > (int64_t)message_len * WORD_BIT_LEN)
+            return field_end_error(message_len, start_bit) * 100;
+        insert_le(&message[mbi], mo, value, true, bit_len, erase);
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * set_message_bits3_le - sets an arbitrary number of bits at an arbitrary
+ * position in a LSB-first binary message.
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of the LSB of the field
+ * @param[in] bit_len       Number of bits of value to insert at start_bit position
+ * @param[in] value         An array of uint8_t values to insert. Consecutive
+ *                          bytes in little-endian byte order, bit 0 of the
+ *                          field is the LSB of value[0].
+ * @param[in] value_len     Number of uint8_t bytes in value array
+ * @param[in] erase         if true, set range in message to 0 before inserting
+ *                          value, if false, value is just ORed without erasing
+ *                          before
+ * @returns                 Positive integer of bit position in message where
+ *                          inserted value ends, negative value in case of error
+ */
+int set_message_bits3_le(WORD_T message[], int message_len,
+                         int start_bit, int bit_len,
+                         const uint8_t value[], int value_len,
+                         bool erase) {
+    int rtc = do_set_message_bits3_le(message, message_len, start_bit, bit_len,
+                                      value, value_len, erase);
+    TRACE(BITTER_TRACE_SET_BITS3_LE, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// get_message_bits3_le without tracing.
+static int do_get_message_bits3_le(const WORD_T message[], int message_len,
+                                   int start_bit, int bit_len,
+                                   uint8_t value[], int value_len) {
+
+    // If bits to get from message > then bits available in value; exit
+    if(bit_len > (int64_t)value_len * 8)
+        return -1;
+    if(value == NULL)
+        return -2;
+
+    int mbi = start_bit / WORD_BIT_LEN;     // Message word index.
+    int mo = start_bit % WORD_BIT_LEN;      // Bit offset in message word.
+
+    // Is start_bit outside message.
+    if(start_bit < 0 || mbi >= message_len)
+        return -10;
+
+    if(bit_len > 0) {
+        // Does value span over end of message.
+        if((int64_t)start_bit + bit_len > (int64_t)message_len * WORD_BIT_LEN)
+            return field_end_error(message_len, start_bit) * 100;
+        extract_bytes_le(&message[mbi], mo, value, bit_len);
+    }
+
+    return start_bit + bit_len;
+}
+
+
+/**
+ * get_message_bits3_le - extracts an arbitrary number of bits from an
+ * arbitrary position of a LSB-first binary message as a value array
+ * containing consecutive uint8_t bytes in little-endian byte order.
+ * Unused bits of the last value byte are set to 0.
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position of the LSB of the field
+ * @param[in] bit_len       Number of bits of value to extract from start_bit
+ *                          position
+ * @param[out] value        uint8_t pointer to receive extracted values
+ * @param[in] value_len     Number of uint8_t bytes in value array
+ * @returns                 Positive integer of bit position in message where
+ *                          read value ends, negative value in case of error
+ */
+int get_message_bits3_le(const WORD_T message[], int message_len,
+                         int start_bit, int bit_len,
+                         uint8_t value[], int value_len) {
+    int rtc = do_get_message_bits3_le(message, message_len, start_bit, bit_len,
+                                      value, value_len);
+    TRACE(BITTER_TRACE_GET_BITS3_LE, start_bit, bit_len, rtc);
+    return rtc;
+}
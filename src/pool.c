@@ -0,0 +1,424 @@
+/// @file pool.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "bitter.h"
+#include "kernels.h"
+#include "trace.h"
+
+
+// Scratch memory and cursors are aligned to cache lines, so workers never
+// write to a cache line used by another worker.
+#define CACHE_LINE      64
+
+// Messages per chunk taken from a range by the batch functions.
+#define COLUMN_CHUNK    (64 * COLUMN_BLOCK)
+
+
+/*
+ * Each worker owns a range of items of the current job. It takes chunks
+ * from the front of its range by atomically advancing the range cursor.
+ * When its own range is exhausted it steals chunks from the ranges of the
+ * other workers the same way, so a chunk is always processed exactly once
+ * and no locks are needed while a job runs.
+ */
+typedef struct {
+    _Atomic int64_t next;   // Next unclaimed item of range.
+    int64_t end;            // End of range (exclusive).
+    pthread_t thread;
+    struct bitter_pool* pool;
+    int idx;
+    void* scratch;
+} __attribute__((aligned(CACHE_LINE))) pool_worker_t;
+
+struct bitter_pool {
+    int thread_cnt;
+    size_t scratch_size;
+    pool_worker_t* workers;
+
+    // Serializes jobs of callers sharing a pool.
+    pthread_mutex_t run_lock;
+
+    // Protects the job state below.
+    pthread_mutex_t lock;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    uint64_t generation;
+    int busy;
+    bool stop;
+
+    // Current job.
+    bitter_pool_fn fn;
+    void* arg;
+    int chunk;
+};
+
+
+// Processes chunks of a range until it is exhausted.
+static void drain_range(bitter_pool_t* pool, pool_worker_t* range,
+                        pool_worker_t* self) {
+    int64_t chunk = pool->chunk;
+    int64_t end = range->end;
+    for(;;) {
+        int64_t start = atomic_fetch_add_explicit(&range->next, chunk,
+                                                  memory_order_relaxed);
+        if(start >= end)
+            break;
+        pool->fn(pool->arg, start, (start + chunk < end ? start + chunk : end),
+                 self->scratch, self->idx);
+    }
+}
+
+
+// Processes own range first, then steals from the other workers.
+static void run_job(bitter_pool_t* pool, pool_worker_t* self) {
+    drain_range(pool, self, self);
+    for(int i=1; i<pool->thread_cnt; i++)
+        drain_range(pool, &pool->workers[(self->idx + i) % pool->thread_cnt],
+                    self);
+}
+
+
+static void* worker_main(void* p) {
+    pool_worker_t* self = (pool_worker_t*)p;
+    bitter_pool_t* pool = self->pool;
+    uint64_t generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for(;;) {
+        while(!pool->stop && pool->generation == generation)
+            pthread_cond_wait(&pool->start_cond, &pool->lock);
+        if(pool->stop)
+            break;
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_job(pool, self);
+
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->busy == 0)
+            pthread_cond_signal(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+
+/**
+ * bitter_pool_create - starts a pool of worker threads used to process
+ * large batches of messages in parallel. The calling thread of
+ * bitter_pool_run takes part as worker 0, so thread_cnt - 1 threads are
+ * started.
+ * @param[in] thread_cnt    Number of workers, 0 to use one per online CPU
+ * @param[in] scratch_size  Bytes of scratch memory reserved for each worker,
+ *                          passed to the job function
+ * @returns                 Pool or NULL in case of error
+ */
+bitter_pool_t* bitter_pool_create(int thread_cnt, size_t scratch_size) {
+    if(thread_cnt < 0)
+        return NULL;
+    if(thread_cnt == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_cnt = (cpus > 0 ? (int)cpus : 1);
+    }
+
+    bitter_pool_t* pool = calloc(1, sizeof(bitter_pool_t));
+    if(pool == NULL)
+        return NULL;
+
+    scratch_size = (scratch_size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+    pool->scratch_size = scratch_size;
+    pool->workers = aligned_alloc(CACHE_LINE,
+                                  thread_cnt * sizeof(pool_worker_t));
+    if(pool->workers == NULL) {
+        free(pool);
+        return NULL;
+    }
+    memset(pool->workers, 0, thread_cnt * sizeof(pool_worker_t));
+
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for(int i=0; i<thread_cnt; i++) {
+        pool_worker_t* w = &pool->workers[i];
+        w->pool = pool;
+        w->idx = i;
+        if(scratch_size > 0) {
+            w->scratch = aligned_alloc(CACHE_LINE, scratch_size);
+            if(w->scratch == NULL) {
+                bitter_pool_destroy(pool);
+                return NULL;
+            }
+            memset(w->scratch, 0, scratch_size);
+        }
+        pool->thread_cnt = i + 1;
+        if(i > 0 && pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            free(w->scratch);
+            w->scratch = NULL;
+            pool->thread_cnt = i;
+            bitter_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+
+/**
+ * bitter_pool_destroy - stops all worker threads of a pool and releases it.
+ * @param[in] pool          Pool created by bitter_pool_create, may be NULL
+ */
+void bitter_pool_destroy(bitter_pool_t* pool) {
+    if(pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(int i=0; i<pool->thread_cnt; i++) {
+        if(i > 0)
+            pthread_join(pool->workers[i].thread, NULL);
+        free(pool->workers[i].scratch);
+    }
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->start_cond);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    free(pool->workers);
+    free(pool);
+}
+
+
+/**
+ * bitter_pool_threads - number of workers of a pool.
+ * @param[in] pool          Pool created by bitter_pool_create
+ * @returns                 Number of workers including the calling thread
+ */
+int bitter_pool_threads(const bitter_pool_t* pool) {
+    return pool->thread_cnt;
+}
+
+
+/**
+ * bitter_pool_run - calls fn for all items 0 to cnt - 1 split into chunks,
+ * using all workers of the pool. Items are evenly distributed over the
+ * workers first, workers running out of work steal chunks from others.
+ * Returns when all items are processed. Calls from several threads sharing
+ * one pool are serialized.
+ * @param[in] pool          Pool created by bitter_pool_create
+ * @param[in] cnt           Number of items
+ * @param[in] chunk         Maximum number of items passed to one fn call
+ * @param[in] fn            Job function called with item range [start, end),
+ *                          scratch memory and index of calling worker
+ * @param[in] arg           Argument passed to fn
+ * @returns                 cnt, negative value in case of error
+ */
+int bitter_pool_run(bitter_pool_t* pool, int cnt, int chunk,
+                    bitter_pool_fn fn, void* arg) {
+
+    if(pool == NULL || fn == NULL || cnt < 0 || chunk < 1)
+        return -1;
+    if(cnt == 0)
+        return 0;
+
+    pthread_mutex_lock(&pool->run_lock);
+
+    // Split items into one range per worker, aligned to chunks.
+    int n = pool->thread_cnt;
+    int64_t chunks = (cnt + (int64_t)chunk - 1) / chunk;
+    for(int i=0; i<n; i++) {
+        pool_worker_t* w = &pool->workers[i];
+        int64_t start = chunks * i / n * chunk;
+        int64_t end = chunks * (i + 1) / n * chunk;
+        w->end = (end < cnt ? end : cnt);
+        atomic_store_explicit(&w->next, (start < cnt ? start : cnt),
+                              memory_order_relaxed);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->chunk = chunk;
+    pool->busy = n - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_job(pool, &pool->workers[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while(pool->busy > 0)
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&pool->run_lock);
+    return cnt;
+}
+
+
+// Batch job shared read-only by all workers.
+typedef struct {
+    const message_layout_t* layout;
+    const void* messages;
+    bool ptr;
+    const void* columns;
+} column_job_t;
+
+static void encode_job(void* arg, int start, int end, void* scratch,
+                       int worker) {
+    const column_job_t* job = (const column_job_t*)arg;
+    const message_layout_t* layout = job->layout;
+    const WORD_T* const* columns = (const WORD_T* const*)job->columns;
+    WORD_T* rows[COLUMN_BLOCK];
+
+    for(int k=start; k<end; k+=COLUMN_BLOCK) {
+        int cnt = (end - k < COLUMN_BLOCK ? end - k : COLUMN_BLOCK);
+        if(job->ptr) {
+            bitter_kernels.encode_block(layout,
+                &((WORD_T* const*)job->messages)[k], cnt, columns, k);
+            continue;
+        }
+        for(int j=0; j<cnt; j++)
+            rows[j] = (WORD_T*)job->messages +
+                      (size_t)(k + j) * layout->message_len;
+        bitter_kernels.encode_block(layout, rows, cnt, columns, k);
+    }
+}
+
+static void decode_job(void* arg, int start, int end, void* scratch,
+                       int worker) {
+    const column_job_t* job = (const column_job_t*)arg;
+    const message_layout_t* layout = job->layout;
+    WORD_T* const* columns = (WORD_T* const*)job->columns;
+    const WORD_T* rows[COLUMN_BLOCK];
+
+    for(int k=start; k<end; k+=COLUMN_BLOCK) {
+        int cnt = (end - k < COLUMN_BLOCK ? end - k : COLUMN_BLOCK);
+        if(job->ptr) {
+            bitter_kernels.decode_block(layout,
+                &((const WORD_T* const*)job->messages)[k], cnt, columns, k);
+            continue;
+        }
+        for(int j=0; j<cnt; j++)
+            rows[j] = (const WORD_T*)job->messages +
+                      (size_t)(k + j) * layout->message_len;
+        bitter_kernels.decode_block(layout, rows, cnt, columns, k);
+    }
+}
+
+static int run_column_job(bitter_pool_t* pool, const message_layout_t* layout,
+                          const void* messages, bool ptr, int message_cnt,
+                          const void* columns, bitter_pool_fn fn) {
+    if(layout->ops == NULL || messages == NULL || columns == NULL ||
+       message_cnt < 0)
+        return -1;
+
+    column_job_t job = {layout, messages, ptr, columns};
+    return bitter_pool_run(pool, message_cnt, COLUMN_CHUNK, fn, &job);
+}
+
+
+/**
+ * encode_columns_mt - same as encode_columns, but splits the messages over
+ * all workers of a pool.
+ * @param[in] pool          Pool created by bitter_pool_create
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] messages      Array of message_cnt messages of layout
+ *                          message_len words each
+ * @param[in] message_cnt   Number of messages
+ * @param[in] columns       Array of field_cnt value columns, each holding
+ *                          message_cnt WORD_T values
+ * @returns                 Number of messages encoded, negative value in
+ *                          case of error
+ */
+int encode_columns_mt(bitter_pool_t* pool, const message_layout_t* layout,
+                      WORD_T messages[], int message_cnt,
+                      const WORD_T* const columns[]) {
+    int rtc = run_column_job(pool, layout, messages, false, message_cnt,
+                             columns, encode_job);
+    TRACE(BITTER_TRACE_ENCODE_COLUMNS, -1, layout->end_bit, rtc);
+    return rtc;
+}
+
+
+/**
+ * encode_columns_ptr_mt - same as encode_columns_ptr, but splits the
+ * messages over all workers of a pool.
+ * @param[in] pool          Pool created by bitter_pool_create
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] messages      Array of message_cnt pointers to messages of
+ *                          layout message_len words each
+ * @param[in] message_cnt   Number of messages
+ * @param[in] columns       Array of field_cnt value columns, each holding
+ *                          message_cnt WORD_T values
+ * @returns                 Number of messages encoded, negative value in
+ *                          case of error
+ */
+int encode_columns_ptr_mt(bitter_pool_t* pool, const message_layout_t* layout,
+                          WORD_T* const messages[], int message_cnt,
+                          const WORD_T* const columns[]) {
+    int rtc = run_column_job(pool, layout, messages, true, message_cnt,
+                             columns, encode_job);
+    TRACE(BITTER_TRACE_ENCODE_COLUMNS, -1, layout->end_bit, rtc);
+    return rtc;
+}
+
+
+/**
+ * decode_columns_mt - same as decode_columns, but splits the messages over
+ * all workers of a pool.
+ * @param[in] pool          Pool created by bitter_pool_create
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] messages      Array of message_cnt messages of layout
+ *                          message_len words each
+ * @param[in] message_cnt   Number of messages
+ * @param[out] columns      Array of field_cnt value columns, each receiving
+ *                          message_cnt WORD_T values
+ * @returns                 Number of messages decoded, negative value in
+ *                          case of error
+ */
+int decode_columns_mt(bitter_pool_t* pool, const message_layout_t* layout,
+                      const WORD_T messages[], int message_cnt,
+                      WORD_T* const columns[]) {
+    int rtc = run_column_job(pool, layout, messages, false, message_cnt,
+                             columns, decode_job);
+    TRACE(BITTER_TRACE_DECODE_COLUMNS, -1, layout->end_bit, rtc);
+    return rtc;
+}
+
+
+/**
+ * decode_columns_ptr_mt - same as decode_columns_ptr, but splits the
+ * messages over all workers of a pool.
+ * @param[in] pool          Pool created by bitter_pool_create
+ * @param[in] layout        Layout created by message_layout_init
+ * @param[in] messages      Array of message_cnt pointers to messages of
+ *                          layout message_len words each
+ * @param[in] message_cnt   Number of messages
+ * @param[out] columns      Array of field_cnt value columns, each receiving
+ *                          message_cnt WORD_T values
+ * @returns                 Number of messages decoded, negative value in
+ *                          case of error
+ */
+int decode_columns_ptr_mt(bitter_pool_t* pool, const message_layout_t* layout,
+                          const WORD_T* const messages[], int message_cnt,
+                          WORD_T* const columns[]) {
+    int rtc = run_column_job(pool, layout, messages, true, message_cnt,
+                             columns, decode_job);
+    TRACE(BITTER_TRACE_DECODE_COLUMNS, -1, layout->end_bit, rtc);
+    return rtc;
+}
@@ -0,0 +1,255 @@
+/// @file search.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "trace.h"
+
+
+#if WORD_BIT_LEN == 64
+    #define clz_word(v)     __builtin_clzll(v)
+#else
+    #define clz_word(v)     __builtin_clz(v)
+#endif
+
+// Bit planes of the mismatch counters, enough for counts up to word len.
+#define COUNTER_PLANES  7
+
+
+// Message word k in host-byte-order, 0 after the end of message.
+static inline WORD_T load_word_or_0(const WORD_T message[],
+                                    int64_t message_len, int64_t k) {
+    return (k < message_len ? WORD_NTOH(message[k]) : 0);
+}
+
+// Word of bits starting at bit s (0 <= s < word len) of words a, b.
+static inline WORD_T funnel(WORD_T a, WORD_T b, int s) {
+    return (s == 0 ? a : (a << s) | (b >> (WORD_BIT_LEN - s)));
+}
+
+
+/*
+ * Tests the word len positions base to base + word len - 1 at once and
+ * returns a word with the MSB set if the pattern matches at base, the next
+ * bit set if it matches at base + 1 and so on.
+ *
+ * Bit i of the pattern has to be compared with the message bits base + i
+ * to base + i + word len - 1, which form one (funnel shifted) word. Xoring
+ * it with bit i repeated gives the mismatches of all positions for that
+ * bit. For exact matches they are ORed, otherwise counted per position in
+ * bit sliced counters (plane b holding bit b of all counters). The loop
+ * stops as soon as no position can match anymore, for random data after a
+ * few bits.
+ */
+static WORD_T match_block(const WORD_T message[], int64_t message_len,
+                          int64_t base, WORD_T pattern, int pattern_len,
+                          int max_errors) {
+    int64_t k = base / WORD_BIT_LEN;
+    int o = base % WORD_BIT_LEN;
+    WORD_T w0 = load_word_or_0(message, message_len, k);
+    WORD_T w1 = load_word_or_0(message, message_len, k + 1);
+    WORD_T w2 = load_word_or_0(message, message_len, k + 2);
+    const WORD_T all = ~(WORD_T)0;
+
+    if(max_errors == 0) {
+        WORD_T mismatch = 0;
+        for(int i=0; i<pattern_len && mismatch!=all; i++) {
+            int s = o + i;
+            WORD_T v = (s < WORD_BIT_LEN ? funnel(w0, w1, s) :
+                                           funnel(w1, w2, s - WORD_BIT_LEN));
+            mismatch |= v ^ -((pattern >> (pattern_len - 1 - i)) & 1);
+        }
+        return ~mismatch;
+    }
+
+    // max_errors < 2^planes, larger counts set over.
+    int planes = 32 - __builtin_clz(max_errors);
+    WORD_T counter[COUNTER_PLANES] = {0};
+    WORD_T over = 0;
+    WORD_T too_many = 0;
+    for(int i=0; i<pattern_len; i++) {
+        int s = o + i;
+        WORD_T v = (s < WORD_BIT_LEN ? funnel(w0, w1, s) :
+                                       funnel(w1, w2, s - WORD_BIT_LEN));
+        WORD_T carry = v ^ -((pattern >> (pattern_len - 1 - i)) & 1);
+        for(int b=0; b<planes; b++) {
+            WORD_T t = counter[b] & carry;
+            counter[b] ^= carry;
+            carry = t;
+        }
+        over |= carry;
+
+        // Every 8 bits and at the end, flag counters > max_errors.
+        if((i & 7) == 7 || i == pattern_len - 1) {
+            WORD_T eq = ~over;
+            too_many = over;
+            for(int b=planes-1; b>=0; b--) {
+                if((max_errors >> b) & 1)
+                    eq &= counter[b];
+                else {
+                    too_many |= eq & counter[b];
+                    eq &= ~counter[b];
+                }
+            }
+            if(too_many == all)
+                break;
+        }
+    }
+    return ~too_many;
+}
+
+
+// Validates the arguments of the find functions, 0 if valid.
+static int find_error(int64_t message_len, int64_t start_bit, int64_t bit_len,
+                      int pattern_len, int max_errors) {
+    if(start_bit < 0 || start_bit >= message_len * WORD_BIT_LEN)
+        return -1;
+    if(bit_len < 0 || pattern_len < 1 || pattern_len > WORD_BIT_LEN ||
+       max_errors < 0)
+        return -2;
+    if(bit_len > message_len * WORD_BIT_LEN - start_bit)
+        return -3;
+    return 0;
+}
+
+
+/*
+ * Calls match_block for all positions of the range a pattern fits at and
+ * stores the matching positions, at most max_positions if positions is
+ * not NULL. Returns the number of matches.
+ */
+static int64_t find_matches(const WORD_T message[], int64_t message_len,
+                            int64_t start_bit, int64_t bit_len,
+                            WORD_T pattern, int pattern_len, int max_errors,
+                            int64_t positions[], int64_t max_positions) {
+    int64_t last = start_bit + bit_len - pattern_len;
+    int64_t cnt = 0;
+
+    if(pattern_len < WORD_BIT_LEN)
+        pattern &= ((WORD_T)1 << pattern_len) - 1;
+    if(max_errors > pattern_len)
+        max_errors = pattern_len;
+
+    for(int64_t base=start_bit; base<=last; base+=WORD_BIT_LEN) {
+        WORD_T m = match_block(message, message_len, base, pattern,
+                               pattern_len, max_errors);
+        // Only positions up to last.
+        if(last - base < WORD_BIT_LEN - 1)
+            m &= ~(~(WORD_T)0 >> (last - base + 1));
+
+        for(; m!=0; cnt++) {
+            int j = clz_word(m);
+            if(positions != NULL) {
+                if(cnt == max_positions)
+                    return cnt;
+                positions[cnt] = base + j;
+            }
+            m &= ~((WORD_T)1 << (WORD_BIT_LEN - 1 - j));
+        }
+    }
+    return cnt;
+}
+
+
+/**
+ * message_find searches a bit pattern, e.g. a frame sync word, at any bit
+ * position of a range of a binary message. Word len positions are tested
+ * at once by word wide bit operations.
+ * @param[in] message       Message array of n words
+ * @param[in] message_len   Number of words in message
+ * @param[in] start_bit     Absolute bit position where search starts
+ * @param[in] bit_len       Number of bits to search, the whole pattern has
+ *                          to fit into the range
+ * @param[in] pattern       Pattern to search (in the lower bits)
+ * @param[in] pattern_len   Number of bits (1-n) of pattern
+ * @param[in] max_errors    Number of bits which may differ from pattern
+ *                          (Hamming distance), 0 for exact matches
+ * @returns                 Bit position of the first match.
+ *                          -1 if start_bit is outside message.
+ *                          -2 if bit_len, pattern_len or max_errors is out of
+ *                          range.
+ *                          -3 if the range spans over the end of message.
+ *                          -4 if the pattern was not found.
+ */
+int message_find(const WORD_T message[], int message_len, int start_bit,
+                 int bit_len, WORD_T pattern, int pattern_len,
+                 int max_errors) {
+    return (int)message_find_l(message, message_len, start_bit, bit_len,
+                               pattern, pattern_len, max_errors);
+}
+
+
+// message_find_l without tracing.
+int64_t do_message_find_l(const WORD_T message[], int64_t message_len,
+                          int64_t start_bit, int64_t bit_len, WORD_T pattern,
+                          int pattern_len, int max_errors) {
+    int rtc = find_error(message_len, start_bit, bit_len, pattern_len,
+                         max_errors);
+    if(rtc < 0)
+        return rtc;
+
+    int64_t position;
+    if(find_matches(message, message_len, start_bit, bit_len, pattern,
+                    pattern_len, max_errors, &position, 1) == 0)
+        return -4;
+    return position;
+}
+
+
+/**
+ * message_find_l - same as message_find but with 64 bit message length, bit
+ * positions and lengths for messages larger than 2^31 bits.
+ */
+int64_t message_find_l(const WORD_T message[], int64_t message_len,
+                       int64_t start_bit, int64_t bit_len, WORD_T pattern,
+                       int pattern_len, int max_errors) {
+    int64_t rtc = do_message_find_l(message, message_len, start_bit, bit_len,
+                                    pattern, pattern_len, max_errors);
+    TRACE(BITTER_TRACE_MESSAGE_FIND, start_bit, bit_len, rtc);
+    return rtc;
+}
+
+
+// message_find_all without tracing.
+int64_t do_message_find_all(const WORD_T message[], int64_t message_len,
+                            int64_t start_bit, int64_t bit_len, WORD_T pattern,
+                            int pattern_len, int max_errors,
+                            int64_t positions[], int64_t max_positions) {
+    int rtc = find_error(message_len, start_bit, bit_len, pattern_len,
+                         max_errors);
+    if(rtc < 0)
+        return rtc;
+    if(positions != NULL && max_positions < 0)
+        return -2;
+    return find_matches(message, message_len, start_bit, bit_len, pattern,
+                        pattern_len, max_errors, positions, max_positions);
+}
+
+
+/**
+ * message_find_all - same as message_find_l but finds all matches, also
+ * overlapping ones.
+ * @param[out] positions    Receives bit positions of matches in ascending
+ *                          order, NULL to only count them
+ * @param[in] max_positions Size of positions, the search stops when it is
+ *                          full. Continue at the last position + 1.
+ * @returns                 Number of matches, negative value in case of error
+ *                          (see message_find), -2 also if max_positions is
+ *                          negative
+ */
+int64_t message_find_all(const WORD_T message[], int64_t message_len,
+                         int64_t start_bit, int64_t bit_len, WORD_T pattern,
+                         int pattern_len, int max_errors,
+                         int64_t positions[], int64_t max_positions) {
+    int64_t rtc = do_message_find_all(message, message_len, start_bit, bit_len,
+                                      pattern, pattern_len, max_errors,
+                                      positions, max_positions);
+    TRACE(BITTER_TRACE_MESSAGE_FIND_ALL, start_bit, bit_len, rtc);
+    return rtc;
+}
@@ -0,0 +1,15 @@
+/// @file single.c
+
+#include "single_impl.h"
+
+
+/*
+ * Portable single field kernels. See single_impl.h for the implementation.
+ *
+ * set_bits - inserts 1-n bits of value at bit offset mo of message word 0.
+ * get_bits - extracts 1-n bits at bit offset mo of message word 0.
+ * set_bits_h/get_bits_h - same for messages in host-byte-order.
+ *
+ * Message word 1 is only accessed if the field crosses into it.
+ */
+DEFINE_SINGLE_KERNELS(scalar)
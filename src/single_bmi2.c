@@ -0,0 +1,13 @@
+/// @file single_bmi2.c
+
+#include "bitter.h"
+
+#if WORD_BIT_LEN == 64 && defined(__x86_64__)
+
+// Variable shifts become SHLX/SHRX and masks BZHI/ANDN.
+#pragma GCC target("bmi,bmi2")
+#include "single_impl.h"
+
+DEFINE_SINGLE_KERNELS(bmi2)
+
+#endif
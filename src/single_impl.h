@@ -0,0 +1,115 @@
+/// @file single_impl.h
+/// Generic implementation of the single field kernels used by
+/// set_message_bits and get_message_bits. This file is included by the per
+/// instruction set kernel files, each of them instantiating the kernels
+/// with DEFINE_SINGLE_KERNELS(<suffix>). Masks are built by shifts (or BZHI
+/// when compiled for BMI2) instead of pow_i loops.
+
+#ifndef _SINGLE_IMPL_H_
+#define _SINGLE_IMPL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bitter.h"
+#include "kernels.h"
+
+#if defined(__BMI2__) && WORD_BIT_LEN == 64
+#include <immintrin.h>
+#endif
+
+
+// Mask with the <n> most significant bits of a word set (1 <= n <= word len).
+static inline __attribute__((always_inline)) WORD_T mask_high(int n) {
+#if defined(__BMI2__) && WORD_BIT_LEN == 64
+    return ~_bzhi_u64(~(WORD_T)0, WORD_BIT_LEN - n);
+#else
+    return ~(WORD_T)0 << (WORD_BIT_LEN - n);
+#endif
+}
+
+
+// Message words are in network-byte-order, or in host-byte-order for
+// working messages (host true). host is a constant in every instance, so
+// the unused conversion is removed by the compiler.
+static inline __attribute__((always_inline))
+WORD_T load_word(const WORD_T* w, bool host) {
+    return (host ? *w : WORD_NTOH(*w));
+}
+
+static inline __attribute__((always_inline))
+void store_word(WORD_T* w, WORD_T v, bool host) {
+    *w = (host ? v : WORD_HTON(v));
+}
+
+
+/*
+ * The field is MSB aligned in a word v first. It is then shifted right by
+ * mo into message word 0, bits shifted out are shifted left by
+ * (word_bit_len - mo) into message word 1. Message word 1 is only touched
+ * if the field crosses the word boundary.
+ */
+static inline __attribute__((always_inline))
+void set_bits_generic(WORD_T message[], int mo, int bit_len,
+                      WORD_T value, bool erase, bool start_low, bool host) {
+
+    WORD_T mask = mask_high(bit_len);
+    WORD_T v = (start_low ? value << (WORD_BIT_LEN - bit_len) : value & mask);
+
+    WORD_T m = load_word(&message[0], host);
+    if(erase)
+        m &= ~(mask >> mo);
+    m |= v >> mo;
+    store_word(&message[0], m, host);
+
+    // Handle message word crossing.
+    if(mo + bit_len > WORD_BIT_LEN) {
+        m = load_word(&message[1], host);
+        if(erase)
+            m &= ~(mask << (WORD_BIT_LEN - mo));
+        m |= v << (WORD_BIT_LEN - mo);
+        store_word(&message[1], m, host);
+    }
+}
+
+
+static inline __attribute__((always_inline))
+WORD_T get_bits_generic(const WORD_T message[], int mo, int bit_len,
+                        bool start_low, bool host) {
+
+    WORD_T v = load_word(&message[0], host) << mo;
+
+    // Handle message word crossing.
+    if(mo + bit_len > WORD_BIT_LEN)
+        v |= load_word(&message[1], host) >> (WORD_BIT_LEN - mo);
+
+    v &= mask_high(bit_len);
+    if(start_low)
+        v = v >> (WORD_BIT_LEN - bit_len);
+    return v;
+}
+
+
+// Instantiates the exported kernels of one instruction set, the _h
+// kernels work on messages in host-byte-order.
+#define DEFINE_SINGLE_KERNELS(suffix)                                       \
+void set_bits_##suffix(WORD_T message[], int mo, int bit_len,               \
+        WORD_T value, bool erase, bool start_low) {                         \
+    set_bits_generic(message, mo, bit_len, value, erase, start_low, false); \
+}                                                                           \
+WORD_T get_bits_##suffix(const WORD_T message[], int mo, int bit_len,       \
+        bool start_low) {                                                   \
+    return get_bits_generic(message, mo, bit_len, start_low, false);        \
+}                                                                           \
+void set_bits_h_##suffix(WORD_T message[], int mo, int bit_len,             \
+        WORD_T value, bool erase, bool start_low) {                         \
+    set_bits_generic(message, mo, bit_len, value, erase, start_low, true);  \
+}                                                                           \
+WORD_T get_bits_h_##suffix(const WORD_T message[], int mo, int bit_len,     \
+        bool start_low) {                                                   \
+    return get_bits_generic(message, mo, bit_len, start_low, true);         \
+}
+
+#endif
@@ -34,3 +34,18 @@ int rand_in_range(int min, int max) {
     double range = max - min + 1;
     return min + (int) (rand() * scale * range);
 }
+
+
+/**
+ * rand_in_range_r - Same as rand_in_range but thread safe, the state of the
+ * random number generator is kept in seed. Use one seed per thread.
+ * @param[in] seed  random number generator state
+ * @param[in] min   minimum value
+ * @param[in] max   maximum value
+ * @return          random value between min and max
+ */
+int rand_in_range_r(unsigned int* seed, int min, int max) {
+    double scale = 1.0 / ((uint64_t)RAND_MAX + 1);
+    double range = max - min + 1;
+    return min + (int) (rand_r(seed) * scale * range);
+}
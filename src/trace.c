@@ -0,0 +1,607 @@
+/// @file trace.c
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "bitter.h"
+#include "trace.h"
+
+
+/*
+ * Each thread records its events into its own ring and counts calls in its
+ * own statistics, so recording needs no locks and no atomic
+ * read-modify-write. The owner thread writes an event at head and then
+ * publishes it by advancing head. Readers copy a ring without stopping the
+ * owner and drop the events which may have been overwritten while copying.
+ * Slots are accessed with relaxed atomics and ordered by fences, so this
+ * also holds on weakly ordered CPUs.
+ * A ring has one slot more than events kept, for the event being written
+ * while a reader copies. Counters are only written by the owner, clearing
+ * them saves the current values as base instead.
+ *
+ * The state of a thread is never freed, the state of an exited thread
+ * keeps its events and counts and is taken over by the next new thread.
+ */
+#define RING_SLOTS      (BITTER_TRACE_EVENTS + 1)
+
+typedef struct trace_thread {
+    struct trace_thread* next;      // List of all thread states.
+    atomic_int in_use;              // Owned by a running thread.
+    uint32_t thread;                // Thread id of owner.
+    _Atomic uint64_t head;          // Number of events ever written.
+    _Atomic uint64_t start;         // First event after bitter_trace_clear.
+    bitter_trace_event_t events[RING_SLOTS];
+    bitter_stats_t stats[BITTER_TRACE_FUNCTIONS];
+    bitter_stats_t stats_base[BITTER_TRACE_FUNCTIONS];
+} trace_thread_t;
+
+// Trace file header, followed by the events.
+typedef struct {
+    char magic[4];                  // "BTRC"
+    uint16_t version;
+    uint16_t event_size;            // sizeof(bitter_trace_event_t)
+    uint32_t word_bit_len;
+    uint32_t event_cnt;
+} trace_header_t;
+
+int bitter_trace_on;
+
+static _Atomic(trace_thread_t*) threads;
+static __thread trace_thread_t* thread_state;
+static pthread_key_t thread_key;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char* trace_path;
+static const char* stats_path;
+
+static const char* function_names[BITTER_TRACE_FUNCTIONS] = {
+    "",
+    "set_message_bits", "get_message_bits",
+    "set_message_bits2", "get_message_bits2",
+    "set_message_bits3", "get_message_bits3",
+    "set_message_bits_h", "get_message_bits_h",
+    "set_message_bits_le", "get_message_bits_le",
+    "set_message_bits2_le", "get_message_bits2_le",
+    "set_message_bits3_le", "get_message_bits3_le",
+    "set_message_bits2_h", "get_message_bits2_h",
+    "set_message_bits3_h", "get_message_bits3_h",
+    "set_buffer_bits", "get_buffer_bits",
+    "set_buffer_bits3", "get_buffer_bits3",
+    "bit_writer_put", "bit_writer_flush", "bit_reader_get",
+    "encode_fields", "decode_fields",
+    "encode_columns", "decode_columns", "decode_columns_buffer",
+    "message_crc", "message_crc_update",
+    "message_find", "message_find_all",
+    "copy_message_bits", "fill_message_bits", "clear_message_bits",
+    "insert_message_bits", "delete_message_bits",
+    "message_finalize", "message_load",
+    "bitstream_set_bits", "bitstream_get_bits",
+    "bitstream_set_bits3", "bitstream_get_bits3",
+    "bitstream_insert_bits", "bitstream_delete_bits",
+    "bitstream_find", "bitstream_find_all"
+};
+
+// Error codes counted by bitter_stats_t errors, the last one counts all
+// other codes.
+static const int error_codes[BITTER_STATS_ERRORS] = {
+    -1, -2, -3, -10, -20, -30, -100, -200, -300, 0
+};
+
+
+// Called when a thread with a trace state exits.
+static void release_thread(void* state) {
+    atomic_store_explicit(&((trace_thread_t*)state)->in_use, 0,
+                          memory_order_release);
+}
+
+
+// Takes over the state of an exited thread or adds a new state.
+static trace_thread_t* acquire_thread(void) {
+    trace_thread_t* t;
+
+    for(t = atomic_load(&threads); t != NULL; t = t->next) {
+        int unused = 0;
+        if(atomic_compare_exchange_strong(&t->in_use, &unused, 1))
+            break;
+    }
+    if(t == NULL) {
+        t = calloc(1, sizeof(trace_thread_t));
+        if(t == NULL)
+            return NULL;
+        atomic_init(&t->in_use, 1);
+        t->next = atomic_load(&threads);
+        while(!atomic_compare_exchange_weak(&threads, &t->next, t))
+            ;
+    }
+    t->thread = (uint32_t)syscall(SYS_gettid);
+    pthread_setspecific(thread_key, t);
+    return t;
+}
+
+
+// Copies an event field by field with relaxed atomic accesses, as readers
+// copy slots the owner may be writing at the same time.
+static void copy_event(bitter_trace_event_t* dst,
+                       const bitter_trace_event_t* src) {
+#define COPY_FIELD(f) \
+    __atomic_store_n(&dst->f, __atomic_load_n(&src->f, __ATOMIC_RELAXED), \
+                     __ATOMIC_RELAXED)
+    COPY_FIELD(time_ns);
+    COPY_FIELD(start_bit);
+    COPY_FIELD(bit_len);
+    COPY_FIELD(result);
+    COPY_FIELD(thread);
+    COPY_FIELD(function);
+    COPY_FIELD(flags);
+#undef COPY_FIELD
+}
+
+
+static void record_event(trace_thread_t* t, int function, int64_t start_bit,
+                         int64_t bit_len, int64_t result, bool crossing) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    bitter_trace_event_t event = {
+        .time_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec,
+        .start_bit = start_bit,
+        .bit_len = bit_len,
+        .result = result,
+        .thread = t->thread,
+        .function = (uint16_t)function,
+        .flags = (crossing ? BITTER_TRACE_CROSSING : 0)
+    };
+
+    // Like a seqlock: the slot is only overwritten after the head published
+    // by the previous call, so a reader which sees any of the new slot
+    // fields also sees that head when it checks head again (copy_ring).
+    uint64_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    copy_event(&t->events[head % RING_SLOTS], &event);
+    atomic_store_explicit(&t->head, head + 1, memory_order_release);
+}
+
+
+// Index of result in bitter_stats_t errors.
+static int error_index(int64_t result) {
+    for(int i=0; i<BITTER_STATS_ERRORS - 1; i++)
+        if(result == error_codes[i])
+            return i;
+    return BITTER_STATS_ERRORS - 1;
+}
+
+
+// Index of bit_len in bitter_stats_t bit_lens.
+static int bit_len_index(int64_t bit_len) {
+    if(bit_len <= WORD_BIT_LEN)
+        return (int)bit_len;
+    int i = WORD_BIT_LEN + 1;
+    for(int64_t max = 2 * WORD_BIT_LEN; bit_len > max &&
+        i < BITTER_STATS_BIT_LENS - 1; max *= 2)
+        i++;
+    return i;
+}
+
+
+// Increments a counter only written by the owner thread, readers see either
+// the old or the new value.
+static inline void count(uint64_t* counter) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1,
+                     __ATOMIC_RELAXED);
+}
+
+static void count_event(trace_thread_t* t, int function, int64_t bit_len,
+                        int64_t result, bool crossing) {
+    bitter_stats_t* s = &t->stats[function];
+    count(&s->calls);
+    if(crossing)
+        count(&s->crossing);
+    if(result < 0)
+        count(&s->errors[error_index(result)]);
+    if(bit_len >= 0)
+        count(&s->bit_lens[bit_len_index(bit_len)]);
+}
+
+
+/*
+ * Records one call of a bit function into the ring and/or the statistics of
+ * the calling thread. Only called through the TRACE macro when tracing or
+ * statistics are enabled.
+ */
+void trace_event(int function, int64_t start_bit, int64_t bit_len,
+                 int64_t result) {
+    trace_thread_t* t = thread_state;
+    if(t == NULL && (t = thread_state = acquire_thread()) == NULL)
+        return;
+
+    int on = __atomic_load_n(&bitter_trace_on, __ATOMIC_RELAXED);
+    bool crossing = (start_bit >= 0 && bit_len > 0 &&
+                     start_bit % WORD_BIT_LEN + bit_len > WORD_BIT_LEN);
+    if(on & TRACE_STATS)
+        count_event(t, function, bit_len, result, crossing);
+    if(on & TRACE_EVENTS)
+        record_event(t, function, start_bit, bit_len, result, crossing);
+}
+
+
+/**
+ * bitter_trace_enable - enables or disables recording of calls of the bit
+ * functions. Can be called at any time from any thread.
+ * @param[in] enable        true to record calls
+ */
+void bitter_trace_enable(bool enable) {
+    if(enable)
+        __atomic_fetch_or(&bitter_trace_on, TRACE_EVENTS, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_and(&bitter_trace_on, ~TRACE_EVENTS, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * bitter_trace_enabled - returns if calls are recorded.
+ * @returns                 true if tracing is enabled
+ */
+bool bitter_trace_enabled(void) {
+    return (__atomic_load_n(&bitter_trace_on, __ATOMIC_RELAXED) &
+            TRACE_EVENTS) != 0;
+}
+
+
+/**
+ * bitter_trace_clear - discards all events recorded so far by all threads.
+ */
+void bitter_trace_clear(void) {
+    for(trace_thread_t* t = atomic_load(&threads); t != NULL; t = t->next)
+        atomic_store(&t->start, atomic_load(&t->head));
+}
+
+
+/*
+ * Copies the events still in the ring of t to events, oldest first. Returns the
+ * number of events copied.
+ */
+static int copy_ring(trace_thread_t* t, bitter_trace_event_t events[]) {
+    uint64_t head = atomic_load_explicit(&t->head, memory_order_acquire);
+    uint64_t first = atomic_load(&t->start);
+    if(head > BITTER_TRACE_EVENTS && first < head - BITTER_TRACE_EVENTS)
+        first = head - BITTER_TRACE_EVENTS;
+
+    for(uint64_t i=first; i<head; i++)
+        copy_event(&events[i - first], &t->events[i % RING_SLOTS]);
+
+    // Events the owner may have overwritten while copying, including the
+    // one it is writing right now, are dropped.
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t now = atomic_load_explicit(&t->head, memory_order_relaxed);
+    uint64_t valid = (now + 1 > RING_SLOTS ? now + 1 - RING_SLOTS : 0);
+    if(valid <= first)
+        return (int)(head - first);
+    if(valid >= head)
+        return 0;
+    memmove(events, &events[valid - first],
+            (head - valid) * sizeof(bitter_trace_event_t));
+    return (int)(head - valid);
+}
+
+
+static int compare_events(const void* a, const void* b) {
+    uint64_t ta = ((const bitter_trace_event_t*)a)->time_ns;
+    uint64_t tb = ((const bitter_trace_event_t*)b)->time_ns;
+    return (ta > tb) - (ta < tb);
+}
+
+
+/*
+ * Collects the events of all threads sorted by time into a new array. Returns
+ * the number of events or -5 if out of memory.
+ */
+static int collect_events(bitter_trace_event_t** events) {
+    // States are only added at the head of the list, states added
+    // meanwhile are not part of the list taken here.
+    trace_thread_t* list = atomic_load(&threads);
+    int thread_cnt = 0;
+    for(trace_thread_t* t = list; t != NULL; t = t->next)
+        thread_cnt++;
+
+    *events = malloc(((size_t)thread_cnt * BITTER_TRACE_EVENTS + 1) *
+                     sizeof(bitter_trace_event_t));
+    if(*events == NULL)
+        return -5;
+
+    int cnt = 0;
+    for(trace_thread_t* t = list; t != NULL; t = t->next)
+        cnt += copy_ring(t, &(*events)[cnt]);
+    qsort(*events, cnt, sizeof(bitter_trace_event_t), compare_events);
+    return cnt;
+}
+
+
+/**
+ * bitter_trace_snapshot - copies the most recent events of all threads,
+ * sorted by time. Recording continues while copying.
+ * @param[out] events       Array receiving the events
+ * @param[in] max_events    Number of events fitting into events
+ * @returns                 Number of events copied, negative value in case
+ *                          of error
+ */
+int bitter_trace_snapshot(bitter_trace_event_t events[], int max_events) {
+    if(events == NULL || max_events < 0)
+        return -1;
+
+    bitter_trace_event_t* all;
+    int cnt = collect_events(&all);
+    if(cnt < 0)
+        return cnt;
+
+    int first = (cnt > max_events ? cnt - max_events : 0);
+    memcpy(events, &all[first], (cnt - first) * sizeof(bitter_trace_event_t));
+    free(all);
+    return cnt - first;
+}
+
+
+/**
+ * bitter_trace_write - writes the events of all threads, sorted by time, to
+ * a binary trace file. Use tools/bittrace.py to render the file.
+ * @param[in] path          Trace file to create
+ * @returns                 Number of events written, negative value in case
+ *                          of error
+ */
+int bitter_trace_write(const char* path) {
+    if(path == NULL)
+        return -1;
+
+    bitter_trace_event_t* events;
+    int cnt = collect_events(&events);
+    if(cnt < 0)
+        return cnt;
+
+    trace_header_t header = {
+        .magic = {'B', 'T', 'R', 'C'},
+        .version = 1,
+        .event_size = sizeof(bitter_trace_event_t),
+        .word_bit_len = WORD_BIT_LEN,
+        .event_cnt = cnt
+    };
+    int rtc = cnt;
+    FILE* fd = fopen(path, "wb");
+    if(fd == NULL)
+        rtc = -6;
+    else {
+        if(fwrite(&header, sizeof(header), 1, fd) != 1 ||
+           fwrite(events, sizeof(bitter_trace_event_t), cnt, fd) !=
+           (size_t)cnt)
+            rtc = -6;
+        if(fclose(fd) != 0)
+            rtc = -6;
+    }
+    free(events);
+    return rtc;
+}
+
+
+/**
+ * bitter_trace_name - returns the name of a traced function.
+ * @param[in] function      BITTER_TRACE_* function of an event
+ * @returns                 Function name, NULL for an unknown function
+ */
+const char* bitter_trace_name(int function) {
+    if(function < 1 || function >= BITTER_TRACE_FUNCTIONS)
+        return NULL;
+    return function_names[function];
+}
+
+
+/**
+ * bitter_stats_enable - enables or disables counting calls of the bit
+ * functions. Can be called at any time from any thread.
+ * @param[in] enable        true to count calls
+ */
+void bitter_stats_enable(bool enable) {
+    if(enable)
+        __atomic_fetch_or(&bitter_trace_on, TRACE_STATS, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_and(&bitter_trace_on, ~TRACE_STATS, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * bitter_stats_enabled - returns if calls are counted.
+ * @returns                 true if statistics are enabled
+ */
+bool bitter_stats_enabled(void) {
+    return (__atomic_load_n(&bitter_trace_on, __ATOMIC_RELAXED) &
+            TRACE_STATS) != 0;
+}
+
+
+// Adds the counters of s minus base to sum.
+static void add_stats(bitter_stats_t* sum, const bitter_stats_t* s,
+                      const bitter_stats_t* base) {
+    const uint64_t* c = (const uint64_t*)s;
+    const uint64_t* b = (const uint64_t*)base;
+    uint64_t* d = (uint64_t*)sum;
+    for(size_t i=0; i<sizeof(bitter_stats_t) / sizeof(uint64_t); i++)
+        d[i] += __atomic_load_n(&c[i], __ATOMIC_RELAXED) - b[i];
+}
+
+
+/**
+ * bitter_stats_clear - resets the counters of all threads to 0.
+ */
+void bitter_stats_clear(void) {
+    pthread_mutex_lock(&stats_lock);
+    for(trace_thread_t* t = atomic_load(&threads); t != NULL; t = t->next) {
+        const uint64_t* c = (const uint64_t*)t->stats;
+        uint64_t* b = (uint64_t*)t->stats_base;
+        size_t n = BITTER_TRACE_FUNCTIONS * sizeof(bitter_stats_t) /
+                   sizeof(uint64_t);
+        for(size_t i=0; i<n; i++)
+            b[i] = __atomic_load_n(&c[i], __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+
+/**
+ * bitter_stats_snapshot - merges the counters of all threads. stats[f] are
+ * the counters of the function with BITTER_TRACE_* id f, stats[0] the sum
+ * of all functions. Counting continues while merging.
+ * @param[out] stats        Array of BITTER_TRACE_FUNCTIONS statistics
+ * @returns                 Number of threads merged, negative value in case
+ *                          of error
+ */
+int bitter_stats_snapshot(bitter_stats_t stats[]) {
+    if(stats == NULL)
+        return -1;
+
+    memset(stats, 0, BITTER_TRACE_FUNCTIONS * sizeof(bitter_stats_t));
+    int thread_cnt = 0;
+    pthread_mutex_lock(&stats_lock);
+    for(trace_thread_t* t = atomic_load(&threads); t != NULL; t = t->next) {
+        for(int f=1; f<BITTER_TRACE_FUNCTIONS; f++)
+            add_stats(&stats[f], &t->stats[f], &t->stats_base[f]);
+        thread_cnt++;
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    bitter_stats_t zero = {0};
+    for(int f=1; f<BITTER_TRACE_FUNCTIONS; f++)
+        add_stats(&stats[0], &stats[f], &zero);
+    return thread_cnt;
+}
+
+
+/**
+ * bitter_stats_error_code - returns the error code counted by an element of
+ * bitter_stats_t errors.
+ * @param[in] index         Index in errors
+ * @returns                 Error code, 0 for the element counting all
+ *                          other codes
+ */
+int bitter_stats_error_code(int index) {
+    if(index < 0 || index >= BITTER_STATS_ERRORS)
+        return 0;
+    return error_codes[index];
+}
+
+
+/**
+ * bitter_stats_bit_len - returns the largest bit_len counted by an element of
+ * bitter_stats_t bit_lens. Up to WORD_BIT_LEN each element counts a single
+ * length, above each element counts lengths up to twice the previous one.
+ * @param[in] index         Index in bit_lens
+ * @returns                 Largest bit_len, INT64_MAX for the last element
+ */
+int64_t bitter_stats_bit_len(int index) {
+    if(index < 0)
+        return -1;
+    if(index <= WORD_BIT_LEN)
+        return index;
+    if(index >= BITTER_STATS_BIT_LENS - 1)
+        return INT64_MAX;
+    return (int64_t)WORD_BIT_LEN << (index - WORD_BIT_LEN);
+}
+
+
+/**
+ * bitter_stats_write - writes the merged counters of all functions called
+ * at least once as JSON.
+ * @param[in] fd            File to write to
+ * @returns                 Number of functions written, negative value in
+ *                          case of error
+ */
+int bitter_stats_write(FILE* fd) {
+    bitter_stats_t stats[BITTER_TRACE_FUNCTIONS];
+    if(fd == NULL)
+        return -1;
+    bitter_stats_snapshot(stats);
+
+    int cnt = 0;
+    fprintf(fd, "[");
+    for(int f=1; f<BITTER_TRACE_FUNCTIONS; f++) {
+        const bitter_stats_t* s = &stats[f];
+        if(s->calls == 0)
+            continue;
+        fprintf(fd, "%s\n  {\"function\": \"%s\", \"calls\": %" PRIu64 ", "
+            "\"crossing\": %" PRIu64 ",\n   \"errors\": {", (cnt ? "," : ""),
+            function_names[f], s->calls, s->crossing);
+        const char* sep = "";
+        for(int i=0; i<BITTER_STATS_ERRORS; i++) {
+            if(s->errors[i] == 0)
+                continue;
+            if(i < BITTER_STATS_ERRORS - 1)
+                fprintf(fd, "%s\"%d\": %" PRIu64, sep, error_codes[i],
+                    s->errors[i]);
+            else
+                fprintf(fd, "%s\"other\": %" PRIu64, sep, s->errors[i]);
+            sep = ", ";
+        }
+        // Histogram keys are the largest bit_len of a bucket.
+        fprintf(fd, "},\n   \"bit_len\": {");
+        sep = "";
+        for(int i=0; i<BITTER_STATS_BIT_LENS; i++) {
+            if(s->bit_lens[i] == 0)
+                continue;
+            if(i < BITTER_STATS_BIT_LENS - 1)
+                fprintf(fd, "%s\"%" PRId64 "\": %" PRIu64, sep,
+                    bitter_stats_bit_len(i), s->bit_lens[i]);
+            else
+                fprintf(fd, "%s\"max\": %" PRIu64, sep, s->bit_lens[i]);
+            sep = ", ";
+        }
+        fprintf(fd, "}}");
+        cnt++;
+    }
+    fprintf(fd, "\n]\n");
+    return (ferror(fd) ? -6 : cnt);
+}
+
+
+static void write_trace_at_exit(void) {
+    bitter_trace_enable(false);
+    if(bitter_trace_write(trace_path) < 0)
+        fprintf(stderr, "bitter: can not write trace file '%s'\n",
+            trace_path);
+}
+
+
+static void write_stats_at_exit(void) {
+    bitter_stats_enable(false);
+    FILE* fd = fopen(stats_path, "w");
+    if(fd == NULL || bitter_stats_write(fd) < 0 || fclose(fd) != 0)
+        fprintf(stderr, "bitter: can not write statistics file '%s'\n",
+            stats_path);
+}
+
+
+/*
+ * Setting the BITTER_TRACE or BITTER_STATS environment variable to a file
+ * name enables tracing or statistics when the library is loaded and writes
+ * the trace or statistics file when the process exits.
+ */
+__attribute__((constructor))
+static void init_trace(void) {
+    pthread_key_create(&thread_key, release_thread);
+
+    const char* env = getenv("BITTER_TRACE");
+    if(env != NULL && *env != '\0') {
+        trace_path = env;
+        atexit(write_trace_at_exit);
+        bitter_trace_enable(true);
+    }
+    env = getenv("BITTER_STATS");
+    if(env != NULL && *env != '\0') {
+        stats_path = env;
+        atexit(write_stats_at_exit);
+        bitter_stats_enable(true);
+    }
+}
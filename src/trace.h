@@ -0,0 +1,64 @@
+/// @file trace.h
+/// Internal trace hook of the bit functions. Events are recorded into per
+/// thread rings and counted in per thread statistics by trace.c, see
+/// bitter_trace_enable and bitter_stats_enable.
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bitter.h"
+
+
+// Bits of bitter_trace_on.
+#define TRACE_EVENTS    0x1
+#define TRACE_STATS     0x2
+
+// Hidden, so the flag is read PC relative and not through the GOT.
+extern int bitter_trace_on __attribute__((visibility("hidden")));
+
+extern void trace_event(int function, int64_t start_bit, int64_t bit_len,
+        int64_t result) __attribute__((visibility("hidden")));
+
+// Records a call of a bit function with its result. When tracing and
+// statistics are disabled this is a single predictable branch.
+#define TRACE(function, start_bit, bit_len, result)                         \
+    do {                                                                    \
+        if(__builtin_expect(__atomic_load_n(&bitter_trace_on,               \
+                                            __ATOMIC_RELAXED), 0))          \
+            trace_event(function, start_bit, bit_len, result);              \
+    } while(0)
+
+// Untraced versions of the public functions, for entry points built on
+// them, so a call is counted only once.
+extern int64_t do_set_message_bits_l(WORD_T message[], int64_t message_len,
+        int64_t start_bit, int bit_len, const WORD_T value, bool erase,
+        bool start_low) __attribute__((visibility("hidden")));
+extern int64_t do_get_message_bits_l(const WORD_T message[],
+        int64_t message_len, int64_t start_bit, int bit_len, WORD_T* value,
+        bool start_low) __attribute__((visibility("hidden")));
+extern int64_t do_set_message_bits3_l(WORD_T message[], int64_t message_len,
+        int64_t start_bit, int64_t bit_len, const uint8_t value[],
+        int64_t value_len, bool erase) __attribute__((visibility("hidden")));
+extern int64_t do_get_message_bits3_l(const WORD_T message[],
+        int64_t message_len, int64_t start_bit, int64_t bit_len,
+        uint8_t value[], int64_t value_len)
+        __attribute__((visibility("hidden")));
+extern int64_t do_copy_message_bits_l(WORD_T dst[], int64_t dst_len,
+        int64_t dst_bit, const WORD_T src[], int64_t src_len,
+        int64_t src_bit, int64_t bit_len)
+        __attribute__((visibility("hidden")));
+extern int64_t do_fill_message_bits_l(WORD_T message[], int64_t message_len,
+        int64_t start_bit, int64_t bit_len, WORD_T pattern, int pattern_len)
+        __attribute__((visibility("hidden")));
+extern int64_t do_message_find_l(const WORD_T message[], int64_t message_len,
+        int64_t start_bit, int64_t bit_len, WORD_T pattern, int pattern_len,
+        int max_errors) __attribute__((visibility("hidden")));
+extern int64_t do_message_find_all(const WORD_T message[],
+        int64_t message_len, int64_t start_bit, int64_t bit_len,
+        WORD_T pattern, int pattern_len, int max_errors, int64_t positions[],
+        int64_t max_positions) __attribute__((visibility("hidden")));
+
+#endif
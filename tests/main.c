@@ -17,14 +17,67 @@
 
 extern void test_binary_messages(void **state);
 extern void test_binary_messages2(void **state);
+extern void test_binary_messages2_R(void **state);
 extern void test_binary_messages3(void **state);
 extern void test_binary_messages3_R(void **state);
+extern void test_binary_messages3_tail(void **state);
 extern void test_binary_messages_R(void **state);
 extern void test_binary_messages_A(void **state);
 extern void test_binary_messages_B(void **state);
+extern void test_binary_messages_isa(void **state);
 extern void test_example_1_start_high(void **state);
 extern void test_example_1_start_low(void **state);
 extern void test_example_2(void **state);
+extern void test_bitstream_file(void **state);
+extern void test_bitstream_memory(void **state);
+extern void test_message_bits_l(void **state);
+extern void test_host_messages(void **state);
+extern void test_host_messages_wide(void **state);
+extern void test_host_all_isa(void **state);
+extern void test_host_bounds(void **state);
+extern void test_le_example(void **state);
+extern void test_le_R(void **state);
+extern void test_le_bulk_R(void **state);
+extern void test_le_bounds(void **state);
+extern void test_cpp_fields(void **state);
+extern void test_inline_R(void **state);
+extern void test_buffer_bits(void **state);
+extern void test_buffer_bits3(void **state);
+extern void test_buffer_message(void **state);
+extern void test_cursor_writer(void **state);
+extern void test_cursor_reader(void **state);
+extern void test_cursor_bounds(void **state);
+extern void test_fields_example(void **state);
+extern void test_fields_R(void **state);
+extern void test_fields_bounds(void **state);
+extern void test_fields_columns(void **state);
+extern void test_fields_buffer(void **state);
+extern void test_capture(void **state);
+extern void test_pool_run(void **state);
+extern void test_pool_columns(void **state);
+extern void test_rand_in_range_r(void **state);
+extern void test_trace_events(void **state);
+extern void test_trace_entry_points(void **state);
+extern void test_trace_threads(void **state);
+extern void test_trace_write(void **state);
+extern void test_trace_stats(void **state);
+
+extern void test_arena_alloc(void **state);
+extern void test_arena_zero(void **state);
+extern void test_arena_threads(void **state);
+
+extern void test_crc_presets(void **state);
+extern void test_crc_ranges(void **state);
+extern void test_crc_update(void **state);
+
+extern void test_find(void **state);
+extern void test_find_all(void **state);
+extern void test_find_bitstream(void **state);
+
+extern void test_copy_message_bits(void **state);
+extern void test_fill_message_bits(void **state);
+extern void test_insert_delete_bits(void **state);
+extern void test_insert_delete_bitstream(void **state);
 
 
 int main(void) {
@@ -36,16 +89,110 @@ int main(void) {
     const struct CMUnitTest test_basics[] = {
         cmocka_unit_test(test_binary_messages),
         cmocka_unit_test(test_binary_messages2),
+        cmocka_unit_test(test_binary_messages2_R),
         cmocka_unit_test(test_binary_messages3),
         cmocka_unit_test(test_binary_messages3_R),
+        cmocka_unit_test(test_binary_messages3_tail),
         cmocka_unit_test(test_binary_messages_A),
         cmocka_unit_test(test_binary_messages_R),
         cmocka_unit_test(test_binary_messages_B),
+        cmocka_unit_test(test_binary_messages_isa),
         cmocka_unit_test(test_example_1_start_high),
         cmocka_unit_test(test_example_1_start_low),
         cmocka_unit_test(test_example_2),
     };
 
+    const struct CMUnitTest test_bitstream[] = {
+        cmocka_unit_test(test_message_bits_l),
+        cmocka_unit_test(test_bitstream_file),
+        cmocka_unit_test(test_bitstream_memory),
+    };
+
+    const struct CMUnitTest test_host[] = {
+        cmocka_unit_test(test_host_messages),
+        cmocka_unit_test(test_host_messages_wide),
+        cmocka_unit_test(test_host_all_isa),
+        cmocka_unit_test(test_host_bounds),
+    };
+
+    const struct CMUnitTest test_le[] = {
+        cmocka_unit_test(test_le_example),
+        cmocka_unit_test(test_le_R),
+        cmocka_unit_test(test_le_bulk_R),
+        cmocka_unit_test(test_le_bounds),
+    };
+
+    const struct CMUnitTest test_cpp[] = {
+        cmocka_unit_test(test_cpp_fields),
+    };
+
+    const struct CMUnitTest test_inline[] = {
+        cmocka_unit_test(test_inline_R),
+    };
+
+    const struct CMUnitTest test_buffer[] = {
+        cmocka_unit_test(test_buffer_bits),
+        cmocka_unit_test(test_buffer_bits3),
+        cmocka_unit_test(test_buffer_message),
+    };
+
+    const struct CMUnitTest test_cursor[] = {
+        cmocka_unit_test(test_cursor_writer),
+        cmocka_unit_test(test_cursor_reader),
+        cmocka_unit_test(test_cursor_bounds),
+    };
+
+    const struct CMUnitTest test_fields[] = {
+        cmocka_unit_test(test_fields_example),
+        cmocka_unit_test(test_fields_R),
+        cmocka_unit_test(test_fields_bounds),
+        cmocka_unit_test(test_fields_columns),
+        cmocka_unit_test(test_fields_buffer),
+    };
+
+    const struct CMUnitTest test_capture_group[] = {
+        cmocka_unit_test(test_capture),
+    };
+
+    const struct CMUnitTest test_pool[] = {
+        cmocka_unit_test(test_pool_run),
+        cmocka_unit_test(test_pool_columns),
+        cmocka_unit_test(test_rand_in_range_r),
+    };
+
+    const struct CMUnitTest test_trace[] = {
+        cmocka_unit_test(test_trace_events),
+        cmocka_unit_test(test_trace_entry_points),
+        cmocka_unit_test(test_trace_threads),
+        cmocka_unit_test(test_trace_write),
+        cmocka_unit_test(test_trace_stats),
+    };
+
+    const struct CMUnitTest test_arena[] = {
+        cmocka_unit_test(test_arena_alloc),
+        cmocka_unit_test(test_arena_zero),
+        cmocka_unit_test(test_arena_threads),
+    };
+
+    const struct CMUnitTest test_crc[] = {
+        cmocka_unit_test(test_crc_presets),
+        cmocka_unit_test(test_crc_ranges),
+        cmocka_unit_test(test_crc_update),
+    };
+
+    const struct CMUnitTest test_search[] = {
+        cmocka_unit_test(test_find),
+        cmocka_unit_test(test_find_all),
+        cmocka_unit_test(test_find_bitstream),
+    };
+
+    const struct CMUnitTest test_copy[] = {
+        cmocka_unit_test(test_copy_message_bits),
+        cmocka_unit_test(test_fill_message_bits),
+        cmocka_unit_test(test_insert_delete_bits),
+        cmocka_unit_test(test_insert_delete_bitstream),
+    };
+
     // cmocka_set_message_output(CM_OUTPUT_XML);
 
     int failed_tests = 0;
@@ -53,6 +200,51 @@ int main(void) {
     printf("\n*** Test bitter functions ***\n\n");
     failed_tests += cmocka_run_group_tests(test_basics, NULL, NULL);
 
+    printf("\n*** Test bitter bitstream functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_bitstream, NULL, NULL);
+
+    printf("\n*** Test bitter host-byte-order functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_host, NULL, NULL);
+
+    printf("\n*** Test bitter LSB-first functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_le, NULL, NULL);
+
+    printf("\n*** Test bitter C++ field accessors ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_cpp, NULL, NULL);
+
+    printf("\n*** Test bitter inline functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_inline, NULL, NULL);
+
+    printf("\n*** Test bitter buffer functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_buffer, NULL, NULL);
+
+    printf("\n*** Test bitter cursor functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_cursor, NULL, NULL);
+
+    printf("\n*** Test bitter field layout functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_fields, NULL, NULL);
+
+    printf("\n*** Test bitter capture functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_capture_group, NULL, NULL);
+
+    printf("\n*** Test bitter thread pool functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_pool, NULL, NULL);
+
+    printf("\n*** Test bitter trace functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_trace, NULL, NULL);
+
+    printf("\n*** Test bitter arena functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_arena, NULL, NULL);
+
+    printf("\n*** Test bitter CRC functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_crc, NULL, NULL);
+
+    printf("\n*** Test bitter search functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_search, NULL, NULL);
+
+    printf("\n*** Test bitter copy functions ***\n\n");
+    failed_tests += cmocka_run_group_tests(test_copy, NULL, NULL);
+
     printf("\nTotal failed tests: %s%d%s\n\n",
         (failed_tests == 0 ? "\033[32m" : "\033[31m"),
         failed_tests,
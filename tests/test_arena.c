@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <pthread.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define THREAD_CNT   4
+#define ROUNDS       200
+#define LIVE_CNT     64
+
+
+static bool is_zero(const WORD_T* message, int64_t message_len) {
+    for(int64_t i=0; i<message_len; i++)
+        if(message[i] != 0)
+            return false;
+    return true;
+}
+
+void test_arena_alloc(void **state) {
+    bitter_arena_t* arena = bitter_arena_create(0);
+    assert_non_null(arena);
+
+    // Messages of all size classes are cache line aligned and usable.
+    for(int64_t len=1; len<=(int64_t)1 << 16; len*=4) {
+        WORD_T* message = bitter_arena_alloc(arena, len);
+        assert_non_null(message);
+        assert_int_equal((uintptr_t)message % 64, 0);
+        for(int64_t i=0; i<len; i++)
+            message[i] = i;
+        assert_int_equal(set_message_bits(message, len, 0, 8, 0xA5, true,
+            true), 8);
+        assert_int_equal(message[len - 1], len > 1 ? len - 1 : 0xA5);
+        bitter_arena_free(arena, message);
+    }
+
+    // A released message is handed out again for the same size class.
+    WORD_T* a = bitter_arena_alloc(arena, 4);
+    WORD_T* b = bitter_arena_alloc(arena, 4);
+    assert_non_null(a);
+    assert_non_null(b);
+    assert_true(b >= a + 8 || a >= b + 8);
+    bitter_arena_free(arena, a);
+    assert_true(bitter_arena_alloc(arena, 3) == a);
+    bitter_arena_free(arena, a);
+    bitter_arena_free(arena, b);
+
+    // Large messages get their own mapping.
+    WORD_T* large = bitter_arena_alloc(arena, 1 << 20);
+    assert_non_null(large);
+    assert_int_equal((uintptr_t)large % 64, 0);
+    large[0] = 1;
+    large[(1 << 20) - 1] = 2;
+    bitter_arena_free(arena, large);
+
+    assert_null(bitter_arena_alloc(arena, 0));
+    assert_null(bitter_arena_alloc(arena, -1));
+    assert_null(bitter_arena_alloc(NULL, 1));
+    bitter_arena_free(arena, NULL);
+    bitter_arena_free(NULL, a);
+    bitter_arena_reset(NULL);
+    bitter_arena_destroy(arena);
+    bitter_arena_destroy(NULL);
+}
+
+void test_arena_zero(void **state) {
+    bitter_arena_t* arena = bitter_arena_create(BITTER_ARENA_ZERO);
+    assert_non_null(arena);
+
+    WORD_T* messages[LIVE_CNT];
+    for(int i=0; i<LIVE_CNT; i++) {
+        messages[i] = bitter_arena_alloc(arena, 16);
+        assert_non_null(messages[i]);
+        assert_true(is_zero(messages[i], 16));
+        memset(messages[i], 0xFF, 16 * WORD_BYTE_LEN);
+    }
+
+    // Released messages come back zeroed.
+    for(int i=0; i<LIVE_CNT; i++)
+        bitter_arena_free(arena, messages[i]);
+    for(int i=0; i<LIVE_CNT; i++) {
+        messages[i] = bitter_arena_alloc(arena, 16);
+        assert_non_null(messages[i]);
+        assert_true(is_zero(messages[i], 16));
+        memset(messages[i], 0xFF, 16 * WORD_BYTE_LEN);
+    }
+
+    // Reset releases all messages at once, also zeroed.
+    bitter_arena_reset(arena);
+    for(int i=0; i<LIVE_CNT; i++) {
+        messages[i] = bitter_arena_alloc(arena, 16);
+        assert_non_null(messages[i]);
+        assert_true(is_zero(messages[i], 16));
+    }
+    bitter_arena_destroy(arena);
+
+    // Huge pages fall back to normal pages if none are available.
+    arena = bitter_arena_create(BITTER_ARENA_HUGE | BITTER_ARENA_ZERO);
+    assert_non_null(arena);
+    WORD_T* message = bitter_arena_alloc(arena, 100);
+    assert_non_null(message);
+    assert_int_equal((uintptr_t)message % 64, 0);
+    assert_true(is_zero(message, 100));
+    bitter_arena_free(arena, message);
+    bitter_arena_destroy(arena);
+}
+
+
+typedef struct {
+    bitter_arena_t* arena;
+    int thread;
+    int errors;
+} arena_job_t;
+
+static void* stress_arena(void* arg) {
+    arena_job_t* job = (arena_job_t*)arg;
+    WORD_T* messages[LIVE_CNT] = {0};
+    int64_t lens[LIVE_CNT] = {0};
+    unsigned int seed = job->thread;
+
+    // Keep messages of random sizes alive and check no other thread wrote
+    // to them before they are released.
+    for(int round=0; round<ROUNDS; round++) {
+        for(int i=0; i<LIVE_CNT; i++) {
+            if(messages[i] != NULL) {
+                for(int64_t k=0; k<lens[i]; k++)
+                    if(messages[i][k] != ((WORD_T)job->thread << 32 | i))
+                        job->errors++;
+                if(rand_r(&seed) % 2 == 0)
+                    continue;
+                bitter_arena_free(job->arena, messages[i]);
+            }
+            lens[i] = rand_in_range_r(&seed, 1, 300);
+            messages[i] = bitter_arena_alloc(job->arena, lens[i]);
+            if(messages[i] == NULL) {
+                job->errors++;
+                continue;
+            }
+            for(int64_t k=0; k<lens[i]; k++)
+                messages[i][k] = (WORD_T)job->thread << 32 | i;
+        }
+    }
+    for(int i=0; i<LIVE_CNT; i++)
+        bitter_arena_free(job->arena, messages[i]);
+    return NULL;
+}
+
+void test_arena_threads(void **state) {
+    bitter_arena_t* arena = bitter_arena_create(0);
+    assert_non_null(arena);
+    pthread_t threads[THREAD_CNT];
+    arena_job_t jobs[THREAD_CNT];
+
+    // Twice to reuse memory released by the exited threads.
+    for(int run=0; run<2; run++) {
+        for(int i=0; i<THREAD_CNT; i++) {
+            jobs[i] = (arena_job_t){ .arena = arena, .thread = i + 1 };
+            assert_int_equal(pthread_create(&threads[i], NULL, stress_arena,
+                &jobs[i]), 0);
+        }
+        for(int i=0; i<THREAD_CNT; i++) {
+            pthread_join(threads[i], NULL);
+            dbg_printf("run(%d), thread(%d), errors(%d)\n", run, i,
+                jobs[i].errors);
+            assert_int_equal(jobs[i].errors, 0);
+        }
+    }
+    bitter_arena_destroy(arena);
+}
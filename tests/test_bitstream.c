@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+// 8 GBit (1 GiB) sparse stream file, only touched pages use disk space.
+#define STREAM_BITS  (8LL << 30)
+#define FIELD_CNT    200
+
+
+static int64_t rand_pos(int64_t max) {
+    return (int64_t)(((uint64_t)rand_word() >> 1) % max);
+}
+
+void test_bitstream_file(void **state) {
+    char path[] = "/tmp/bitter_stream_XXXXXX";
+    int fd = mkstemp(path);
+    assert_true(fd >= 0);
+    close(fd);
+
+    int64_t pos[FIELD_CNT];
+    int len[FIELD_CNT];
+    WORD_T val[FIELD_CNT];
+
+    // Fields beyond 2^31 and 2^32 bits in a file backed stream.
+    bitstream_t bs;
+    assert_int_equal(bitstream_create(&bs, path, STREAM_BITS + 3), 0);
+    assert_int_equal(bs.bit_len, STREAM_BITS + 3);
+    for(int i=0; i<FIELD_CNT; i++) {
+        // Fields do not overlap, each one gets its own 64 bit slot.
+        int64_t slot = rand_pos(STREAM_BITS / 128) * 128;
+        pos[i] = slot + rand_in_range(0, 63);
+        len[i] = rand_in_range(1, WORD_BIT_LEN);
+        val[i] = rand_word() & (len[i] < WORD_BIT_LEN ?
+            ((WORD_T)1 << len[i]) - 1 : ~(WORD_T)0);
+        for(int j=0; j<i; j++)
+            if(slot / 128 == pos[j] / 128)
+                pos[i] = -1;
+        if(pos[i] < 0) {
+            i--;
+            continue;
+        }
+        dbg_printf("pos(%ld), len(%d)\n", pos[i], len[i]);
+        assert_int_equal(bitstream_set_bits(&bs, pos[i], len[i], val[i],
+            true, true), pos[i] + len[i]);
+    }
+
+    // Last bits of the stream.
+    assert_int_equal(bitstream_set_bits(&bs, STREAM_BITS - 5, 8, 0xa5,
+        true, true), STREAM_BITS + 3);
+    assert_int_equal(bitstream_set_bits(&bs, STREAM_BITS - 5, 9, 0x1a5,
+        true, true), -3);
+    assert_int_equal(bitstream_advise(&bs, pos[0], 64, BITSTREAM_WILLNEED), 0);
+    assert_int_equal(bitstream_sync(&bs), 0);
+    bitstream_close(&bs);
+
+    struct stat st;
+    assert_int_equal(stat(path, &st), 0);
+    assert_int_equal(st.st_size, (STREAM_BITS + 3 + 7) / 8);
+
+    // Reopened read-only, stream has all bits of the file.
+    assert_int_equal(bitstream_open(&bs, path, false), 0);
+    assert_int_equal(bs.bit_len, STREAM_BITS + 8);
+    for(int i=0; i<FIELD_CNT; i++) {
+        WORD_T v;
+        assert_int_equal(bitstream_get_bits(&bs, pos[i], len[i], &v, true),
+            pos[i] + len[i]);
+        assert_int_equal(v, val[i]);
+    }
+    WORD_T v;
+    assert_int_equal(bitstream_get_bits(&bs, STREAM_BITS - 5, 13, &v, true),
+        STREAM_BITS + 8);
+    assert_int_equal(v, 0xa5 << 5);
+    assert_int_equal(bitstream_set_bits(&bs, 0, 8, 0xff, true, true), -4);
+    assert_int_equal(bitstream_get_bits(&bs, STREAM_BITS + 8, 1, &v, true), -1);
+    bitstream_close(&bs);
+
+    // Long fields across the 2^32 bit boundary.
+    assert_int_equal(bitstream_open(&bs, path, true), 0);
+    uint8_t value[100];
+    uint8_t value2[100];
+    for(int i=0; i<100; i++)
+        value[i] = rand_in_range(0, 255);
+    int64_t start = (1LL << 32) - 333;
+    assert_int_equal(bitstream_set_bits3(&bs, start, 797, value, 100, true),
+        start + 797);
+    assert_int_equal(bitstream_get_bits3(&bs, start, 797, value2, 100),
+        start + 797);
+    value[99] &= 0xf8;
+    assert_memory_equal(value, value2, 100);
+    assert_int_equal(bitstream_set_bits3(&bs, STREAM_BITS, 797, value, 100,
+        true), -30);
+    bitstream_close(&bs);
+
+    unlink(path);
+    assert_int_equal(bitstream_open(&bs, path, false), -6);
+}
+
+void test_bitstream_memory(void **state) {
+    bitstream_t bs;
+
+    // Anonymous stream grows and shrinks, added bits read as 0.
+    assert_int_equal(bitstream_create(&bs, NULL, 100), 0);
+    assert_int_equal(bitstream_set_bits(&bs, 60, 40, 0xffffffffff, true, true),
+        100);
+    assert_int_equal(bitstream_resize(&bs, 90), 0);
+    assert_int_equal(bitstream_resize(&bs, 1 << 20), 0);
+    WORD_T v;
+    assert_int_equal(bitstream_get_bits(&bs, 60, 40, &v, true), 100);
+    assert_int_equal(v, 0xfffffffc00);
+    assert_int_equal(bitstream_set_bits(&bs, (1 << 20) - 64, 64, 0x1234,
+        true, true), 1 << 20);
+    assert_int_equal(bitstream_resize(&bs, 64), 0);
+    assert_int_equal(bitstream_resize(&bs, 1 << 20), 0);
+    assert_int_equal(bitstream_get_bits(&bs, (1 << 20) - 64, 64, &v, true),
+        1 << 20);
+    assert_int_equal(v, 0);
+    bitstream_close(&bs);
+}
+
+void test_message_bits_l(void **state) {
+    #define MESSAGE_SIZE_L 4
+    WORD_T message[MESSAGE_SIZE_L] = {0};
+    WORD_T message2[MESSAGE_SIZE_L] = {0};
+
+    // 64 bit variants behave like the int variants.
+    for(int n=0; n<1000; n++) {
+        int start_bit = rand_in_range(0, MESSAGE_SIZE_L * WORD_BIT_LEN - 1);
+        int bit_len = rand_in_range(0, WORD_BIT_LEN + 1);
+        WORD_T value = rand_word();
+        int rtc = set_message_bits(message, MESSAGE_SIZE_L, start_bit, bit_len,
+            value, true, true);
+        assert_int_equal(set_message_bits_l(message2, MESSAGE_SIZE_L,
+            start_bit, bit_len, value, true, true), rtc);
+        assert_memory_equal(message, message2, sizeof(message));
+
+        WORD_T v1 = 0, v2 = 0;
+        rtc = get_message_bits(message, MESSAGE_SIZE_L, start_bit, bit_len,
+            &v1, false);
+        assert_int_equal(get_message_bits_l(message, MESSAGE_SIZE_L,
+            start_bit, bit_len, &v2, false), rtc);
+        assert_int_equal(v1, v2);
+    }
+}
@@ -11,7 +11,7 @@
 #include "bitter.h"
 
 
-// Override MESSAGE_DEBUG from bitter.h here if needed.
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
 //#define MESSAGE_DEBUG
 #ifdef MESSAGE_DEBUG
     #define dbg_printf(...)  printf(__VA_ARGS__)
@@ -705,4 +705,167 @@ void test_example_2(void **state) {
     assert_int_equal(f1_value_2[2], 0);
 
     free(message2);
-}
\ No newline at end of file
+}
+
+void test_binary_messages3_tail(void **state) {
+    WORD_T message[MESSAGE_SIZE] = {0};
+    uint8_t value[24];
+    uint8_t value2[24];
+
+    // Only the bytes covering bit_len are read from and written to the
+    // value byte array, all following bytes stay untouched.
+    for(int bit_len=1; bit_len<=130; bit_len+=3) {
+        int bit_len_bytes = (bit_len + 7) / 8;
+        memset(value, 0xee, sizeof(value));
+        fill_rand(value, bit_len_bytes, bit_len);
+        memset(value2, 0xee, sizeof(value2));
+
+        int rtc = set_message_bits3(message, MESSAGE_SIZE, 71, bit_len,
+            value, bit_len_bytes, true);
+        assert_int_equal(rtc, 71 + bit_len);
+        rtc = get_message_bits3(message, MESSAGE_SIZE, 71, bit_len,
+            value2, bit_len_bytes);
+        assert_int_equal(rtc, 71 + bit_len);
+        assert_memory_equal(value, value2, sizeof(value));
+    }
+
+    // Errors of the per word functions are passed on multiplied by 100.
+    assert_int_equal(set_message_bits3(message, MESSAGE_SIZE, 0, 16,
+        value, 1, true), -1);
+    assert_int_equal(set_message_bits3(message, MESSAGE_SIZE,
+        MESSAGE_SIZE * WORD_BIT_LEN, 8, value, 1, true), -10);
+    assert_int_equal(set_message_bits3(message, MESSAGE_SIZE,
+        MESSAGE_SIZE * WORD_BIT_LEN - 4, 8, value, 1, true), -300);
+    assert_int_equal(get_message_bits3(message, MESSAGE_SIZE, 0, 8,
+        NULL, 1), -2);
+    assert_int_equal(get_message_bits3(message, MESSAGE_SIZE,
+        MESSAGE_SIZE * WORD_BIT_LEN - 4, 8, value2, 1), -300);
+}
+
+void test_binary_messages2_R(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T message2[MESSAGE_SIZE];
+    WORD_T value[MESSAGE_SIZE];
+    WORD_T value2[MESSAGE_SIZE];
+
+    // Random multi word fields at random positions compared against a
+    // reference which inserts and extracts the field bit by bit.
+    for(int n=0; n<500; n++) {
+        int start_bit = rand_in_range(0, MESSAGE_SIZE * WORD_BIT_LEN - 1);
+        int bit_len = rand_in_range(1, MESSAGE_SIZE * WORD_BIT_LEN - start_bit);
+        int value_len = (bit_len + WORD_BIT_LEN - 1) / WORD_BIT_LEN;
+        bool erase = rand_in_range(0, 1);
+        dbg_printf("start_bit(%4d), bit_len(%4d), erase(%d)\n",
+            start_bit, bit_len, erase);
+
+        fill_rand((uint8_t*)message, sizeof(message), sizeof(message) * 8);
+        memcpy(message2, message, sizeof(message));
+        fill_rand((uint8_t*)value, sizeof(value), sizeof(value) * 8);
+
+        int rtc = set_message_bits2(message, MESSAGE_SIZE, start_bit, bit_len,
+            value, value_len, erase);
+        assert_int_equal(rtc, start_bit + bit_len);
+        for(int i=0; i<bit_len; i++) {
+            WORD_T bit = value[i / WORD_BIT_LEN] << (i % WORD_BIT_LEN);
+            set_message_bits(message2, MESSAGE_SIZE, start_bit + i, 1,
+                bit, erase, false);
+        }
+        assert_memory_equal(message, message2, sizeof(message));
+
+        memset(value2, 0xff, sizeof(value2));
+        rtc = get_message_bits2(message, MESSAGE_SIZE, start_bit, bit_len,
+            value2, value_len);
+        assert_int_equal(rtc, start_bit + bit_len);
+        for(int i=0; i<value_len * WORD_BIT_LEN; i++) {
+            WORD_T bit = 0;
+            if(i < bit_len)
+                get_message_bits(message, MESSAGE_SIZE, start_bit + i, 1,
+                    &bit, true);
+            assert_int_equal((value2[i / WORD_BIT_LEN] >>
+                (WORD_BIT_LEN - 1 - i % WORD_BIT_LEN)) & 1, bit);
+        }
+    }
+
+    // A field reaching over the end of the message is rejected without
+    // touching the message.
+    memcpy(message2, message, sizeof(message));
+    assert_int_equal(set_message_bits2(message, MESSAGE_SIZE, 1000, 600,
+        value, MESSAGE_SIZE, true), -30);
+    assert_int_equal(get_message_bits2(message, MESSAGE_SIZE, 1024, 513,
+        value2, MESSAGE_SIZE), -10);
+    assert_memory_equal(message, message2, sizeof(message));
+
+    // Not more than value_len words are inserted.
+    assert_int_equal(set_message_bits2(message, MESSAGE_SIZE, 1000, 600,
+        value, 1, true), 1600);
+}
+
+void test_binary_messages_isa(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T message2[MESSAGE_SIZE];
+    WORD_T ref[MESSAGE_SIZE];
+    WORD_T value[MESSAGE_SIZE];
+    WORD_T value2[MESSAGE_SIZE];
+    WORD_T ref_value[MESSAGE_SIZE];
+
+    // All kernels supported by the CPU must produce the same results as
+    // the portable scalar kernels.
+    char isa[16];
+    strncpy(isa, bitter_isa(), sizeof(isa) - 1);
+    isa[sizeof(isa) - 1] = '\0';
+
+    int isa_cnt = 0;
+    const char* const* isa_list = bitter_isa_list(&isa_cnt);
+    assert_true(isa_cnt >= 1);
+    assert_string_equal(isa_list[0], "scalar");
+    assert_int_equal(bitter_set_isa("bogus"), -1);
+    assert_string_equal(bitter_isa(), isa);
+
+    for(int n=0; n<200; n++) {
+        int start_bit = rand_in_range(0, MESSAGE_SIZE * WORD_BIT_LEN - 1);
+        int bit_len = rand_in_range(1, WORD_BIT_LEN);
+        if(start_bit + bit_len > MESSAGE_SIZE * WORD_BIT_LEN)
+            bit_len = MESSAGE_SIZE * WORD_BIT_LEN - start_bit;
+        int bit_len2 = rand_in_range(1, MESSAGE_SIZE * WORD_BIT_LEN - start_bit);
+        bool erase = rand_in_range(0, 1);
+        bool start_low = rand_in_range(0, 1);
+        fill_rand((uint8_t*)value, sizeof(value), sizeof(value) * 8);
+        fill_rand((uint8_t*)message, sizeof(message), sizeof(message) * 8);
+        memcpy(ref, message, sizeof(message));
+
+        WORD_T ref_single = 0;
+        assert_int_equal(bitter_set_isa("scalar"), 0);
+        set_message_bits(ref, MESSAGE_SIZE, start_bit, bit_len, value[0],
+            erase, start_low);
+        get_message_bits(ref, MESSAGE_SIZE, start_bit, bit_len, &ref_single,
+            start_low);
+        set_message_bits2(ref, MESSAGE_SIZE, start_bit, bit_len2, value,
+            MESSAGE_SIZE, erase);
+        get_message_bits2(ref, MESSAGE_SIZE, start_bit, bit_len2, ref_value,
+            MESSAGE_SIZE);
+
+        for(int i=1; i<isa_cnt; i++) {
+            dbg_printf("isa(%s), start_bit(%4d), bit_len(%2d/%4d)\n",
+                isa_list[i], start_bit, bit_len, bit_len2);
+            assert_int_equal(bitter_set_isa(isa_list[i]), 0);
+            assert_string_equal(bitter_isa(), isa_list[i]);
+
+            WORD_T single = 0;
+            memcpy(message2, message, sizeof(message));
+            set_message_bits(message2, MESSAGE_SIZE, start_bit, bit_len,
+                value[0], erase, start_low);
+            get_message_bits(message2, MESSAGE_SIZE, start_bit, bit_len,
+                &single, start_low);
+            assert_int_equal(single, ref_single);
+            set_message_bits2(message2, MESSAGE_SIZE, start_bit, bit_len2,
+                value, MESSAGE_SIZE, erase);
+            get_message_bits2(message2, MESSAGE_SIZE, start_bit, bit_len2,
+                value2, MESSAGE_SIZE);
+            assert_memory_equal(message2, ref, sizeof(ref));
+            assert_memory_equal(value2, ref_value,
+                (bit_len2 + WORD_BIT_LEN - 1) / WORD_BIT_LEN * sizeof(WORD_T));
+        }
+    }
+
+    assert_int_equal(bitter_set_isa(isa), 0);
+}
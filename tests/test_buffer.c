@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 24 // 24 * 64 bits = 1536 bits
+
+
+static void fill_bytes(uint8_t* buffer, size_t len) {
+    for(size_t i=0; i<len; i++)
+        buffer[i] = rand_in_range(0, 255);
+}
+
+// Buffer whose last byte is followed by an inaccessible page, so any read
+// or write past its end crashes the test.
+static uint8_t* guarded_buffer(size_t len, void** map, size_t* map_len) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    *map_len = ((len + page - 1) / page + 1) * page;
+    *map = mmap(NULL, *map_len, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert_true(*map != MAP_FAILED);
+    uint8_t* guard = (uint8_t*)*map + *map_len - page;
+    assert_int_equal(mprotect(guard, page, PROT_NONE), 0);
+    return guard - len;
+}
+
+void test_buffer_bits(void **state) {
+    void* map;
+    size_t map_len;
+
+    // Odd buffer lengths at odd addresses, fields close to the buffer end.
+    for(int n=0; n<2000; n++) {
+        size_t len = rand_in_range(1, 40);
+        uint8_t* buffer = guarded_buffer(len, &map, &map_len);
+        uint8_t ref[64];
+        fill_bytes(buffer, len);
+        memcpy(ref, buffer, len);
+
+        int start_bit = rand_in_range(0, len * 8 - 1);
+        int max_len = len * 8 - start_bit;
+        int bit_len = rand_in_range(1, max_len < WORD_BIT_LEN ?
+                                       max_len : WORD_BIT_LEN);
+        bool erase = rand_in_range(0, 1);
+        bool start_low = rand_in_range(0, 1);
+        WORD_T value = ((WORD_T)rand() << 33) ^ ((WORD_T)rand() << 11) ^ rand();
+        dbg_printf("len(%2zu), start_bit(%3d), bit_len(%2d)\n",
+            len, start_bit, bit_len);
+
+        // Get compared to bit by bit reference.
+        WORD_T v = ~(WORD_T)0;
+        assert_int_equal(get_buffer_bits(buffer, len, start_bit, bit_len,
+            &v, true), start_bit + bit_len);
+        WORD_T expected = 0;
+        for(int i=0; i<bit_len; i++)
+            expected = (expected << 1) | ref_bit(ref, start_bit + i);
+        assert_int_equal(v, expected);
+        assert_int_equal(get_buffer_bits(buffer, len, start_bit, bit_len,
+            &v, false), start_bit + bit_len);
+        assert_int_equal(v, expected << (WORD_BIT_LEN - bit_len));
+
+        // Set compared to bit by bit reference.
+        assert_int_equal(set_buffer_bits(buffer, len, start_bit, bit_len,
+            value, erase, start_low), start_bit + bit_len);
+        for(int i=0; i<bit_len; i++) {
+            int b = start_low ? (value >> (bit_len - 1 - i)) & 1
+                              : (value >> (WORD_BIT_LEN - 1 - i)) & 1;
+            int pos = start_bit + i;
+            if(erase)
+                ref[pos / 8] &= ~(0x80 >> (pos % 8));
+            if(b)
+                ref[pos / 8] |= 0x80 >> (pos % 8);
+        }
+        assert_memory_equal(buffer, ref, len);
+
+        munmap(map, map_len);
+    }
+
+    uint8_t buffer[3] = {0};
+    WORD_T v;
+    assert_int_equal(get_buffer_bits(buffer, 3, 24, 1, &v, true), -1);
+    assert_int_equal(get_buffer_bits(buffer, 3, -1, 1, &v, true), -1);
+    assert_int_equal(get_buffer_bits(buffer, 3, 0, 65, &v, true), -2);
+    assert_int_equal(get_buffer_bits(buffer, 3, 20, 5, &v, true), -3);
+    assert_int_equal(set_buffer_bits(buffer, 3, 20, 5, 0x1f, true, true), -3);
+    assert_int_equal(set_buffer_bits(buffer, 3, 20, 4, 0x1f, true, true), 24);
+    assert_int_equal(buffer[2], 0x0f);
+}
+
+void test_buffer_bits3(void **state) {
+    void* map;
+    size_t map_len;
+    uint8_t value[256];
+    uint8_t value2[256];
+
+    for(int n=0; n<2000; n++) {
+        size_t len = rand_in_range(1, 200);
+        uint8_t* buffer = guarded_buffer(len, &map, &map_len);
+        uint8_t ref[256];
+        fill_bytes(buffer, len);
+        memcpy(ref, buffer, len);
+
+        int start_bit = rand_in_range(0, len * 8 - 1);
+        int bit_len = rand_in_range(1, len * 8 - start_bit);
+        int value_len = (bit_len + 7) / 8;
+        bool erase = rand_in_range(0, 1);
+        dbg_printf("len(%3zu), start_bit(%4d), bit_len(%4d)\n",
+            len, start_bit, bit_len);
+
+        // Value buffer also ends at a guard page.
+        void* vmap;
+        size_t vmap_len;
+        uint8_t* v = guarded_buffer(value_len, &vmap, &vmap_len);
+        memset(v, 0xff, value_len);
+        assert_int_equal(get_buffer_bits3(buffer, len, start_bit, bit_len,
+            v, value_len), start_bit + bit_len);
+        memset(value2, 0, sizeof(value2));
+        for(int i=0; i<bit_len; i++)
+            if(ref_bit(ref, start_bit + i))
+                value2[i / 8] |= 0x80 >> (i % 8);
+        assert_memory_equal(v, value2, value_len);
+
+        fill_bytes(v, value_len);
+        memcpy(value, v, value_len);
+        assert_int_equal(set_buffer_bits3(buffer, len, start_bit, bit_len,
+            v, value_len, erase), start_bit + bit_len);
+        for(int i=0; i<bit_len; i++) {
+            int pos = start_bit + i;
+            if(erase)
+                ref[pos / 8] &= ~(0x80 >> (pos % 8));
+            if(ref_bit(value, i))
+                ref[pos / 8] |= 0x80 >> (pos % 8);
+        }
+        assert_memory_equal(buffer, ref, len);
+
+        munmap(vmap, vmap_len);
+        munmap(map, map_len);
+    }
+
+    uint8_t buffer[3] = {0};
+    assert_int_equal(get_buffer_bits3(buffer, 3, 0, 9, value, 1), -1);
+    assert_int_equal(get_buffer_bits3(buffer, 3, 0, 8, NULL, 1), -2);
+    assert_int_equal(get_buffer_bits3(buffer, 3, 24, 1, value, 1), -10);
+    assert_int_equal(set_buffer_bits3(buffer, 3, 20, 5, value, 1, true), -30);
+}
+
+void test_buffer_message(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    uint8_t buffer[MESSAGE_SIZE * WORD_BYTE_LEN + 1];
+
+    // A message in network-byte-order is a byte buffer too, buffer and
+    // message functions must agree also at an unaligned buffer address.
+    for(int n=0; n<1000; n++) {
+        uint8_t* unaligned = buffer + 1;
+        for(int i=0; i<MESSAGE_SIZE; i++)
+            message[i] = ((WORD_T)rand() << 33) ^ ((WORD_T)rand() << 11) ^ rand();
+        memcpy(unaligned, message, sizeof(message));
+
+        int start_bit = rand_in_range(0, MESSAGE_SIZE * WORD_BIT_LEN - 1);
+        int bit_len = rand_in_range(1, WORD_BIT_LEN);
+        if(start_bit + bit_len > MESSAGE_SIZE * WORD_BIT_LEN)
+            bit_len = MESSAGE_SIZE * WORD_BIT_LEN - start_bit;
+        WORD_T value = ((WORD_T)rand() << 33) ^ rand();
+        bool erase = rand_in_range(0, 1);
+
+        WORD_T v1, v2;
+        get_message_bits(message, MESSAGE_SIZE, start_bit, bit_len, &v1, true);
+        get_buffer_bits(unaligned, sizeof(message), start_bit, bit_len, &v2,
+            true);
+        assert_int_equal(v1, v2);
+
+        set_message_bits(message, MESSAGE_SIZE, start_bit, bit_len, value,
+            erase, true);
+        set_buffer_bits(unaligned, sizeof(message), start_bit, bit_len, value,
+            erase, true);
+        assert_memory_equal(unaligned, message, sizeof(message));
+    }
+}
@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <pcap.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE   2
+#define HEADER_LEN     42   // Ethernet, IPv4 and UDP headers.
+#define PACKET_CNT     100
+#define BATCH_SIZE     16
+#define FIELD_CNT      4
+
+
+typedef struct {
+    WORD_T values[PACKET_CNT][FIELD_CNT];
+    int packets;
+    int batches;
+    int stop_after;
+} capture_check_t;
+
+static const field_desc_t capture_fields[FIELD_CNT] = {
+    { 0,  4, true, true, 0},
+    { 4, 12, true, true, 0},
+    {16, 33, true, true, 0},
+    {49, 64, true, true, 0},
+};
+
+static int check_batch(void* arg, WORD_T* const columns[],
+                       const uint64_t timestamps[], int packet_cnt) {
+    capture_check_t* check = (capture_check_t*)arg;
+    dbg_printf("batch(%d), packets(%d)\n", check->batches, packet_cnt);
+    assert_true(packet_cnt <= BATCH_SIZE);
+    for(int k=0; k<packet_cnt; k++) {
+        // Every 10th packet is too short and skipped.
+        int n = check->packets + check->packets / 9;
+        for(int i=0; i<FIELD_CNT; i++)
+            assert_int_equal(columns[i][k], check->values[n][i]);
+        assert_int_equal(timestamps[k], 1000000ull * n + 7);
+        check->packets++;
+    }
+    check->batches++;
+    return (check->batches == check->stop_after);
+}
+
+void test_capture(void **state) {
+    static capture_check_t check;
+    char path[] = "/tmp/bitter_test_XXXXXX";
+    int fd = mkstemp(path);
+    assert_true(fd >= 0);
+    close(fd);
+
+    message_layout_t layout;
+    assert_int_equal(message_layout_init(&layout, capture_fields, FIELD_CNT,
+        MESSAGE_SIZE), 113);
+
+    // Write packets with random field values behind a fake header.
+    pcap_t* dead = pcap_open_dead(DLT_EN10MB, 65535);
+    pcap_dumper_t* dumper = pcap_dump_open(dead, path);
+    assert_non_null(dumper);
+    for(int n=0; n<PACKET_CNT; n++) {
+        uint8_t packet[HEADER_LEN + MESSAGE_SIZE * WORD_BYTE_LEN];
+        WORD_T message[MESSAGE_SIZE] = {0};
+        for(int i=0; i<FIELD_CNT; i++) {
+            WORD_T v = ((WORD_T)rand() << 33) ^ ((WORD_T)rand() << 11) ^ rand();
+            int bit_len = capture_fields[i].bit_len;
+            check.values[n][i] = (bit_len < WORD_BIT_LEN ?
+                v & (((WORD_T)1 << bit_len) - 1) : v);
+            set_message_bits(message, MESSAGE_SIZE,
+                capture_fields[i].start_bit, bit_len, v, true, true);
+        }
+        memset(packet, 0xee, HEADER_LEN);
+        memcpy(packet + HEADER_LEN, message, sizeof(message));
+
+        struct pcap_pkthdr hdr;
+        hdr.ts.tv_sec = n;
+        hdr.ts.tv_usec = 7;
+        // Payload covers only the 113 bits (15 bytes) used by the layout,
+        // every 10th packet is one byte too short.
+        hdr.caplen = HEADER_LEN + 15 - (n % 10 == 9 ? 1 : 0);
+        hdr.len = hdr.caplen;
+        pcap_dump((u_char*)dumper, &hdr, packet);
+    }
+    pcap_dump_close(dumper);
+    pcap_close(dead);
+
+    capture_stats_t stats;
+    check.stop_after = 0;
+    assert_int_equal(decode_capture(path, &layout, HEADER_LEN, BATCH_SIZE,
+        check_batch, &check, &stats), 0);
+    assert_int_equal(stats.packets, PACKET_CNT);
+    assert_int_equal(stats.skipped, PACKET_CNT / 10);
+    assert_int_equal(stats.decoded, check.packets);
+    assert_int_equal(check.packets, PACKET_CNT - PACKET_CNT / 10);
+    assert_int_equal(check.batches, (check.packets + BATCH_SIZE - 1) /
+        BATCH_SIZE);
+    assert_int_equal(stats.bytes, PACKET_CNT * (HEADER_LEN + 15) -
+        PACKET_CNT / 10);
+    assert_true(stats.packets_per_sec > 0);
+
+    // Callback can stop decoding.
+    check.packets = 0;
+    check.batches = 0;
+    check.stop_after = 2;
+    assert_int_equal(decode_capture(path, &layout, HEADER_LEN, BATCH_SIZE,
+        check_batch, &check, NULL), 1);
+    assert_int_equal(check.packets, 2 * BATCH_SIZE);
+
+    assert_int_equal(decode_capture("/nonexistent.pcap", &layout, HEADER_LEN,
+        BATCH_SIZE, check_batch, &check, NULL), -6);
+    assert_int_equal(decode_capture(path, &layout, HEADER_LEN, 0,
+        check_batch, &check, NULL), -1);
+
+    message_layout_free(&layout);
+    unlink(path);
+}
@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <arpa/inet.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 16
+#define MESSAGE_BITS (MESSAGE_SIZE * WORD_BIT_LEN)
+#define ROUNDS       1000
+
+
+// Copies bit by bit from a snapshot of src, so overlap does not matter.
+static void copy_reference(WORD_T dst[], int dst_bit, const WORD_T src[],
+                           int src_bit, int bit_len) {
+    WORD_T snapshot[MESSAGE_SIZE];
+    memcpy(snapshot, src, sizeof(snapshot));
+    for(int i=0; i<bit_len; i++) {
+        WORD_T v;
+        get_message_bits(snapshot, MESSAGE_SIZE, src_bit + i, 1, &v, true);
+        set_message_bits(dst, MESSAGE_SIZE, dst_bit + i, 1, v, true, true);
+    }
+}
+
+
+void test_copy_message_bits(void **state) {
+    WORD_T src[MESSAGE_SIZE];
+    WORD_T dst[MESSAGE_SIZE];
+    WORD_T expected[MESSAGE_SIZE];
+    unsigned int seed = rand();
+
+    // With all kernels supported by the CPU.
+    char isa[16];
+    strncpy(isa, bitter_isa(), sizeof(isa) - 1);
+    isa[sizeof(isa) - 1] = '\0';
+    int isa_cnt = 0;
+    const char* const* isa_list = bitter_isa_list(&isa_cnt);
+
+    for(int round=0; round<ROUNDS*isa_cnt; round++) {
+        assert_int_equal(bitter_set_isa(isa_list[round % isa_cnt]), 0);
+        int bit_len = rand_in_range_r(&seed, 0, MESSAGE_BITS);
+        int dst_bit = rand_in_range_r(&seed, 0, MESSAGE_BITS - bit_len);
+        int src_bit = rand_in_range_r(&seed, 0, MESSAGE_BITS - bit_len);
+        if(dst_bit == MESSAGE_BITS || src_bit == MESSAGE_BITS)
+            continue;
+
+        // Between two messages.
+        fill_random(src, MESSAGE_SIZE, &seed);
+        fill_random(dst, MESSAGE_SIZE, &seed);
+        memcpy(expected, dst, sizeof(dst));
+        copy_reference(expected, dst_bit, src, src_bit, bit_len);
+        assert_int_equal(copy_message_bits(dst, MESSAGE_SIZE, dst_bit, src,
+            MESSAGE_SIZE, src_bit, bit_len), dst_bit + bit_len);
+        assert_memory_equal(dst, expected, sizeof(dst));
+
+        // Overlapping inside one message, forwards and backwards.
+        memcpy(expected, dst, sizeof(dst));
+        copy_reference(expected, dst_bit, expected, src_bit, bit_len);
+        assert_int_equal(copy_message_bits(dst, MESSAGE_SIZE, dst_bit, dst,
+            MESSAGE_SIZE, src_bit, bit_len), dst_bit + bit_len);
+        if(memcmp(dst, expected, sizeof(dst)) != 0)
+            dbg_printf("isa(%s), dst_bit(%d), src_bit(%d), bit_len(%d)\n",
+                bitter_isa(), dst_bit, src_bit, bit_len);
+        assert_memory_equal(dst, expected, sizeof(dst));
+    }
+    assert_int_equal(bitter_set_isa(isa), 0);
+
+    // Shift a message by a few bits, e.g. to re-frame it.
+    fill_random(src, MESSAGE_SIZE, &seed);
+    memcpy(dst, src, sizeof(src));
+    memcpy(expected, src, sizeof(src));
+    copy_reference(expected, 3, expected, 0, MESSAGE_BITS - 3);
+    assert_int_equal(copy_message_bits(dst, MESSAGE_SIZE, 3, dst,
+        MESSAGE_SIZE, 0, MESSAGE_BITS - 3), MESSAGE_BITS);
+    assert_memory_equal(dst, expected, sizeof(dst));
+
+    // Different message sizes.
+    assert_int_equal(copy_message_bits(dst, MESSAGE_SIZE, 100, src, 2, 1,
+        127), 227);
+    assert_int_equal(copy_message_bits(dst, 2, 1, src, MESSAGE_SIZE, 100,
+        127), 128);
+
+    assert_int_equal(copy_message_bits(dst, 2, -1, src, 2, 0, 8), -1);
+    assert_int_equal(copy_message_bits(dst, 2, 128, src, 2, 0, 0), -1);
+    assert_int_equal(copy_message_bits(dst, 2, 0, src, 2, 0, -1), -2);
+    assert_int_equal(copy_message_bits(dst, 2, 1, src, 2, 0, 128), -3);
+    assert_int_equal(copy_message_bits(dst, 2, 0, src, 2, 128, 0), -10);
+    assert_int_equal(copy_message_bits(dst, 2, 0, src, 2, 1, 128), -30);
+}
+
+void test_fill_message_bits(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T expected[MESSAGE_SIZE];
+    unsigned int seed = rand();
+
+    for(int round=0; round<ROUNDS; round++) {
+        int bit_len = rand_in_range_r(&seed, 0, MESSAGE_BITS - 1);
+        int start_bit = rand_in_range_r(&seed, 0, MESSAGE_BITS - 1 - bit_len);
+        int pattern_len = rand_in_range_r(&seed, 1, WORD_BIT_LEN);
+        WORD_T pattern = ((WORD_T)rand_r(&seed) << 40) ^
+                         ((WORD_T)rand_r(&seed) << 20) ^ rand_r(&seed);
+
+        fill_random(message, MESSAGE_SIZE, &seed);
+        memcpy(expected, message, sizeof(message));
+        for(int i=0; i<bit_len; i++) {
+            int k = pattern_len - 1 - i % pattern_len;
+            set_message_bits(expected, MESSAGE_SIZE, start_bit + i, 1,
+                (pattern >> k) & 1, true, true);
+        }
+        assert_int_equal(fill_message_bits(message, MESSAGE_SIZE, start_bit,
+            bit_len, pattern, pattern_len), start_bit + bit_len);
+        assert_memory_equal(message, expected, sizeof(message));
+
+        for(int i=0; i<bit_len; i++)
+            set_message_bits(expected, MESSAGE_SIZE, start_bit + i, 1, 0,
+                true, true);
+        assert_int_equal(clear_message_bits(message, MESSAGE_SIZE, start_bit,
+            bit_len), start_bit + bit_len);
+        assert_memory_equal(message, expected, sizeof(message));
+    }
+
+    // HDLC idle flags and all ones.
+    memset(message, 0, sizeof(message));
+    assert_int_equal(fill_message_bits(message, MESSAGE_SIZE, 8, 64, 0x7E,
+        8), 72);
+    assert_int_equal(message[0], htonll(0x007E7E7E7E7E7E7EULL));
+    assert_int_equal(message[1], htonll(0x7E00000000000000ULL));
+    assert_int_equal(fill_message_bits(message, MESSAGE_SIZE, 0, 4, 1, 1), 4);
+    assert_int_equal(message[0], htonll(0xF07E7E7E7E7E7E7EULL));
+
+    assert_int_equal(fill_message_bits(message, 2, -1, 8, 1, 1), -1);
+    assert_int_equal(fill_message_bits(message, 2, 0, -1, 1, 1), -2);
+    assert_int_equal(fill_message_bits(message, 2, 0, 8, 1, 0), -2);
+    assert_int_equal(fill_message_bits(message, 2, 0, 8, 1, 65), -2);
+    assert_int_equal(fill_message_bits(message, 2, 1, 128, 1, 1), -3);
+    assert_int_equal(clear_message_bits(message, 2, 1, 128), -3);
+}
+
+// Bit i of message in a bit array.
+static void unpack_bits(const WORD_T message[], int len, char bits[]) {
+    for(int i=0; i<len*WORD_BIT_LEN; i++) {
+        WORD_T v;
+        get_message_bits((WORD_T*)message, len, i, 1, &v, true);
+        bits[i] = (char)v;
+    }
+}
+
+void test_insert_delete_bits(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    char bits[MESSAGE_BITS];
+    char expected[MESSAGE_BITS];
+    unsigned int seed = rand();
+
+    for(int round=0; round<ROUNDS; round++) {
+        int start_bit = rand_in_range_r(&seed, 0, MESSAGE_BITS - 1);
+        int bit_len = rand_in_range_r(&seed, 0, MESSAGE_BITS - start_bit);
+        fill_random(message, MESSAGE_SIZE, &seed);
+        unpack_bits(message, MESSAGE_SIZE, bits);
+
+        // Tail shifted right, inserted bits are 0.
+        memcpy(expected, bits, start_bit);
+        memset(expected + start_bit, 0, bit_len);
+        memcpy(expected + start_bit + bit_len, bits + start_bit,
+            MESSAGE_BITS - start_bit - bit_len);
+        assert_int_equal(insert_message_bits(message, MESSAGE_SIZE,
+            start_bit, bit_len), start_bit + bit_len);
+        unpack_bits(message, MESSAGE_SIZE, bits);
+        assert_memory_equal(bits, expected, MESSAGE_BITS);
+
+        // Deleting them again restores the message up to the lost bits.
+        memcpy(expected + start_bit, bits + start_bit + bit_len,
+            MESSAGE_BITS - start_bit - bit_len);
+        memset(expected + MESSAGE_BITS - bit_len, 0, bit_len);
+        assert_int_equal(delete_message_bits(message, MESSAGE_SIZE,
+            start_bit, bit_len), start_bit);
+        unpack_bits(message, MESSAGE_SIZE, bits);
+        assert_memory_equal(bits, expected, MESSAGE_BITS);
+    }
+
+    // Grow a 12 bit length field in the middle of a frame to 16 bits.
+    memset(message, 0, sizeof(message));
+    set_message_bits(message, 2, 0, 8, 0x7E, true, true);
+    set_message_bits(message, 2, 8, 12, 0xABC, true, true);
+    set_message_bits(message, 2, 20, 8, 0x7E, true, true);
+    assert_int_equal(insert_message_bits(message, 2, 8, 4), 12);
+    assert_int_equal(message[0], htonll(0x7E0ABC7E00000000ULL));
+    assert_int_equal(delete_message_bits(message, 2, 8, 4), 8);
+    assert_int_equal(message[0], htonll(0x7EABC7E000000000ULL));
+
+    assert_int_equal(insert_message_bits(message, 2, -1, 8), -1);
+    assert_int_equal(insert_message_bits(message, 2, 128, 0), -1);
+    assert_int_equal(insert_message_bits(message, 2, 0, -1), -2);
+    assert_int_equal(insert_message_bits(message, 2, 1, 128), -3);
+    assert_int_equal(delete_message_bits(message, 2, 1, 128), -3);
+}
+
+void test_insert_delete_bitstream(void **state) {
+    bitstream_t bs;
+    WORD_T v;
+    const int64_t bit_len = 100003;
+
+    assert_int_equal(bitstream_create(&bs, NULL, bit_len), 0);
+    for(int64_t i=0; i+32<=bit_len; i+=32)
+        bitstream_set_bits(&bs, i, 32, i, true, true);
+
+    // The stream grows and its tail moves.
+    assert_int_equal(bitstream_insert_bits(&bs, 35, 70000), 70035);
+    assert_int_equal(bs.bit_len, bit_len + 70000);
+    bitstream_get_bits(&bs, 0, 32, &v, true);
+    assert_int_equal(v, 0);
+    bitstream_get_bits(&bs, 32, 3, &v, true);
+    assert_int_equal(v, 32 >> 29);
+    bitstream_get_bits(&bs, 35, 64, &v, true);
+    assert_int_equal(v, 0);
+    bitstream_get_bits(&bs, 70035, 29, &v, true);
+    assert_int_equal(v, 32 & 0x1FFFFFFF);
+    bitstream_get_bits(&bs, 96000 + 70000, 32, &v, true);
+    assert_int_equal(v, 96000);
+
+    // Append at the end.
+    assert_int_equal(bitstream_insert_bits(&bs, bs.bit_len, 5),
+        bit_len + 70005);
+
+    assert_int_equal(bitstream_delete_bits(&bs, 35, 70000), 35);
+    assert_int_equal(bitstream_delete_bits(&bs, bit_len, 5), bit_len);
+    assert_int_equal(bs.bit_len, bit_len);
+    for(int64_t i=0; i+32<=bit_len; i+=32) {
+        bitstream_get_bits(&bs, i, 32, &v, true);
+        assert_int_equal(v, i);
+    }
+
+    assert_int_equal(bitstream_insert_bits(&bs, bit_len + 1, 1), -1);
+    assert_int_equal(bitstream_insert_bits(&bs, 0, -1), -2);
+    assert_int_equal(bitstream_delete_bits(&bs, 1, bit_len), -3);
+
+    // Inserting or deleting nothing at the end.
+    assert_int_equal(bitstream_insert_bits(&bs, bs.bit_len, 0), bit_len);
+    assert_int_equal(bitstream_delete_bits(&bs, bs.bit_len, 0), bit_len);
+    assert_int_equal(bs.bit_len, bit_len);
+    assert_int_equal(bitstream_delete_bits(&bs, bit_len + 1, 0), -1);
+    assert_int_equal(bitstream_delete_bits(&bs, bit_len, 1), -3);
+    bitstream_close(&bs);
+}
@@ -0,0 +1,76 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cstdarg>
+#include <cstddef>
+#include <csetjmp>
+
+extern "C" {
+#include <cmocka.h>
+}
+
+#include "bitter.hpp"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 4 // 4 * 64 bits = 256 bits
+
+
+// Compares one field accessor with set_message_bits/get_message_bits.
+template<int Offset, int Width>
+static void check_field(void) {
+    using f = bitter::field<Offset, Width>;
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T message2[MESSAGE_SIZE];
+
+    dbg_printf("offset(%d), width(%d)\n", Offset, Width);
+    for(int n=0; n<20; n++) {
+        for(int i=0; i<MESSAGE_SIZE; i++)
+            message[i] = message2[i] = rand_word();
+        WORD_T value = rand_word();
+        bool erase = rand_in_range(0, 1);
+
+        f::set(message, value, erase);
+        set_message_bits(message2, MESSAGE_SIZE, Offset, Width, value,
+            erase, true);
+        assert_memory_equal(message, message2, sizeof(message));
+
+        WORD_T v;
+        get_message_bits(message2, MESSAGE_SIZE, Offset, Width, &v, true);
+        assert_int_equal(f::get(message), v);
+        const WORD_T* p = message;
+        assert_int_equal(f::get(p), v);
+    }
+}
+
+template<int Offset, int... Widths>
+static void check_widths(void) {
+    (check_field<Offset, Widths>(), ...);
+}
+
+template<int... Offsets>
+static void check_offsets(void) {
+    (check_widths<Offsets, 1, 2, 7, 8, 13, 31, 32, 33, 57, 63, 64>(), ...);
+}
+
+
+extern "C" void test_cpp_fields(void **state) {
+    // Fields at and around word boundaries, crossing and not crossing.
+    check_offsets<0, 1, 5, 8, 31, 32, 56, 57, 63, 64, 65, 100, 127, 128,
+                  150, 191>();
+
+    // Fields ending at the last message bit.
+    check_field<255, 1>();
+    check_field<192, 64>();
+    check_field<193, 63>();
+    check_field<200, 56>();
+}
@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 64
+#define ROUNDS       300
+
+
+// Check values of the presets, CRC of "123456789".
+static const struct {
+    int preset;
+    uint64_t check;
+} checks[] = {
+    { CRC_15_CAN, 0x059E },
+    { CRC_16_HDLC, 0x906E },
+    { CRC_16_CCITT_FALSE, 0x29B1 },
+    { CRC_24Q, 0xCDE703 },
+    { CRC_32, 0xCBF43926 },
+    { CRC_32C, 0xE3069283 },
+    { CRC_64_XZ, 0x995DC9BBDF1939FAULL },
+};
+#define CHECK_CNT (int)(sizeof(checks) / sizeof(checks[0]))
+
+
+static uint64_t reflect(uint64_t v, int n) {
+    uint64_t r = 0;
+    for(int i=0; i<n; i++)
+        if((v >> i) & 1)
+            r |= 1ULL << (n - 1 - i);
+    return r;
+}
+
+// Bit by bit reference CRC, bytes counted from start_bit.
+static uint64_t crc_reference(const crc_t* crc, WORD_T message[],
+                              int message_len, int start_bit, int bit_len) {
+    uint64_t mask = (crc->width == 64 ? ~0ULL : (1ULL << crc->width) - 1);
+    uint64_t reg = crc->init;
+    for(int i=0; i<bit_len; i+=8) {
+        int n = (bit_len - i < 8 ? bit_len - i : 8);
+        WORD_T b;
+        get_message_bits(message, message_len, start_bit + i, n, &b, true);
+        if(crc->reflect_in)
+            b = reflect(b, n);
+        for(int k=n-1; k>=0; k--) {
+            uint64_t fb = ((reg >> (crc->width - 1)) ^ (b >> k)) & 1;
+            reg = (reg << 1) & mask;
+            if(fb)
+                reg ^= crc->poly;
+        }
+    }
+    if(crc->reflect_out)
+        reg = reflect(reg, crc->width);
+    return reg ^ crc->xor_out;
+}
+
+
+void test_crc_presets(void **state) {
+    const char* data = "123456789";
+    static crc_t crc;
+    WORD_T message[4];
+
+    for(int i=0; i<CHECK_CNT; i++) {
+        assert_int_equal(crc_init_preset(&crc, checks[i].preset), 0);
+
+        // Byte aligned and at odd bit offsets in the message.
+        for(int offset=0; offset<WORD_BIT_LEN; offset+=13) {
+            memset(message, 0xA5, sizeof(message));
+            for(int k=0; k<9; k++)
+                set_message_bits(message, 4, offset + k * 8, 8, data[k],
+                                 true, true);
+            uint64_t value = 0;
+            assert_int_equal(message_crc(&crc, message, 4, offset, 72,
+                &value), offset + 72);
+            dbg_printf("preset(%d), offset(%d), crc(0x%lx)\n",
+                checks[i].preset, offset, value);
+            assert_int_equal(value, checks[i].check);
+        }
+    }
+
+    assert_int_equal(crc_init_preset(&crc, 0), -1);
+    assert_int_equal(crc_init_preset(&crc, CRC_64_XZ + 1), -1);
+    assert_int_equal(crc_init_preset(NULL, CRC_32), -1);
+    assert_int_equal(crc_init(&crc, 0, 1, 0, false, false, 0), -1);
+    assert_int_equal(crc_init(&crc, 65, 1, 0, false, false, 0), -1);
+}
+
+void test_crc_ranges(void **state) {
+    static crc_t crc;
+    WORD_T message[MESSAGE_SIZE];
+    unsigned int seed = rand();
+    int isa_cnt;
+    const char* const* isas = bitter_isa_list(&isa_cnt);
+    const char* isa = bitter_isa();
+
+    // Random polynomials and ranges against the bitwise reference, with
+    // the kernels of all supported instruction sets.
+    for(int round=0; round<ROUNDS; round++) {
+        int width = rand_in_range_r(&seed, 1, 64);
+        uint64_t poly = ((uint64_t)rand_r(&seed) << 33) ^
+                        ((uint64_t)rand_r(&seed) << 1) ^ 1;
+        uint64_t init = ((uint64_t)rand_r(&seed) << 32) ^ rand_r(&seed);
+        assert_int_equal(crc_init(&crc, width, poly, init,
+            rand_r(&seed) & 1, rand_r(&seed) & 1, rand_r(&seed)), 0);
+
+        fill_random(message, MESSAGE_SIZE, &seed);
+        int start_bit = rand_in_range_r(&seed, 0, 200);
+        int bit_len = rand_in_range_r(&seed, 0,
+            MESSAGE_SIZE * WORD_BIT_LEN - start_bit);
+        uint64_t expected = crc_reference(&crc, message, MESSAGE_SIZE,
+            start_bit, bit_len);
+
+        for(int i=0; i<isa_cnt; i++) {
+            assert_int_equal(bitter_set_isa(isas[i]), 0);
+            uint64_t value = 0;
+            assert_int_equal(message_crc(&crc, message, MESSAGE_SIZE,
+                start_bit, bit_len, &value), start_bit + bit_len);
+            if(value != expected)
+                dbg_printf("isa(%s), width(%d), start_bit(%d), "
+                    "bit_len(%d)\n", isas[i], width, start_bit, bit_len);
+            assert_int_equal(value, expected);
+        }
+    }
+    bitter_set_isa(isa);
+
+    // Range ending exactly at the end of message.
+    uint64_t value;
+    crc_init_preset(&crc, CRC_32);
+    assert_int_equal(message_crc(&crc, message, MESSAGE_SIZE, 5,
+        MESSAGE_SIZE * WORD_BIT_LEN - 5, &value),
+        MESSAGE_SIZE * WORD_BIT_LEN);
+    assert_int_equal(value, crc_reference(&crc, message, MESSAGE_SIZE, 5,
+        MESSAGE_SIZE * WORD_BIT_LEN - 5));
+
+    assert_int_equal(message_crc(&crc, message, 2, -1, 8, &value), -1);
+    assert_int_equal(message_crc(&crc, message, 2, 128, 0, &value), -1);
+    assert_int_equal(message_crc(NULL, message, 2, 0, 8, &value), -1);
+    assert_int_equal(message_crc(&crc, message, 2, 0, -1, &value), -2);
+    assert_int_equal(message_crc(&crc, message, 2, 1, 128, &value), -3);
+    assert_int_equal(message_crc(&crc, message, 2, 0, 0, &value), 0);
+    assert_int_equal(value, 0);
+}
+
+void test_crc_update(void **state) {
+    static crc_t crc;
+    WORD_T message[MESSAGE_SIZE];
+    unsigned int seed = rand();
+
+    // Updating the CRC of a changed field matches computing it again.
+    for(int round=0; round<ROUNDS; round++) {
+        assert_int_equal(crc_init_preset(&crc,
+            rand_in_range_r(&seed, CRC_15_CAN, CRC_64_XZ)), 0);
+        fill_random(message, MESSAGE_SIZE, &seed);
+        int start_bit = rand_in_range_r(&seed, 0, 100);
+        int bit_len = rand_in_range_r(&seed, 64,
+            MESSAGE_SIZE * WORD_BIT_LEN - start_bit);
+        int field_bit_len = rand_in_range_r(&seed, 1, 64);
+        int field_start_bit = start_bit + rand_in_range_r(&seed, 0,
+            bit_len - field_bit_len);
+        WORD_T new_value = ((WORD_T)rand_r(&seed) << 40) ^ rand_r(&seed);
+
+        uint64_t value, expected;
+        WORD_T old_value;
+        message_crc(&crc, message, MESSAGE_SIZE, start_bit, bit_len, &value);
+        get_message_bits(message, MESSAGE_SIZE, field_start_bit,
+            field_bit_len, &old_value, true);
+        set_message_bits(message, MESSAGE_SIZE, field_start_bit,
+            field_bit_len, new_value, true, true);
+        message_crc(&crc, message, MESSAGE_SIZE, start_bit, bit_len,
+            &expected);
+
+        assert_int_equal(message_crc_update(&crc, &value, start_bit, bit_len,
+            field_start_bit, field_bit_len, old_value, new_value), 0);
+        assert_int_equal(value, expected);
+    }
+
+    uint64_t value = 0;
+    assert_int_equal(message_crc_update(&crc, &value, 0, 64, 8, 0, 1, 2), 0);
+    assert_int_equal(value, 0);
+    assert_int_equal(message_crc_update(NULL, &value, 0, 64, 0, 8, 1, 2), -1);
+    assert_int_equal(message_crc_update(&crc, NULL, 0, 64, 0, 8, 1, 2), -1);
+    assert_int_equal(message_crc_update(&crc, &value, 0, 64, 0, 65, 1, 2),
+        -2);
+    assert_int_equal(message_crc_update(&crc, &value, 8, 64, 0, 8, 1, 2), -3);
+    assert_int_equal(message_crc_update(&crc, &value, 0, 64, 60, 8, 1, 2),
+        -3);
+}
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 24 // 24 * 64 bits = 1536 bits
+
+
+void test_cursor_writer(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T message2[MESSAGE_SIZE];
+
+    WORD_T f[] = {0xabc, 0x123456, 0x2828282, 0xffffffff,
+                  0xaaaaaaaacccccccc, 0x2, 0x1};
+    int l[] = {12, 24, 28, 32, 64, 2, 2};
+    int field_cnt = sizeof(l) / sizeof(l[0]);
+
+    // Fields written with the cursor must result in the same message as
+    // when written with set_message_bits, including untouched bits before
+    // and after the fields.
+    int start_bits[] = {0, 1, 51, 64, 127};
+    for(int s=0; s<sizeof(start_bits) / sizeof(start_bits[0]); s++) {
+        memset(message, 0xa5, sizeof(message));
+        memset(message2, 0xa5, sizeof(message2));
+
+        int next_pos = start_bits[s];
+        for(int i=0; i<field_cnt; i++)
+            next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos,
+                l[i], f[i], true, true);
+
+        bit_writer_t w;
+        int next_pos2 = bit_writer_init(&w, message2, MESSAGE_SIZE,
+            start_bits[s]);
+        assert_int_equal(next_pos2, start_bits[s]);
+        for(int i=0; i<field_cnt; i++)
+            next_pos2 = bit_writer_put(&w, l[i], f[i], true);
+        assert_int_equal(bit_writer_flush(&w), next_pos2);
+
+        dbg_printf("start_bit(%d), next_pos(%d)\n", start_bits[s], next_pos2);
+        assert_int_equal(next_pos, next_pos2);
+        assert_memory_equal(message, message2, sizeof(message));
+    }
+}
+
+void test_cursor_reader(void **state) {
+    WORD_T message[MESSAGE_SIZE] = {0};
+    WORD_T values[MESSAGE_SIZE * 2];
+    int lens[MESSAGE_SIZE * 2];
+    bool lows[MESSAGE_SIZE * 2];
+
+    // Random fields of 1-64 bits written with set_message_bits must be read
+    // back unchanged by the cursor.
+    int start_bit = rand_in_range(0, WORD_BIT_LEN - 1);
+    int next_pos = start_bit;
+    int field_cnt = 0;
+    while(field_cnt < MESSAGE_SIZE * 2) {
+        int bit_len = rand_in_range(1, WORD_BIT_LEN);
+        if(next_pos + bit_len > MESSAGE_SIZE * WORD_BIT_LEN)
+            break;
+        lens[field_cnt] = bit_len;
+        lows[field_cnt] = rand_in_range(0, 1);
+        values[field_cnt] = rand_word();
+        next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos, bit_len,
+            values[field_cnt], true, lows[field_cnt]);
+        assert_true(next_pos >= 0);
+        field_cnt++;
+    }
+
+    bit_reader_t r;
+    int next_pos2 = bit_reader_init(&r, message, MESSAGE_SIZE, start_bit);
+    assert_int_equal(next_pos2, start_bit);
+    for(int i=0; i<field_cnt; i++) {
+        // Only the written bits of the original value are expected back.
+        WORD_T mask = ~(WORD_T)0;
+        if(lens[i] < WORD_BIT_LEN) {
+            if(lows[i])
+                mask = ((WORD_T)1 << lens[i]) - 1;
+            else
+                mask = ~(~(WORD_T)0 >> lens[i]);
+        }
+
+        WORD_T v2 = 0;
+        next_pos2 = bit_reader_get(&r, lens[i], &v2, lows[i]);
+        assert_true(next_pos2 >= 0);
+        assert_int_equal(values[i] & mask, v2);
+    }
+    assert_int_equal(next_pos, next_pos2);
+}
+
+void test_cursor_bounds(void **state) {
+    WORD_T message[2] = {0};
+    bit_writer_t w;
+    bit_reader_t r;
+
+    assert_int_equal(bit_writer_init(&w, message, 2, -1), -1);
+    assert_int_equal(bit_writer_init(&w, message, 2, 128), -1);
+    assert_int_equal(bit_reader_init(&r, message, 2, 128), -1);
+
+    // Fill message up to the last bit, anything beyond must fail.
+    assert_int_equal(bit_writer_init(&w, message, 2, 100), 100);
+    assert_int_equal(bit_writer_put(&w, 65, 0, true), -2);
+    assert_int_equal(bit_writer_put(&w, 28, 0xfffffff, true), 128);
+    assert_int_equal(bit_writer_put(&w, 1, 1, true), -3);
+    assert_int_equal(bit_writer_flush(&w), 128);
+    assert_int_equal(WORD_NTOH(message[1]), 0xfffffff);
+
+    assert_int_equal(bit_reader_init(&r, message, 2, 64), 64);
+    assert_int_equal(bit_reader_get(&r, 0, NULL, true), -2);
+    assert_int_equal(bit_reader_get(&r, 64, NULL, true), 128);
+    assert_int_equal(bit_reader_get(&r, 1, NULL, true), -3);
+}
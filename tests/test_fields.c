@@ -0,0 +1,326 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 24 // 24 * 64 bits = 1536 bits
+#define MAX_FIELDS   128
+
+
+// Only the bits of a value which are stored in the message.
+static WORD_T field_mask(int bit_len, bool start_low) {
+    if(bit_len >= WORD_BIT_LEN)
+        return ~(WORD_T)0;
+    if(start_low)
+        return ((WORD_T)1 << bit_len) - 1;
+    return ~(~(WORD_T)0 >> bit_len);
+}
+
+void test_fields_example(void **state) {
+    // Same message as in test_binary_messages.
+    typedef struct {
+        WORD_T f1, f2, f3, f4, f5, f6, f7;
+    } example_t;
+
+    const field_desc_t fields[] = {
+        {  0, 12, true, true, offsetof(example_t, f1)},
+        { 12, 24, true, true, offsetof(example_t, f2)},
+        { 36, 28, true, true, offsetof(example_t, f3)},
+        { 64, 32, true, true, offsetof(example_t, f4)},
+        { 96, 64, true, true, offsetof(example_t, f5)},
+        {160,  2, true, true, offsetof(example_t, f6)},
+        {162,  2, true, true, offsetof(example_t, f7)},
+    };
+    example_t in = {0xabc, 0x123456, 0x2828282, 0xffffffff,
+                    0xaaaaaaaacccccccc, 0x2, 0x1};
+    example_t out = {0};
+
+    message_layout_t layout;
+    int rtc = message_layout_init(&layout, fields, 7, MESSAGE_SIZE);
+    assert_int_equal(rtc, 164);
+    // Fields are merged into operations on 3 message words.
+    assert_int_equal(layout.group_cnt, 3);
+
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T message2[MESSAGE_SIZE];
+    memset(message, 0x5a, sizeof(message));
+    memset(message2, 0x5a, sizeof(message2));
+
+    int next_pos = 0;
+    next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos, 12, in.f1, true, true);
+    next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos, 24, in.f2, true, true);
+    next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos, 28, in.f3, true, true);
+    next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos, 32, in.f4, true, true);
+    next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos, 64, in.f5, true, true);
+    next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos,  2, in.f6, true, true);
+    next_pos = set_message_bits(message, MESSAGE_SIZE, next_pos,  2, in.f7, true, true);
+
+    assert_int_equal(encode_fields(&layout, message2, &in), next_pos);
+    assert_memory_equal(message, message2, sizeof(message));
+
+    assert_int_equal(decode_fields(&layout, message2, &out), next_pos);
+    assert_memory_equal(&in, &out, sizeof(in));
+
+    message_layout_free(&layout);
+}
+
+void test_fields_R(void **state) {
+    field_desc_t fields[MAX_FIELDS];
+    WORD_T values[MAX_FIELDS];
+    WORD_T values2[MAX_FIELDS];
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T message2[MESSAGE_SIZE];
+
+    // Random layout of 1-64 bit fields with random gaps and semantics.
+    // Encoding must produce the same message as consecutive
+    // set_message_bits calls.
+    int field_cnt = 0;
+    int next_pos = rand_in_range(0, WORD_BIT_LEN - 1);
+    while(field_cnt < MAX_FIELDS) {
+        int bit_len = rand_in_range(1, WORD_BIT_LEN);
+        if(next_pos + bit_len > MESSAGE_SIZE * WORD_BIT_LEN)
+            break;
+        field_desc_t* f = &fields[field_cnt];
+        f->start_bit = next_pos;
+        f->bit_len = bit_len;
+        f->erase = rand_in_range(0, 3) > 0;
+        f->start_low = rand_in_range(0, 1);
+        f->value_offset = field_cnt * sizeof(WORD_T);
+        values[field_cnt] = rand_word();
+        next_pos += bit_len + rand_in_range(0, 3) * rand_in_range(0, 8);
+        field_cnt++;
+    }
+
+    for(int i=0; i<MESSAGE_SIZE; i++)
+        message[i] = message2[i] = rand_word();
+
+    for(int i=0; i<field_cnt; i++) {
+        field_desc_t* f = &fields[i];
+        int rtc = set_message_bits(message, MESSAGE_SIZE, f->start_bit,
+            f->bit_len, values[i], f->erase, f->start_low);
+        assert_true(rtc >= 0);
+    }
+
+    message_layout_t layout;
+    int end_bit = message_layout_init(&layout, fields, field_cnt, MESSAGE_SIZE);
+    dbg_printf("fields(%d), end_bit(%d), groups(%d)\n",
+        field_cnt, end_bit, layout.group_cnt);
+    assert_int_equal(end_bit, fields[field_cnt-1].start_bit +
+        fields[field_cnt-1].bit_len);
+    assert_int_equal(encode_fields(&layout, message2, values), end_bit);
+    assert_memory_equal(message, message2, sizeof(message));
+
+    // Decoding a message where all fields are erased must return the
+    // stored bits of all values.
+    for(int i=0; i<field_cnt; i++)
+        fields[i].erase = true;
+    message_layout_free(&layout);
+    assert_int_equal(message_layout_init(&layout, fields, field_cnt,
+        MESSAGE_SIZE), end_bit);
+    encode_fields(&layout, message2, values);
+    memset(values2, 0xff, sizeof(values2));
+    assert_int_equal(decode_fields(&layout, message2, values2), end_bit);
+    for(int i=0; i<field_cnt; i++)
+        assert_int_equal(values[i] & field_mask(fields[i].bit_len,
+            fields[i].start_low), values2[i]);
+
+    message_layout_free(&layout);
+}
+
+void test_fields_bounds(void **state) {
+    message_layout_t layout;
+    field_desc_t f = {0, 8, true, true, 0};
+
+    assert_int_equal(message_layout_init(&layout, &f, 1, 2), 8);
+    message_layout_free(&layout);
+
+    f.start_bit = -1;
+    assert_int_equal(message_layout_init(&layout, &f, 1, 2), -1);
+    f.start_bit = 128;
+    assert_int_equal(message_layout_init(&layout, &f, 1, 2), -1);
+    f.start_bit = 0;
+    f.bit_len = 65;
+    assert_int_equal(message_layout_init(&layout, &f, 1, 2), -2);
+    f.start_bit = 121;
+    f.bit_len = 8;
+    assert_int_equal(message_layout_init(&layout, &f, 1, 2), -3);
+    f.start_bit = 0;
+    f.value_offset = 3;
+    assert_int_equal(message_layout_init(&layout, &f, 1, 2), -4);
+
+    // Using a failed layout must not touch the message.
+    WORD_T message[2] = {0};
+    WORD_T value = 0xff;
+    assert_int_equal(encode_fields(&layout, message, &value), -1);
+    assert_int_equal(message[0], 0);
+}
+
+void test_fields_columns(void **state) {
+    #define BATCH_SIZE 53   // Not a multiple of the kernel block size.
+    field_desc_t fields[MAX_FIELDS];
+    WORD_T values[MAX_FIELDS];
+    static WORD_T column_data[MAX_FIELDS][BATCH_SIZE];
+    static WORD_T decoded[MAX_FIELDS][BATCH_SIZE];
+    static WORD_T messages[BATCH_SIZE][MESSAGE_SIZE];
+    static WORD_T expected[BATCH_SIZE][MESSAGE_SIZE];
+    static WORD_T batch[BATCH_SIZE][MESSAGE_SIZE];
+    static WORD_T scattered[BATCH_SIZE][MESSAGE_SIZE];
+    const WORD_T* columns[MAX_FIELDS];
+    WORD_T* decoded_columns[MAX_FIELDS];
+    WORD_T* message_ptrs[BATCH_SIZE];
+
+    // Random layout like in test_fields_R.
+    int field_cnt = 0;
+    int next_pos = rand_in_range(0, WORD_BIT_LEN - 1);
+    while(field_cnt < MAX_FIELDS) {
+        int bit_len = rand_in_range(1, WORD_BIT_LEN);
+        if(next_pos + bit_len > MESSAGE_SIZE * WORD_BIT_LEN)
+            break;
+        field_desc_t* f = &fields[field_cnt];
+        f->start_bit = next_pos;
+        f->bit_len = bit_len;
+        f->erase = rand_in_range(0, 3) > 0;
+        f->start_low = rand_in_range(0, 1);
+        f->value_offset = field_cnt * sizeof(WORD_T);
+        columns[field_cnt] = column_data[field_cnt];
+        decoded_columns[field_cnt] = decoded[field_cnt];
+        next_pos += bit_len + rand_in_range(0, 3) * rand_in_range(0, 8);
+        field_cnt++;
+    }
+
+    message_layout_t layout;
+    int end_bit = message_layout_init(&layout, fields, field_cnt, MESSAGE_SIZE);
+    assert_true(end_bit > 0);
+
+    // Expected messages are encoded one by one with encode_fields.
+    for(int k=0; k<BATCH_SIZE; k++) {
+        for(int i=0; i<MESSAGE_SIZE; i++)
+            messages[k][i] = expected[k][i] = rand_word();
+        for(int i=0; i<field_cnt; i++)
+            values[i] = column_data[i][k] = rand_word();
+        encode_fields(&layout, expected[k], values);
+        // Pointer variant gets messages in reverse order.
+        message_ptrs[k] = scattered[BATCH_SIZE - 1 - k];
+    }
+
+    // Batch functions must match encode_fields/decode_fields with all
+    // kernels supported by the CPU.
+    int isa_cnt = 0;
+    const char* const* isa_list = bitter_isa_list(&isa_cnt);
+    const char* isa = bitter_isa();
+    for(int n=0; n<isa_cnt; n++) {
+        dbg_printf("isa(%s), fields(%d)\n", isa_list[n], field_cnt);
+        assert_int_equal(bitter_set_isa(isa_list[n]), 0);
+
+        memcpy(batch, messages, sizeof(batch));
+        assert_int_equal(encode_columns(&layout, &batch[0][0], BATCH_SIZE,
+            columns), BATCH_SIZE);
+        assert_memory_equal(batch, expected, sizeof(batch));
+
+        for(int k=0; k<BATCH_SIZE; k++)
+            memcpy(message_ptrs[k], messages[k], sizeof(messages[k]));
+        assert_int_equal(encode_columns_ptr(&layout, message_ptrs, BATCH_SIZE,
+            columns), BATCH_SIZE);
+        for(int k=0; k<BATCH_SIZE; k++)
+            assert_memory_equal(message_ptrs[k], expected[k],
+                sizeof(expected[k]));
+
+        memset(decoded, 0xff, sizeof(decoded));
+        assert_int_equal(decode_columns(&layout, &batch[0][0], BATCH_SIZE,
+            decoded_columns), BATCH_SIZE);
+        for(int k=0; k<BATCH_SIZE; k++) {
+            decode_fields(&layout, expected[k], values);
+            for(int i=0; i<field_cnt; i++)
+                assert_int_equal(decoded[i][k], values[i]);
+        }
+
+        memset(decoded, 0xff, sizeof(decoded));
+        assert_int_equal(decode_columns_ptr(&layout,
+            (const WORD_T* const*)message_ptrs, BATCH_SIZE, decoded_columns),
+            BATCH_SIZE);
+        for(int k=0; k<BATCH_SIZE; k++) {
+            decode_fields(&layout, expected[k], values);
+            for(int i=0; i<field_cnt; i++)
+                assert_int_equal(decoded[i][k], values[i]);
+        }
+    }
+    assert_int_equal(bitter_set_isa(isa), 0);
+
+    assert_int_equal(encode_columns(&layout, NULL, BATCH_SIZE, columns), -1);
+    assert_int_equal(decode_columns(&layout, &batch[0][0], -1,
+        decoded_columns), -1);
+    message_layout_free(&layout);
+}
+
+void test_fields_buffer(void **state) {
+    #define BUFFER_CNT 37
+    field_desc_t fields[MAX_FIELDS];
+    WORD_T values[MAX_FIELDS];
+    static WORD_T decoded[MAX_FIELDS][BUFFER_CNT + 3];
+    static uint8_t storage[BUFFER_CNT][MESSAGE_SIZE * WORD_BYTE_LEN + 8];
+    WORD_T* columns[MAX_FIELDS];
+    const uint8_t* buffers[BUFFER_CNT];
+    size_t buffer_lens[BUFFER_CNT];
+    WORD_T message[MESSAGE_SIZE];
+
+    int field_cnt = 0;
+    int next_pos = rand_in_range(0, 7);
+    while(field_cnt < MAX_FIELDS) {
+        int bit_len = rand_in_range(1, WORD_BIT_LEN);
+        if(next_pos + bit_len > MESSAGE_SIZE * WORD_BIT_LEN)
+            break;
+        field_desc_t* f = &fields[field_cnt];
+        f->start_bit = next_pos;
+        f->bit_len = bit_len;
+        f->erase = true;
+        f->start_low = rand_in_range(0, 1);
+        f->value_offset = field_cnt * sizeof(WORD_T);
+        columns[field_cnt] = decoded[field_cnt];
+        next_pos += bit_len + rand_in_range(0, 8);
+        field_cnt++;
+    }
+    message_layout_t layout;
+    int end_bit = message_layout_init(&layout, fields, field_cnt, MESSAGE_SIZE);
+    assert_true(end_bit > 0);
+
+    // Buffers at odd addresses, just long enough for the layout.
+    for(int k=0; k<BUFFER_CNT; k++) {
+        for(int i=0; i<MESSAGE_SIZE; i++)
+            message[i] = rand_word();
+        buffers[k] = &storage[k][1 + k % 7];
+        buffer_lens[k] = (end_bit + 7) / 8;
+        memcpy((uint8_t*)buffers[k], message, sizeof(message));
+    }
+
+    // Values are stored behind column index 3.
+    assert_int_equal(decode_columns_buffer(&layout, buffers, buffer_lens,
+        BUFFER_CNT, columns, 3), BUFFER_CNT);
+    for(int k=0; k<BUFFER_CNT; k++) {
+        memcpy(message, buffers[k], sizeof(message));
+        decode_fields(&layout, message, values);
+        for(int i=0; i<field_cnt; i++)
+            assert_int_equal(decoded[i][k + 3], values[i]);
+    }
+
+    buffer_lens[5]--;
+    assert_int_equal(decode_columns_buffer(&layout, buffers, buffer_lens,
+        BUFFER_CNT, columns, 0), -3);
+    message_layout_free(&layout);
+}
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 48 // 48 * 64 bits = 3072 bits
+#define FIELD_CNT    40
+
+
+void test_host_messages(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T working[MESSAGE_SIZE];
+    int start[FIELD_CNT];
+    int len[FIELD_CNT];
+
+    // A message built in host-byte-order and finalized is identical to the
+    // same message built with set_message_bits.
+    for(int n=0; n<500; n++) {
+        for(int i=0; i<MESSAGE_SIZE; i++)
+            message[i] = working[i] = rand_word();
+        message_load(working, MESSAGE_SIZE);
+
+        int pos = rand_in_range(0, 63);
+        for(int i=0; i<FIELD_CNT; i++) {
+            start[i] = pos;
+            len[i] = rand_in_range(0, WORD_BIT_LEN);
+            WORD_T value = rand_word();
+            bool erase = rand_in_range(0, 1);
+            bool start_low = rand_in_range(0, 1);
+            dbg_printf("start(%d), len(%d)\n", start[i], len[i]);
+
+            int rtc = set_message_bits(message, MESSAGE_SIZE, pos, len[i],
+                value, erase, start_low);
+            assert_int_equal(set_message_bits_h(working, MESSAGE_SIZE, pos,
+                len[i], value, erase, start_low), rtc);
+            assert_int_equal(rtc, pos + len[i]);
+            pos = rtc;
+        }
+
+        // Fields read back from the working message.
+        for(int i=0; i<FIELD_CNT; i++) {
+            WORD_T v1, v2;
+            bool start_low = rand_in_range(0, 1);
+            get_message_bits(message, MESSAGE_SIZE, start[i], len[i], &v1,
+                start_low);
+            assert_int_equal(get_message_bits_h(working, MESSAGE_SIZE,
+                start[i], len[i], &v2, start_low), start[i] + len[i]);
+            assert_int_equal(v1, v2);
+        }
+
+        assert_int_equal(message_finalize(working, MESSAGE_SIZE), 0);
+        assert_memory_equal(message, working, sizeof(message));
+    }
+}
+
+void test_host_messages_wide(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T working[MESSAGE_SIZE];
+    WORD_T value[4], v1[4], v2[4];
+    uint8_t bytes[32], b1[32], b2[32];
+
+    // Fields wider than a word, as words and as bytes.
+    for(int n=0; n<500; n++) {
+        for(int i=0; i<MESSAGE_SIZE; i++)
+            message[i] = working[i] = rand_word();
+        message_load(working, MESSAGE_SIZE);
+        for(int i=0; i<4; i++)
+            value[i] = rand_word();
+        for(int i=0; i<32; i++)
+            bytes[i] = rand_in_range(0, 255);
+
+        int start_bit = rand_in_range(0, MESSAGE_SIZE * WORD_BIT_LEN - 512);
+        int len2 = rand_in_range(0, 4 * WORD_BIT_LEN);
+        int len3 = rand_in_range(0, 8 * 32);
+        bool erase = rand_in_range(0, 1);
+        dbg_printf("start(%d), len2(%d), len3(%d)\n", start_bit, len2, len3);
+
+        assert_int_equal(set_message_bits2_h(working, MESSAGE_SIZE,
+            start_bit, len2, value, 4, erase), start_bit + len2);
+        set_message_bits2(message, MESSAGE_SIZE, start_bit, len2, value, 4,
+            erase);
+        assert_int_equal(set_message_bits3_h(working, MESSAGE_SIZE,
+            start_bit + 256, len3, bytes, 32, erase), start_bit + 256 + len3);
+        set_message_bits3(message, MESSAGE_SIZE, start_bit + 256, len3,
+            bytes, 32, erase);
+
+        memset(b1, 0, sizeof(b1));
+        memset(b2, 0, sizeof(b2));
+        get_message_bits2(message, MESSAGE_SIZE, start_bit, len2, v1, 4);
+        assert_int_equal(get_message_bits2_h(working, MESSAGE_SIZE,
+            start_bit, len2, v2, 4), start_bit + len2);
+        assert_memory_equal(v1, v2, (len2 + WORD_BIT_LEN - 1) /
+            WORD_BIT_LEN * sizeof(WORD_T));
+        get_message_bits3(message, MESSAGE_SIZE, start_bit + 256, len3, b1,
+            32);
+        assert_int_equal(get_message_bits3_h(working, MESSAGE_SIZE,
+            start_bit + 256, len3, b2, 32), start_bit + 256 + len3);
+        assert_memory_equal(b1, b2, sizeof(b1));
+
+        assert_int_equal(message_finalize(working, MESSAGE_SIZE), 0);
+        assert_memory_equal(message, working, sizeof(message));
+    }
+
+    assert_int_equal(set_message_bits2_h(working, 2, 128, 8, value, 1, true),
+        -1);
+    assert_int_equal(set_message_bits2_h(working, 2, 100, 64, value, 1, true),
+        -30);
+    assert_int_equal(get_message_bits2_h(working, 2, 0, 8, NULL, 1), -2);
+    assert_int_equal(set_message_bits3_h(working, 2, 0, 9, bytes, 1, true),
+        -1);
+    assert_int_equal(get_message_bits3_h(working, 2, 128, 8, b1, 1), -10);
+    assert_int_equal(get_message_bits3_h(working, 2, 100, 64, b1, 8), -300);
+}
+
+void test_host_all_isa(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T working[MESSAGE_SIZE];
+    int cnt;
+    const char* const* isa = bitter_isa_list(&cnt);
+    const char* current = bitter_isa();
+
+    // Conversion kernels of all instruction sets, odd lengths for vector
+    // loop tails.
+    for(int k=0; k<cnt; k++) {
+        assert_int_equal(bitter_set_isa(isa[k]), 0);
+        for(int len=0; len<=MESSAGE_SIZE; len++) {
+            for(int i=0; i<MESSAGE_SIZE; i++)
+                message[i] = working[i] = rand_word();
+            assert_int_equal(message_load(working, len), 0);
+            for(int i=0; i<MESSAGE_SIZE; i++)
+                assert_int_equal(working[i],
+                    (i < len ? WORD_NTOH(message[i]) : message[i]));
+            assert_int_equal(message_finalize(working, len), 0);
+            assert_memory_equal(message, working, sizeof(message));
+        }
+    }
+    assert_int_equal(bitter_set_isa(current), 0);
+}
+
+void test_host_bounds(void **state) {
+    WORD_T working[2] = {0};
+
+    assert_int_equal(set_message_bits_h(working, 2, -1, 8, 0, true, true), -1);
+    assert_int_equal(set_message_bits_h(working, 2, 128, 8, 0, true, true), -1);
+    assert_int_equal(set_message_bits_h(working, 2, 0, 65, 0, true, true), -2);
+    assert_int_equal(set_message_bits_h(working, 2, 120, 9, 0, true, true), -3);
+    assert_int_equal(get_message_bits_h(working, 2, 128, 8, NULL, true), -1);
+    assert_int_equal(get_message_bits_h(working, 2, 0, -1, NULL, true), -2);
+    assert_int_equal(get_message_bits_h(working, 2, 120, 9, NULL, true), -3);
+    assert_int_equal(message_finalize(NULL, 2), -1);
+    assert_int_equal(message_load(working, -1), -1);
+
+    // Bit 0 is the MSB of word 0 also in host-byte-order.
+    assert_int_equal(set_message_bits_h(working, 2, 60, 8, 0xa5, true, true),
+        68);
+    assert_int_equal(working[0], 0xa);
+    assert_int_equal(working[1], (WORD_T)0x5 << 60);
+}
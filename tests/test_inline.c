@@ -0,0 +1,82 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+#include "bitter_inline.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 4 // 4 * 64 bits = 256 bits
+
+
+void test_inline_R(void **state) {
+    WORD_T message[3][MESSAGE_SIZE];
+    WORD_T message2[3][MESSAGE_SIZE];
+
+    // Same bits, values and error codes as the library functions, also for
+    // invalid arguments.
+    for(int n=0; n<20000; n++) {
+        for(int k=0; k<3; k++)
+            for(int i=0; i<MESSAGE_SIZE; i++)
+                message[k][i] = message2[k][i] = rand_word();
+
+        int start_bit = rand_in_range(-2, MESSAGE_SIZE * WORD_BIT_LEN + 2);
+        int bit_len = rand_in_range(-1, WORD_BIT_LEN + 1);
+        WORD_T value = rand_word();
+        bool erase = rand_in_range(0, 1);
+        bool start_low = rand_in_range(0, 1);
+        dbg_printf("start(%d), len(%d)\n", start_bit, bit_len);
+
+        assert_int_equal(
+            set_message_bits_inline(message[0], MESSAGE_SIZE, start_bit,
+                bit_len, value, erase, start_low),
+            set_message_bits(message2[0], MESSAGE_SIZE, start_bit,
+                bit_len, value, erase, start_low));
+        assert_int_equal(
+            set_message_bits_h_inline(message[1], MESSAGE_SIZE, start_bit,
+                bit_len, value, erase, start_low),
+            set_message_bits_h(message2[1], MESSAGE_SIZE, start_bit,
+                bit_len, value, erase, start_low));
+        assert_int_equal(
+            set_message_bits_le_inline(message[2], MESSAGE_SIZE, start_bit,
+                bit_len, value, erase, start_low),
+            set_message_bits_le(message2[2], MESSAGE_SIZE, start_bit,
+                bit_len, value, erase, start_low));
+        assert_memory_equal(message, message2, sizeof(message));
+
+        WORD_T v1 = 0, v2 = 0;
+        assert_int_equal(
+            get_message_bits_inline(message[0], MESSAGE_SIZE, start_bit,
+                bit_len, &v1, start_low),
+            get_message_bits(message2[0], MESSAGE_SIZE, start_bit,
+                bit_len, &v2, start_low));
+        assert_int_equal(v1, v2);
+        assert_int_equal(
+            get_message_bits_h_inline(message[1], MESSAGE_SIZE, start_bit,
+                bit_len, &v1, start_low),
+            get_message_bits_h(message2[1], MESSAGE_SIZE, start_bit,
+                bit_len, &v2, start_low));
+        assert_int_equal(v1, v2);
+        assert_int_equal(
+            get_message_bits_le_inline(message[2], MESSAGE_SIZE, start_bit,
+                bit_len, &v1, start_low),
+            get_message_bits_le(message2[2], MESSAGE_SIZE, start_bit,
+                bit_len, &v2, start_low));
+        assert_int_equal(v1, v2);
+    }
+}
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 24 // 24 * 64 bits = 1536 bits
+#define MESSAGE_BITS (MESSAGE_SIZE * WORD_BIT_LEN)
+
+
+static void fill_message(WORD_T* message, int len) {
+    for(int i=0; i<len; i++)
+        message[i] = rand_word();
+}
+
+void test_le_example(void **state) {
+    // CAN frame with Intel byte order signals.
+    WORD_T message[1];
+    uint8_t* frame = (uint8_t*)message;
+    uint8_t data[8] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0};
+    memcpy(frame, data, 8);
+
+    WORD_T v;
+    assert_int_equal(get_message_bits_le(message, 1, 8, 16, &v, true), 24);
+    assert_int_equal(v, 0x5634);
+    assert_int_equal(get_message_bits_le(message, 1, 4, 8, &v, true), 12);
+    assert_int_equal(v, 0x41);
+    assert_int_equal(get_message_bits_le(message, 1, 0, 64, &v, true), 64);
+    assert_int_equal(v, 0xf0debc9a78563412);
+
+    assert_int_equal(set_message_bits_le(message, 1, 12, 12, 0xabc, true, true),
+        24);
+    assert_int_equal(frame[1], 0xc4);
+    assert_int_equal(frame[2], 0xab);
+    assert_int_equal(frame[0], 0x12);
+    assert_int_equal(frame[3], 0x78);
+
+    // Not start_low, field is taken from the most significant bits.
+    assert_int_equal(set_message_bits_le(message, 1, 0, 4,
+        (WORD_T)0x5 << (WORD_BIT_LEN - 4), true, false), 4);
+    assert_int_equal(frame[0], 0x15);
+    assert_int_equal(get_message_bits_le(message, 1, 0, 4, &v, false), 4);
+    assert_int_equal(v, (WORD_T)0x5 << (WORD_BIT_LEN - 4));
+}
+
+void test_le_R(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T ref[MESSAGE_SIZE];
+
+    for(int n=0; n<5000; n++) {
+        fill_message(message, MESSAGE_SIZE);
+        memcpy(ref, message, sizeof(message));
+
+        int bit_len = rand_in_range(1, WORD_BIT_LEN);
+        int start_bit = rand_in_range(0, MESSAGE_BITS - bit_len);
+        WORD_T value = rand_word();
+        bool erase = rand_in_range(0, 1);
+        dbg_printf("start(%d), len(%d)\n", start_bit, bit_len);
+
+        assert_int_equal(set_message_bits_le(message, MESSAGE_SIZE, start_bit,
+            bit_len, value, erase, true), start_bit + bit_len);
+
+        WORD_T expected = 0;
+        for(int i=0; i<MESSAGE_BITS; i++) {
+            int b = ref_bit_le(ref, i);
+            if(i >= start_bit && i < start_bit + bit_len) {
+                int vb = (value >> (i - start_bit)) & 1;
+                b = (erase ? vb : b | vb);
+                expected |= (WORD_T)b << (i - start_bit);
+            }
+            assert_int_equal(ref_bit_le(message, i), b);
+        }
+
+        WORD_T v;
+        assert_int_equal(get_message_bits_le(message, MESSAGE_SIZE, start_bit,
+            bit_len, &v, true), start_bit + bit_len);
+        assert_int_equal(v, expected);
+    }
+}
+
+void test_le_bulk_R(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    WORD_T ref[MESSAGE_SIZE];
+    WORD_T words[MESSAGE_SIZE];
+    WORD_T words2[MESSAGE_SIZE];
+    uint8_t bytes[MESSAGE_SIZE * WORD_BYTE_LEN];
+    uint8_t bytes2[MESSAGE_SIZE * WORD_BYTE_LEN];
+
+    for(int n=0; n<2000; n++) {
+        int bit_len = rand_in_range(0, MESSAGE_BITS - 1);
+        int start_bit = rand_in_range(0, MESSAGE_BITS - bit_len - 1);
+        bool erase = rand_in_range(0, 1);
+        bool use_bytes = rand_in_range(0, 1);
+        dbg_printf("start(%d), len(%d), bytes(%d)\n", start_bit, bit_len,
+            use_bytes);
+
+        fill_message(message, MESSAGE_SIZE);
+        memcpy(ref, message, sizeof(message));
+        fill_message(words, MESSAGE_SIZE);
+        memcpy(bytes, words, sizeof(bytes));
+
+        // Value bit i is bit i%8 of byte i/8 for bytes, bit i%n of word
+        // i/n for words.
+        int rtc;
+        if(use_bytes)
+            rtc = set_message_bits3_le(message, MESSAGE_SIZE, start_bit,
+                bit_len, bytes, (bit_len + 7) / 8, erase);
+        else
+            rtc = set_message_bits2_le(message, MESSAGE_SIZE, start_bit,
+                bit_len, words, MESSAGE_SIZE, erase);
+        assert_int_equal(rtc, start_bit + bit_len);
+
+        for(int i=0; i<MESSAGE_BITS; i++) {
+            int b = ref_bit_le(ref, i);
+            if(i >= start_bit && i < start_bit + bit_len) {
+                int k = i - start_bit;
+                int vb = (use_bytes ? (bytes[k / 8] >> (k % 8)) & 1 :
+                          (int)((words[k / WORD_BIT_LEN] >> (k % WORD_BIT_LEN)) & 1));
+                b = (erase ? vb : b | vb);
+            }
+            assert_int_equal(ref_bit_le(message, i), b);
+        }
+
+        // Read back, unused bits of the last word or byte are 0.
+        memset(words2, 0xff, sizeof(words2));
+        assert_int_equal(get_message_bits2_le(message, MESSAGE_SIZE, start_bit,
+            bit_len, words2, MESSAGE_SIZE), start_bit + bit_len);
+        memset(bytes2, 0xff, sizeof(bytes2));
+        assert_int_equal(get_message_bits3_le(message, MESSAGE_SIZE, start_bit,
+            bit_len, bytes2, sizeof(bytes2)), start_bit + bit_len);
+        for(int k=0; k<bit_len + (-bit_len & (WORD_BIT_LEN - 1)); k++) {
+            int b = (k < bit_len ? ref_bit_le(message, start_bit + k) : 0);
+            assert_int_equal((words2[k / WORD_BIT_LEN] >> (k % WORD_BIT_LEN)) & 1, b);
+            if(k < (bit_len + 7) / 8 * 8)
+                assert_int_equal((bytes2[k / 8] >> (k % 8)) & 1, b);
+        }
+    }
+}
+
+void test_le_bounds(void **state) {
+    WORD_T message[2] = {0};
+    WORD_T words[3] = {0};
+    uint8_t bytes[24] = {0};
+
+    assert_int_equal(set_message_bits_le(message, 2, -1, 8, 0, true, true), -1);
+    assert_int_equal(set_message_bits_le(message, 2, 128, 8, 0, true, true), -1);
+    assert_int_equal(set_message_bits_le(message, 2, 0, 65, 0, true, true), -2);
+    assert_int_equal(set_message_bits_le(message, 2, 120, 9, 0, true, true), -3);
+    assert_int_equal(get_message_bits_le(message, 2, 120, 9, NULL, true), -3);
+
+    assert_int_equal(set_message_bits2_le(message, 2, 128, 8, words, 3, true), -1);
+    assert_int_equal(set_message_bits2_le(message, 2, 64, 72, words, 3, true),
+        -10);
+    assert_int_equal(set_message_bits2_le(message, 2, 60, 72, words, 3, true),
+        -30);
+    assert_int_equal(get_message_bits2_le(message, 2, 0, 8, NULL, 3), -2);
+    assert_int_equal(get_message_bits2_le(message, 2, 60, 72, words, 3), -30);
+
+    assert_int_equal(set_message_bits3_le(message, 2, 0, 9, bytes, 1, true), -1);
+    assert_int_equal(set_message_bits3_le(message, 2, 128, 8, bytes, 1, true),
+        -10);
+    assert_int_equal(set_message_bits3_le(message, 2, 60, 72, bytes, 24, true),
+        -300);
+    assert_int_equal(get_message_bits3_le(message, 2, 0, 8, NULL, 1), -2);
+    assert_int_equal(get_message_bits3_le(message, 2, 64, 72, bytes, 24), -100);
+}
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdatomic.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 4
+#define MESSAGE_CNT  10007  // Not a multiple of any chunk size.
+#define THREAD_CNT   4
+#define FIELD_CNT    12
+
+
+typedef struct {
+    _Atomic int hits[MESSAGE_CNT];
+    _Atomic int calls[THREAD_CNT];
+    void* scratch[THREAD_CNT];
+} count_job_t;
+
+static void count_items(void* arg, int start, int end, void* scratch,
+                        int worker) {
+    count_job_t* job = (count_job_t*)arg;
+    for(int i=start; i<end; i++)
+        atomic_fetch_add(&job->hits[i], 1);
+    atomic_fetch_add(&job->calls[worker], 1);
+    job->scratch[worker] = scratch;
+    // Scratch is private to the worker.
+    memset(scratch, worker, 256);
+}
+
+void test_pool_run(void **state) {
+    static count_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    bitter_pool_t* pool = bitter_pool_create(THREAD_CNT, 200);
+    assert_non_null(pool);
+    assert_int_equal(bitter_pool_threads(pool), THREAD_CNT);
+
+    // Every item is processed exactly once, also with chunks not fitting
+    // evenly into the per worker ranges.
+    for(int chunk=1; chunk<=4096; chunk*=8) {
+        memset(&job, 0, sizeof(job));
+        assert_int_equal(bitter_pool_run(pool, MESSAGE_CNT, chunk,
+            count_items, &job), MESSAGE_CNT);
+        int calls = 0;
+        for(int i=0; i<MESSAGE_CNT; i++)
+            assert_int_equal(job.hits[i], 1);
+        for(int i=0; i<THREAD_CNT; i++) {
+            calls += job.calls[i];
+            if(job.scratch[i] != NULL)
+                assert_int_equal((uintptr_t)job.scratch[i] % 64, 0);
+        }
+        dbg_printf("chunk(%4d), calls(%d)\n", chunk, calls);
+        assert_int_equal(calls, (MESSAGE_CNT + chunk - 1) / chunk);
+    }
+
+    assert_int_equal(bitter_pool_run(pool, 0, 1, count_items, &job), 0);
+    assert_int_equal(bitter_pool_run(pool, 10, 0, count_items, &job), -1);
+    assert_int_equal(bitter_pool_run(pool, 10, 1, NULL, &job), -1);
+    bitter_pool_destroy(pool);
+
+    pool = bitter_pool_create(0, 0);
+    assert_non_null(pool);
+    assert_true(bitter_pool_threads(pool) >= 1);
+    bitter_pool_destroy(pool);
+    assert_null(bitter_pool_create(-1, 0));
+}
+
+void test_pool_columns(void **state) {
+    field_desc_t fields[FIELD_CNT];
+    static WORD_T column_data[FIELD_CNT][MESSAGE_CNT];
+    static WORD_T decoded[FIELD_CNT][MESSAGE_CNT];
+    static WORD_T messages[MESSAGE_CNT][MESSAGE_SIZE];
+    static WORD_T expected[MESSAGE_CNT][MESSAGE_SIZE];
+    const WORD_T* columns[FIELD_CNT];
+    WORD_T* decoded_columns[FIELD_CNT];
+    static WORD_T* message_ptrs[MESSAGE_CNT];
+    unsigned int seed = rand();
+
+    int next_pos = 0;
+    for(int i=0; i<FIELD_CNT; i++) {
+        fields[i].start_bit = next_pos;
+        fields[i].bit_len = rand_in_range_r(&seed, 1, 20);
+        fields[i].erase = true;
+        fields[i].start_low = rand_in_range_r(&seed, 0, 1);
+        fields[i].value_offset = 0;
+        next_pos += fields[i].bit_len + rand_in_range_r(&seed, 0, 4);
+        columns[i] = column_data[i];
+        decoded_columns[i] = decoded[i];
+        for(int k=0; k<MESSAGE_CNT; k++)
+            column_data[i][k] = ((WORD_T)rand_r(&seed) << 32) ^ rand_r(&seed);
+    }
+    for(int k=0; k<MESSAGE_CNT; k++)
+        message_ptrs[k] = messages[MESSAGE_CNT - 1 - k];
+
+    message_layout_t layout;
+    assert_true(message_layout_init(&layout, fields, FIELD_CNT,
+        MESSAGE_SIZE) > 0);
+
+    bitter_pool_t* pool = bitter_pool_create(THREAD_CNT, 0);
+    assert_non_null(pool);
+
+    // Multi threaded functions must match the single threaded ones.
+    memset(expected, 0, sizeof(expected));
+    assert_int_equal(encode_columns(&layout, &expected[0][0], MESSAGE_CNT,
+        columns), MESSAGE_CNT);
+    memset(messages, 0, sizeof(messages));
+    assert_int_equal(encode_columns_mt(pool, &layout, &messages[0][0],
+        MESSAGE_CNT, columns), MESSAGE_CNT);
+    assert_memory_equal(messages, expected, sizeof(expected));
+
+    memset(decoded, 0, sizeof(decoded));
+    assert_int_equal(decode_columns_mt(pool, &layout, &messages[0][0],
+        MESSAGE_CNT, decoded_columns), MESSAGE_CNT);
+    for(int i=0; i<FIELD_CNT; i++) {
+        WORD_T mask = ((WORD_T)1 << fields[i].bit_len) - 1;
+        if(!fields[i].start_low)
+            mask = ~(~(WORD_T)0 >> fields[i].bit_len);
+        for(int k=0; k<MESSAGE_CNT; k++)
+            assert_int_equal(decoded[i][k], column_data[i][k] & mask);
+    }
+
+    // Pointer variants on messages in reverse order.
+    memset(messages, 0, sizeof(messages));
+    assert_int_equal(encode_columns_ptr_mt(pool, &layout, message_ptrs,
+        MESSAGE_CNT, columns), MESSAGE_CNT);
+    for(int k=0; k<MESSAGE_CNT; k++)
+        assert_memory_equal(message_ptrs[k], expected[k], sizeof(expected[k]));
+
+    static WORD_T decoded2[FIELD_CNT][MESSAGE_CNT];
+    WORD_T* decoded2_columns[FIELD_CNT];
+    for(int i=0; i<FIELD_CNT; i++)
+        decoded2_columns[i] = decoded2[i];
+    assert_int_equal(decode_columns_ptr_mt(pool, &layout,
+        (const WORD_T* const*)message_ptrs, MESSAGE_CNT, decoded2_columns),
+        MESSAGE_CNT);
+    assert_memory_equal(decoded, decoded2, sizeof(decoded));
+
+    assert_int_equal(encode_columns_mt(pool, &layout, NULL, MESSAGE_CNT,
+        columns), -1);
+
+    bitter_pool_destroy(pool);
+    message_layout_free(&layout);
+}
+
+void test_rand_in_range_r(void **state) {
+    unsigned int seed = 42;
+    unsigned int seed2 = 42;
+
+    // Same seed gives same sequence.
+    for(int i=0; i<1000; i++) {
+        int v = rand_in_range_r(&seed, -5, 5);
+        assert_in_range(v + 5, 0, 10);
+        assert_int_equal(v, rand_in_range_r(&seed2, -5, 5));
+    }
+}
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 32
+#define MESSAGE_BITS (MESSAGE_SIZE * WORD_BIT_LEN)
+#define ROUNDS       200
+
+// CCSDS attached sync marker.
+#define ASM          0x1ACFFC1D
+
+
+// Matches of pattern in the range by testing every position.
+static int64_t find_reference(WORD_T message[], int start_bit, int bit_len,
+                              WORD_T pattern, int pattern_len,
+                              int max_errors, int64_t positions[]) {
+    int64_t cnt = 0;
+    if(pattern_len < WORD_BIT_LEN)
+        pattern &= ((WORD_T)1 << pattern_len) - 1;
+    for(int i=start_bit; i+pattern_len<=start_bit+bit_len; i++) {
+        WORD_T v;
+        get_message_bits(message, MESSAGE_SIZE, i, pattern_len, &v, true);
+        if(__builtin_popcountll(v ^ pattern) <= max_errors)
+            positions[cnt++] = i;
+    }
+    return cnt;
+}
+
+
+void test_find(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    unsigned int seed = rand();
+
+    // Sync word planted at every alignment is found there.
+    for(int pos=0; pos<=MESSAGE_BITS-32; pos+=7) {
+        memset(message, 0, sizeof(message));
+        set_message_bits(message, MESSAGE_SIZE, pos, 32, ASM, true, true);
+        assert_int_equal(message_find(message, MESSAGE_SIZE, 0, MESSAGE_BITS,
+            ASM, 32, 0), pos);
+        // Not found if the range ends one bit too early.
+        assert_int_equal(message_find(message, MESSAGE_SIZE, 0, pos + 31,
+            ASM, 32, 0), -4);
+        if(pos + 1 < MESSAGE_BITS)
+            assert_int_equal(message_find(message, MESSAGE_SIZE, pos + 1,
+                MESSAGE_BITS - pos - 1, ASM, 32, 0), -4);
+    }
+
+    // HDLC flag with one bit error.
+    memset(message, 0, sizeof(message));
+    set_message_bits(message, MESSAGE_SIZE, 1000, 8, 0x7F, true, true);
+    assert_int_equal(message_find(message, MESSAGE_SIZE, 0, MESSAGE_BITS,
+        0x7E, 8, 0), -4);
+    assert_int_equal(message_find(message, MESSAGE_SIZE, 0, MESSAGE_BITS,
+        0x7E, 8, 1), 1000);
+
+    // First match of random patterns against the reference.
+    static int64_t expected[MESSAGE_BITS];
+    for(int round=0; round<ROUNDS; round++) {
+        fill_random(message, MESSAGE_SIZE, &seed);
+        int pattern_len = rand_in_range_r(&seed, 1, 64);
+        int max_errors = rand_in_range_r(&seed, 0, pattern_len / 4);
+        int start_bit = rand_in_range_r(&seed, 0, 300);
+        int bit_len = rand_in_range_r(&seed, 0, MESSAGE_BITS - start_bit);
+        int pos = rand_in_range_r(&seed, 0, MESSAGE_BITS - pattern_len);
+        WORD_T pattern;
+        get_message_bits(message, MESSAGE_SIZE, pos, pattern_len, &pattern,
+            true);
+
+        int64_t cnt = find_reference(message, start_bit, bit_len, pattern,
+            pattern_len, max_errors, expected);
+        dbg_printf("pattern_len(%d), max_errors(%d), matches(%ld)\n",
+            pattern_len, max_errors, cnt);
+        assert_int_equal(message_find(message, MESSAGE_SIZE, start_bit,
+            bit_len, pattern, pattern_len, max_errors),
+            (cnt > 0 ? expected[0] : -4));
+    }
+
+    assert_int_equal(message_find(message, MESSAGE_SIZE, -1, 8, 1, 1, 0), -1);
+    assert_int_equal(message_find(message, MESSAGE_SIZE, MESSAGE_BITS, 0,
+        1, 1, 0), -1);
+    assert_int_equal(message_find(message, MESSAGE_SIZE, 0, -1, 1, 1, 0), -2);
+    assert_int_equal(message_find(message, MESSAGE_SIZE, 0, 8, 1, 0, 0), -2);
+    assert_int_equal(message_find(message, MESSAGE_SIZE, 0, 8, 1, 65, 0), -2);
+    assert_int_equal(message_find(message, MESSAGE_SIZE, 0, 8, 1, 1, -1), -2);
+    assert_int_equal(message_find(message, MESSAGE_SIZE, 1, MESSAGE_BITS,
+        1, 1, 0), -3);
+}
+
+void test_find_all(void **state) {
+    WORD_T message[MESSAGE_SIZE];
+    static int64_t expected[MESSAGE_BITS];
+    static int64_t positions[MESSAGE_BITS];
+    unsigned int seed = rand();
+
+    // All matches, also overlapping ones, against the reference.
+    for(int round=0; round<ROUNDS; round++) {
+        fill_random(message, MESSAGE_SIZE, &seed);
+        int pattern_len = rand_in_range_r(&seed, 1, 64);
+        int max_errors = rand_in_range_r(&seed, 0, pattern_len / 2);
+        int start_bit = rand_in_range_r(&seed, 0, 300);
+        int bit_len = rand_in_range_r(&seed, 0, MESSAGE_BITS - start_bit);
+        WORD_T pattern = ((WORD_T)rand_r(&seed) << 32) ^ rand_r(&seed);
+
+        int64_t cnt = find_reference(message, start_bit, bit_len, pattern,
+            pattern_len, max_errors, expected);
+        assert_int_equal(message_find_all(message, MESSAGE_SIZE, start_bit,
+            bit_len, pattern, pattern_len, max_errors, positions,
+            MESSAGE_BITS), cnt);
+        for(int i=0; i<cnt; i++)
+            assert_int_equal(positions[i], expected[i]);
+        assert_int_equal(message_find_all(message, MESSAGE_SIZE, start_bit,
+            bit_len, pattern, pattern_len, max_errors, NULL, 0), cnt);
+    }
+
+    // Search stops when positions is full.
+    memset(message, 0x55, sizeof(message));
+    assert_int_equal(message_find_all(message, MESSAGE_SIZE, 0, MESSAGE_BITS,
+        0x5, 4, 0, NULL, 0), MESSAGE_BITS / 2 - 1);
+    assert_int_equal(message_find_all(message, MESSAGE_SIZE, 3, MESSAGE_BITS
+        - 3, 0x5, 4, 0, positions, 10), 10);
+    for(int i=0; i<10; i++)
+        assert_int_equal(positions[i], 4 + 2 * i);
+
+    // Negative size of positions, ignored when only counting.
+    assert_int_equal(message_find_all(message, MESSAGE_SIZE, 0, MESSAGE_BITS,
+        0x5, 4, 0, positions, -1), -2);
+    assert_int_equal(message_find_all(message, MESSAGE_SIZE, 0, MESSAGE_BITS,
+        0x5, 4, 0, NULL, -1), MESSAGE_BITS / 2 - 1);
+
+    // Every position matches if all bits may differ.
+    assert_int_equal(message_find_all(message, MESSAGE_SIZE, 0, 100,
+        0, 64, 64, NULL, 0), 37);
+}
+
+void test_find_bitstream(void **state) {
+    bitstream_t bs;
+    int64_t positions[4];
+    const int64_t bit_len = 1000003;
+
+    assert_int_equal(bitstream_create(&bs, NULL, bit_len), 0);
+    bitstream_set_bits(&bs, 12345, 32, ASM, true, true);
+    bitstream_set_bits(&bs, bit_len - 32, 32, ASM, true, true);
+
+    assert_int_equal(bitstream_find(&bs, 0, bit_len, ASM, 32, 0), 12345);
+    assert_int_equal(bitstream_find(&bs, 12346, bit_len - 12346, ASM, 32,
+        0), bit_len - 32);
+    assert_int_equal(bitstream_find_all(&bs, 0, bit_len, ASM, 32, 0,
+        positions, 4), 2);
+    assert_int_equal(positions[0], 12345);
+    assert_int_equal(positions[1], bit_len - 32);
+    assert_int_equal(bitstream_find_all(&bs, 0, bit_len, ASM, 32, 0,
+        positions, -4), -2);
+
+    // Bits after the end of stream are not searched.
+    assert_int_equal(bitstream_find(&bs, 0, bit_len + 1, ASM, 32, 0), -3);
+    assert_int_equal(bitstream_find(&bs, bit_len, 0, ASM, 32, 0), -1);
+    bitstream_close(&bs);
+}
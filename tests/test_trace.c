@@ -0,0 +1,365 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <cmocka.h>
+
+#include "bitter.h"
+
+
+// Define MESSAGE_DEBUG here to print debug output with dbg_printf.
+//#define MESSAGE_DEBUG
+#ifdef MESSAGE_DEBUG
+    #define dbg_printf(...)  printf(__VA_ARGS__)
+#else
+    #define dbg_printf(...)
+#endif
+
+
+#define MESSAGE_SIZE 4
+#define THREAD_CNT   4
+#define THREAD_CALLS 1000
+
+
+static bitter_trace_event_t events[THREAD_CNT * BITTER_TRACE_EVENTS];
+
+
+static void check_event(const bitter_trace_event_t* e, int function,
+                        int64_t start_bit, int64_t bit_len, int64_t result,
+                        bool crossing) {
+    dbg_printf("%-22s start(%3ld), bits(%3ld), result(%4ld), flags(%x)\n",
+        bitter_trace_name(e->function), e->start_bit, e->bit_len, e->result,
+        e->flags);
+    assert_int_equal(e->function, function);
+    assert_int_equal(e->start_bit, start_bit);
+    assert_int_equal(e->bit_len, bit_len);
+    assert_int_equal(e->result, result);
+    assert_int_equal(e->flags & BITTER_TRACE_CROSSING,
+                     (crossing ? BITTER_TRACE_CROSSING : 0));
+    assert_int_equal(e->thread, (uint32_t)syscall(SYS_gettid));
+}
+
+void test_trace_events(void **state) {
+    WORD_T message[MESSAGE_SIZE] = {0};
+    WORD_T value[2] = {0};
+    uint8_t bytes[16] = {0};
+    WORD_T v;
+
+    // Nothing is recorded while tracing is disabled.
+    bitter_trace_enable(false);
+    bitter_trace_clear();
+    set_message_bits(message, MESSAGE_SIZE, 0, 8, 0xab, true, true);
+    assert_false(bitter_trace_enabled());
+    assert_int_equal(bitter_trace_snapshot(events, BITTER_TRACE_EVENTS), 0);
+
+    bitter_trace_enable(true);
+    assert_true(bitter_trace_enabled());
+    set_message_bits(message, MESSAGE_SIZE, 60, 8, 0xab, true, true);
+    get_message_bits(message, MESSAGE_SIZE, 60, 8, &v, true);
+    set_message_bits(message, MESSAGE_SIZE, 250, 8, 0xab, true, true);
+    get_message_bits2(message, MESSAGE_SIZE, 10, 100, value, 2);
+    set_message_bits3(message, MESSAGE_SIZE, 200, 80, bytes, 16, true);
+    set_message_bits_h(message, MESSAGE_SIZE, 0, 4, 1, true, true);
+    get_message_bits_le(message, MESSAGE_SIZE, 300, 4, &v, true);
+    bitter_trace_enable(false);
+    set_message_bits(message, MESSAGE_SIZE, 0, 8, 0xab, true, true);
+
+    int cnt = bitter_trace_snapshot(events, BITTER_TRACE_EVENTS);
+    assert_int_equal(cnt, 7);
+    check_event(&events[0], BITTER_TRACE_SET_BITS, 60, 8, 68, true);
+    check_event(&events[1], BITTER_TRACE_GET_BITS, 60, 8, 68, true);
+    check_event(&events[2], BITTER_TRACE_SET_BITS, 250, 8, -3, true);
+    check_event(&events[3], BITTER_TRACE_GET_BITS2, 10, 100, 110, true);
+    check_event(&events[4], BITTER_TRACE_SET_BITS3, 200, 80, -300, true);
+    check_event(&events[5], BITTER_TRACE_SET_BITS_H, 0, 4, 4, false);
+    check_event(&events[6], BITTER_TRACE_GET_BITS_LE, 300, 4, -1, false);
+    for(int i=1; i<cnt; i++)
+        assert_true(events[i].time_ns >= events[i - 1].time_ns);
+
+    // Only the most recent events if the array is too short.
+    assert_int_equal(bitter_trace_snapshot(events, 2), 2);
+    check_event(&events[1], BITTER_TRACE_GET_BITS_LE, 300, 4, -1, false);
+
+    assert_string_equal(bitter_trace_name(BITTER_TRACE_GET_BITS3_LE),
+                        "get_message_bits3_le");
+    assert_string_equal(bitter_trace_name(BITTER_TRACE_GET_BITS3_H),
+                        "get_message_bits3_h");
+    assert_string_equal(bitter_trace_name(BITTER_TRACE_FUNCTIONS - 1),
+                        "bitstream_find_all");
+    assert_null(bitter_trace_name(0));
+    assert_null(bitter_trace_name(BITTER_TRACE_FUNCTIONS));
+
+    bitter_trace_clear();
+    assert_int_equal(bitter_trace_snapshot(events, BITTER_TRACE_EVENTS), 0);
+    assert_int_equal(bitter_trace_snapshot(NULL, 1), -1);
+}
+
+
+static pthread_barrier_t barrier;
+
+static void* trace_thread(void* arg) {
+    WORD_T message[MESSAGE_SIZE] = {0};
+    int n = *(int*)arg;
+    for(int i=0; i<n; i++)
+        set_message_bits(message, MESSAGE_SIZE, i % 200, 7, i, true, true);
+    return NULL;
+}
+
+// Keeps all threads alive until all are done, the ring of an exited thread
+// is taken over by the next thread.
+static void* trace_thread_wait(void* arg) {
+    pthread_barrier_wait(&barrier);
+    trace_thread(arg);
+    pthread_barrier_wait(&barrier);
+    return NULL;
+}
+
+void test_trace_threads(void **state) {
+    pthread_t threads[THREAD_CNT];
+    int calls[THREAD_CNT];
+
+    bitter_trace_clear();
+    bitter_trace_enable(true);
+    pthread_barrier_init(&barrier, NULL, THREAD_CNT);
+    for(int t=0; t<THREAD_CNT; t++) {
+        calls[t] = THREAD_CALLS * (t + 1);
+        assert_int_equal(pthread_create(&threads[t], NULL, trace_thread_wait,
+                                        &calls[t]), 0);
+    }
+    for(int t=0; t<THREAD_CNT; t++)
+        pthread_join(threads[t], NULL);
+    pthread_barrier_destroy(&barrier);
+
+    int cnt = bitter_trace_snapshot(events, THREAD_CNT * BITTER_TRACE_EVENTS);
+    assert_int_equal(cnt, THREAD_CALLS * (1 + 2 + 3 + 4));
+
+    // Events of each thread are complete and in order.
+    uint32_t thread_ids[THREAD_CNT];
+    int thread_events[THREAD_CNT] = {0};
+    int thread_cnt = 0;
+    for(int k=0; k<cnt; k++) {
+        int t = 0;
+        while(t < thread_cnt && thread_ids[t] != events[k].thread)
+            t++;
+        if(t == thread_cnt) {
+            assert_true(thread_cnt < THREAD_CNT);
+            thread_ids[thread_cnt++] = events[k].thread;
+        }
+        assert_int_equal(events[k].function, BITTER_TRACE_SET_BITS);
+        assert_int_equal(events[k].start_bit, thread_events[t] % 200);
+        thread_events[t]++;
+    }
+    assert_int_equal(thread_cnt, THREAD_CNT);
+    for(int t=0; t<THREAD_CNT; t++) {
+        dbg_printf("thread %u: %d events\n", thread_ids[t], thread_events[t]);
+        assert_int_equal(thread_events[t] % THREAD_CALLS, 0);
+    }
+
+    // A ring keeps the most recent BITTER_TRACE_EVENTS events.
+    bitter_trace_clear();
+    int n = BITTER_TRACE_EVENTS + 100;
+    pthread_create(&threads[0], NULL, trace_thread, &n);
+    pthread_join(threads[0], NULL);
+    bitter_trace_enable(false);
+    cnt = bitter_trace_snapshot(events, THREAD_CNT * BITTER_TRACE_EVENTS);
+    assert_int_equal(cnt, BITTER_TRACE_EVENTS);
+    assert_int_equal(events[0].start_bit, 100 % 200);
+    assert_int_equal(events[cnt - 1].start_bit, (n - 1) % 200);
+    bitter_trace_clear();
+}
+
+
+void test_trace_write(void **state) {
+    WORD_T message[MESSAGE_SIZE] = {0};
+    char path[] = "/tmp/bitter_trace_XXXXXX";
+    int fd = mkstemp(path);
+    assert_true(fd >= 0);
+    close(fd);
+
+    bitter_trace_clear();
+    bitter_trace_enable(true);
+    for(int i=0; i<10; i++)
+        set_message_bits(message, MESSAGE_SIZE, i * 20, 20, i, true, true);
+    bitter_trace_enable(false);
+    assert_int_equal(bitter_trace_write(path), 10);
+
+    // Header, then the events as returned by bitter_trace_snapshot.
+    struct {
+        char magic[4];
+        uint16_t version;
+        uint16_t event_size;
+        uint32_t word_bit_len;
+        uint32_t event_cnt;
+    } header;
+    bitter_trace_event_t e[10];
+    FILE* f = fopen(path, "rb");
+    assert_non_null(f);
+    assert_int_equal(fread(&header, sizeof(header), 1, f), 1);
+    assert_int_equal(fread(e, sizeof(e[0]), 10, f), 10);
+    assert_int_equal(fread(e, 1, 1, f), 0);
+    fclose(f);
+    unlink(path);
+
+    assert_memory_equal(header.magic, "BTRC", 4);
+    assert_int_equal(header.version, 1);
+    assert_int_equal(header.event_size, sizeof(bitter_trace_event_t));
+    assert_int_equal(header.word_bit_len, WORD_BIT_LEN);
+    assert_int_equal(header.event_cnt, 10);
+    for(int i=0; i<10; i++)
+        check_event(&e[i], BITTER_TRACE_SET_BITS, i * 20, 20, i * 20 + 20,
+                    (i * 20) % WORD_BIT_LEN + 20 > WORD_BIT_LEN);
+
+    assert_int_equal(bitter_trace_write("/nonexistent/trace"), -6);
+    assert_int_equal(bitter_trace_write(NULL), -1);
+    bitter_trace_clear();
+}
+
+
+void test_trace_entry_points(void **state) {
+    WORD_T message[MESSAGE_SIZE] = {0};
+    uint8_t buffer[MESSAGE_SIZE * WORD_BYTE_LEN] = {0};
+    bit_writer_t writer;
+    bitstream_t bs;
+
+    bitter_trace_clear();
+    bitter_trace_enable(true);
+    set_buffer_bits(buffer, sizeof(buffer), 60, 8, 0xab, true, true);
+    bit_writer_init(&writer, message, MESSAGE_SIZE, 0);
+    bit_writer_put(&writer, 12, 0xabc, true);
+    bit_writer_flush(&writer);
+    copy_message_bits(message, MESSAGE_SIZE, 10, message, MESSAGE_SIZE, 100,
+                      20);
+    insert_message_bits(message, MESSAGE_SIZE, 8, 16);
+    clear_message_bits(message, MESSAGE_SIZE, 0, 8);
+    message_finalize(message, MESSAGE_SIZE);
+    assert_int_equal(bitstream_create(&bs, NULL, 256), 0);
+    bitstream_set_bits(&bs, 0, 8, 1, true, true);
+    bitter_trace_enable(false);
+    bitstream_close(&bs);
+
+    // Entry points built on other ones are recorded only once.
+    int cnt = bitter_trace_snapshot(events, BITTER_TRACE_EVENTS);
+    assert_int_equal(cnt, 8);
+    check_event(&events[0], BITTER_TRACE_SET_BUFFER_BITS, 60, 8, 68, true);
+    check_event(&events[1], BITTER_TRACE_BIT_WRITER_PUT, 0, 12, 12, false);
+    check_event(&events[2], BITTER_TRACE_BIT_WRITER_FLUSH, 0, 12, 12, false);
+    check_event(&events[3], BITTER_TRACE_COPY_BITS, 10, 20, 30, false);
+    check_event(&events[4], BITTER_TRACE_INSERT_BITS, 8, 16, 24, false);
+    check_event(&events[5], BITTER_TRACE_CLEAR_BITS, 0, 8, 8, false);
+    check_event(&events[6], BITTER_TRACE_MESSAGE_FINALIZE, -1,
+                MESSAGE_SIZE * WORD_BIT_LEN, 0, false);
+    check_event(&events[7], BITTER_TRACE_BITSTREAM_SET_BITS, 0, 8, 8, false);
+    bitter_trace_clear();
+}
+
+void test_trace_stats(void **state) {
+    WORD_T message[MESSAGE_SIZE] = {0};
+    WORD_T value[MESSAGE_SIZE] = {0};
+    uint8_t bytes[MESSAGE_SIZE * WORD_BYTE_LEN] = {0};
+    bitter_stats_t stats[BITTER_TRACE_FUNCTIONS];
+    WORD_T v;
+
+    // Nothing is counted while statistics are disabled.
+    bitter_stats_enable(false);
+    bitter_stats_clear();
+    set_message_bits(message, MESSAGE_SIZE, 0, 8, 0xab, true, true);
+    assert_false(bitter_stats_enabled());
+    assert_true(bitter_stats_snapshot(stats) >= 1);
+    assert_int_equal(stats[0].calls, 0);
+
+    bitter_stats_enable(true);
+    assert_true(bitter_stats_enabled());
+    assert_false(bitter_trace_enabled());
+    for(int i=0; i<100; i++)
+        set_message_bits(message, MESSAGE_SIZE, i, 8, i, true, true);
+    get_message_bits(message, MESSAGE_SIZE, 60, 8, &v, true);
+    get_message_bits(message, MESSAGE_SIZE, -1, 8, &v, true);
+    get_message_bits(message, MESSAGE_SIZE, 0, 65, &v, true);
+    get_message_bits(message, MESSAGE_SIZE, 250, 8, &v, true);
+    set_message_bits2(message, MESSAGE_SIZE, 10, 100, value, 2, true);
+    set_message_bits2(message, MESSAGE_SIZE, 200, 100, value, 2, true);
+    get_message_bits3(message, MESSAGE_SIZE, 0, 200, bytes, sizeof(bytes));
+    get_message_bits3(message, MESSAGE_SIZE, 100, 200, bytes, sizeof(bytes));
+    set_message_bits_le(message, MESSAGE_SIZE, 8, 0, 0, true, true);
+
+    // Calls of other threads are merged.
+    pthread_t thread;
+    int n = 50;
+    pthread_create(&thread, NULL, trace_thread, &n);
+    pthread_join(thread, NULL);
+    bitter_stats_enable(false);
+    get_message_bits(message, MESSAGE_SIZE, 0, 8, &v, true);
+
+    assert_true(bitter_stats_snapshot(stats) >= 2);
+    const bitter_stats_t* s = &stats[BITTER_TRACE_SET_BITS];
+    assert_int_equal(s->calls, 150);
+    // Only the 8 bit fields starting at 57 to 63 cross a word boundary.
+    assert_int_equal(s->crossing, 7);
+    assert_int_equal(s->bit_lens[8], 100);
+    assert_int_equal(s->bit_lens[7], 50);
+
+    s = &stats[BITTER_TRACE_GET_BITS];
+    assert_int_equal(s->calls, 4);
+    assert_int_equal(s->crossing, 3);
+    assert_int_equal(s->errors[0], 1);      // -1
+    assert_int_equal(s->errors[1], 1);      // -2
+    assert_int_equal(s->errors[2], 1);      // -3
+    assert_int_equal(s->bit_lens[8], 3);
+    assert_int_equal(s->bit_lens[WORD_BIT_LEN + 1], 1);
+
+    s = &stats[BITTER_TRACE_SET_BITS2];
+    assert_int_equal(s->calls, 2);
+    assert_int_equal(s->errors[5], 1);      // -30
+    assert_int_equal(s->bit_lens[WORD_BIT_LEN + 1], 2);
+
+    s = &stats[BITTER_TRACE_GET_BITS3];
+    assert_int_equal(s->calls, 2);
+    assert_int_equal(s->errors[8], 1);      // -300
+    assert_int_equal(s->bit_lens[WORD_BIT_LEN + 2], 2);
+
+    s = &stats[BITTER_TRACE_SET_BITS_LE];
+    assert_int_equal(s->calls, 1);
+    assert_int_equal(s->crossing, 0);
+    assert_int_equal(s->bit_lens[0], 1);
+
+    // stats[0] sums all functions.
+    assert_int_equal(stats[0].calls, 150 + 4 + 2 + 2 + 1);
+    assert_int_equal(stats[0].errors[0] + stats[0].errors[1] +
+                     stats[0].errors[2] + stats[0].errors[5] +
+                     stats[0].errors[8], 5);
+
+    assert_int_equal(bitter_stats_error_code(0), -1);
+    assert_int_equal(bitter_stats_error_code(5), -30);
+    assert_int_equal(bitter_stats_error_code(BITTER_STATS_ERRORS - 1), 0);
+    assert_int_equal(bitter_stats_bit_len(13), 13);
+    assert_int_equal(bitter_stats_bit_len(WORD_BIT_LEN + 1),
+                     2 * WORD_BIT_LEN);
+    assert_int_equal(bitter_stats_bit_len(WORD_BIT_LEN + 2),
+                     4 * WORD_BIT_LEN);
+    assert_true(bitter_stats_bit_len(BITTER_STATS_BIT_LENS - 1) == INT64_MAX);
+
+    char* json = NULL;
+    size_t json_len = 0;
+    FILE* f = open_memstream(&json, &json_len);
+    assert_int_equal(bitter_stats_write(f), 5);
+    fclose(f);
+    dbg_printf("%s", json);
+    assert_non_null(strstr(json, "{\"function\": \"set_message_bits\", "
+                                 "\"calls\": 150, \"crossing\": 7,"));
+    assert_non_null(strstr(json, "\"errors\": {\"-1\": 1, \"-2\": 1, "
+                                 "\"-3\": 1}"));
+    assert_non_null(strstr(json, "\"bit_len\": {\"7\": 50, \"8\": 100}"));
+    free(json);
+
+    bitter_stats_clear();
+    bitter_stats_snapshot(stats);
+    assert_int_equal(stats[0].calls, 0);
+    assert_int_equal(stats[BITTER_TRACE_SET_BITS].bit_lens[8], 0);
+    assert_int_equal(bitter_stats_snapshot(NULL), -1);
+}
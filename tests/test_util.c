@@ -0,0 +1,29 @@
+/// @file test_util.c
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bitter.h"
+#include "test_util.h"
+
+
+WORD_T rand_word(void) {
+    WORD_T v = 0;
+    for(int i=0; i<WORD_BYTE_LEN; i++)
+        v = (v << 8) | rand_in_range(0, 255);
+    return v;
+}
+
+int ref_bit(const void* buffer, int pos) {
+    return (((const uint8_t*)buffer)[pos / 8] >> (7 - pos % 8)) & 1;
+}
+
+int ref_bit_le(const void* buffer, int pos) {
+    return (((const uint8_t*)buffer)[pos / 8] >> (pos % 8)) & 1;
+}
+
+void fill_random(WORD_T message[], int message_len, unsigned int* seed) {
+    for(int i=0; i<message_len; i++)
+        message[i] = ((WORD_T)rand_r(seed) << 40) ^
+                     ((WORD_T)rand_r(seed) << 20) ^ rand_r(seed);
+}
@@ -0,0 +1,30 @@
+/// @file test_util.h
+/// Helpers shared by the test files.
+
+#ifndef _TEST_UTIL_H_
+#define _TEST_UTIL_H_
+
+#include "bitter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Random word with all bits random (rand_in_range only returns 31 bits).
+extern WORD_T rand_word(void);
+
+// Bit pos of a byte buffer, counted from the MSB of byte 0.
+extern int ref_bit(const void* buffer, int pos);
+
+// Bit pos of a byte buffer, counted from the LSB of byte 0.
+extern int ref_bit_le(const void* buffer, int pos);
+
+// Fills message_len words of message with random bits from seed.
+extern void fill_random(WORD_T message[], int message_len,
+                        unsigned int* seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,515 @@
+#!/usr/bin/env python3
+"""bitgen - generates specialized pack/unpack functions for bitter messages.
+
+Reads a layout file describing one or more messages and writes
+
+    <base>.h        C pack/unpack functions (static inline)
+    <base>.hpp      C++ structs with pack/unpack member functions
+    <base>_test.c   Round trip test comparing the generated code with
+                    set_message_bits/get_message_bits of libbitter
+
+Layout file syntax, one statement per line, '#' starts a comment:
+
+    message <name>              Starts a message
+    order msb|lsb               Bit order, msb (default) for network order
+                                messages, lsb for LSB-first messages as used
+                                by the _le functions
+    words <n>                   Message length in words, default is the
+                                minimum number of words holding all fields
+    field <name> <width>        Field of 1-64 bits
+    const <name> <width> <val>  Field with a constant value, checked when
+                                unpacking
+    pad <width>                 Unused bits, packed as 0
+
+Fields are placed one after the other in the order given. Fields sharing a
+message word are packed into and unpacked from a single word value, every
+message word is loaded or stored once. Since positions and sizes are fixed
+no runtime bounds checks are needed.
+
+Usage: bitgen.py <layout file> [-o <output dir>] [-b <base name>]
+"""
+
+import argparse
+import os
+import re
+import sys
+
+
+WORD_BIT_LEN = 64
+
+
+class LayoutError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, name, start, width, const=None, pad=False):
+        self.name = name
+        self.start = start
+        self.width = width
+        self.const = const
+        self.pad = pad
+
+    def c_type(self):
+        for bits in (8, 16, 32):
+            if self.width <= bits:
+                return "uint%d_t" % bits
+        return "uint64_t"
+
+
+class Message:
+    def __init__(self, name):
+        self.name = name
+        self.order = "msb"
+        self.words = None
+        self.fields = []
+        self.end = 0
+
+    def word_len(self):
+        return self.words if self.words is not None else \
+            (self.end + WORD_BIT_LEN - 1) // WORD_BIT_LEN
+
+    def members(self):
+        return [f for f in self.fields if not f.pad and f.const is None]
+
+
+IDENT = re.compile(r"^[A-Za-z_][A-Za-z0-9_]*$")
+
+
+def parse_int(text, line_no):
+    try:
+        return int(text, 0)
+    except ValueError:
+        raise LayoutError("line %d: invalid number '%s'" % (line_no, text))
+
+
+def parse_layout(text):
+    messages = []
+    msg = None
+    for line_no, line in enumerate(text.splitlines(), 1):
+        tokens = line.split("#", 1)[0].split()
+        if not tokens:
+            continue
+        kw, args = tokens[0], tokens[1:]
+
+        if kw == "message":
+            if len(args) != 1 or not IDENT.match(args[0]):
+                raise LayoutError("line %d: expected message <name>" % line_no)
+            msg = Message(args[0])
+            messages.append(msg)
+            continue
+        if msg is None:
+            raise LayoutError("line %d: '%s' outside of message" %
+                              (line_no, kw))
+
+        if kw == "order":
+            if len(args) != 1 or args[0] not in ("msb", "lsb"):
+                raise LayoutError("line %d: expected order msb|lsb" % line_no)
+            msg.order = args[0]
+        elif kw == "words":
+            if len(args) != 1:
+                raise LayoutError("line %d: expected words <n>" % line_no)
+            msg.words = parse_int(args[0], line_no)
+        elif kw in ("field", "const", "pad"):
+            nargs = {"field": 2, "const": 3, "pad": 1}[kw]
+            if len(args) != nargs:
+                raise LayoutError("line %d: wrong number of arguments for %s" %
+                                  (line_no, kw))
+            if kw == "pad":
+                name, width = "pad%d" % msg.end, parse_int(args[0], line_no)
+            else:
+                name, width = args[0], parse_int(args[1], line_no)
+                if not IDENT.match(name):
+                    raise LayoutError("line %d: invalid field name '%s'" %
+                                      (line_no, name))
+                if any(f.name == name for f in msg.fields):
+                    raise LayoutError("line %d: duplicate field '%s'" %
+                                      (line_no, name))
+            if width < 1 or width > WORD_BIT_LEN:
+                raise LayoutError("line %d: width must be 1-%d bits" %
+                                  (line_no, WORD_BIT_LEN))
+            const = None
+            if kw == "const":
+                const = parse_int(args[2], line_no)
+                if const < 0 or const >= (1 << width):
+                    raise LayoutError("line %d: constant does not fit into "
+                                      "%d bits" % (line_no, width))
+            msg.fields.append(Field(name, msg.end, width, const, kw == "pad"))
+            msg.end += width
+        else:
+            raise LayoutError("line %d: unknown statement '%s'" %
+                              (line_no, kw))
+
+    for msg in messages:
+        if msg.words is not None and msg.words * WORD_BIT_LEN < msg.end:
+            raise LayoutError("message %s: %d bits do not fit into %d words" %
+                              (msg.name, msg.end, msg.words))
+        if msg.end == 0:
+            raise LayoutError("message %s has no fields" % msg.name)
+    return messages
+
+
+def mask(n):
+    return (1 << n) - 1
+
+
+def parts(msg, field):
+    """Splits a field into its parts in each message word.
+
+    Yields (word, value_shift, part_width, word_shift): the part is
+    (value >> value_shift) & mask(part_width) stored at word_shift of the
+    message word in host-byte-order.
+    """
+    s, e = field.start, field.start + field.width
+    for k in range(s // WORD_BIT_LEN, (e - 1) // WORD_BIT_LEN + 1):
+        ps = max(s, k * WORD_BIT_LEN)
+        pe = min(e, (k + 1) * WORD_BIT_LEN)
+        width = pe - ps
+        if msg.order == "msb":
+            ws = WORD_BIT_LEN - (ps - k * WORD_BIT_LEN) - width
+            yield k, e - pe, width, ws
+        else:
+            yield k, ps - s, width, ps - k * WORD_BIT_LEN
+
+
+def shifted(expr, shift, left):
+    if shift == 0:
+        return expr
+    return "(%s %s %d)" % (expr, "<<" if left else ">>", shift)
+
+
+def masked(expr, width):
+    if width == WORD_BIT_LEN:
+        return expr
+    return "(%s & 0x%xULL)" % (expr, mask(width))
+
+
+def pack_words(msg, value_of):
+    """Expression of each message word in host-byte-order."""
+    words = [[] for _ in range(msg.word_len())]
+    for f in msg.fields:
+        if f.pad:
+            continue
+        for k, vs, width, ws in parts(msg, f):
+            if f.const is not None:
+                c = ((f.const >> vs) & mask(width)) << ws
+                if c:
+                    words[k].append("0x%xULL" % c)
+            else:
+                v = shifted("(WORD_T)" + value_of(f), vs, False)
+                # Bits above the part are shifted out of the word.
+                if ws + width < WORD_BIT_LEN:
+                    v = masked(v, width)
+                words[k].append(shifted(v, ws, True))
+    return [" |\n            ".join(w) if w else "0" for w in words]
+
+
+def unpack_field(msg, field, word_of):
+    """Expression of a field value from the message words."""
+    terms = []
+    for k, vs, width, ws in parts(msg, field):
+        t = shifted(word_of(k), ws, False)
+        # Bits above the part are shifted out already.
+        if ws + width < WORD_BIT_LEN:
+            t = masked(t, width)
+        terms.append(shifted(t, vs, True))
+    return " | ".join(terms)
+
+
+def const_checks(msg, word_of):
+    checks = []
+    for f in msg.fields:
+        if f.const is not None:
+            checks.append("(%s) != 0x%xULL" %
+                          (unpack_field(msg, f, word_of), f.const))
+    return checks
+
+
+def bit_range(field):
+    if field.width == 1:
+        return "bit %d" % field.start
+    return "bits %d-%d" % (field.start, field.start + field.width - 1)
+
+
+def word_count(msg):
+    n = msg.word_len()
+    return "%d word%s" % (n, "" if n == 1 else "s")
+
+
+def byte_order(msg):
+    return "BITTER_NETWORK" if msg.order == "msb" else "BITTER_LE"
+
+
+def used_words(msg):
+    used = set()
+    for f in msg.fields:
+        if not f.pad:
+            for k, _, _, _ in parts(msg, f):
+                used.add(k)
+    return sorted(used)
+
+
+def gen_c(messages, base):
+    guard = "_%s_H_" % re.sub(r"\W", "_", base).upper()
+    out = []
+    out.append("/// @file %s.h" % base)
+    out.append("/// Generated by bitgen.py, do not edit.")
+    out.append("")
+    out.append("#ifndef %s" % guard)
+    out.append("#define %s" % guard)
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append('#include "bitter.h"')
+    out.append('#include "bitter_inline.h"')
+    out.append("")
+    out.append("#if WORD_BIT_LEN != %d" % WORD_BIT_LEN)
+    out.append('#error "generated for %d bit words"' % WORD_BIT_LEN)
+    out.append("#endif")
+
+    for msg in messages:
+        n = msg.name
+        order = byte_order(msg)
+        out.append("")
+        out.append("")
+        out.append("// Message %s, %d bits in %s, %s first." %
+                   (n, msg.end, word_count(msg), msg.order.upper()))
+        out.append("#define %s_WORDS %d" % (n.upper(), msg.word_len()))
+        out.append("")
+        out.append("typedef struct {")
+        decls = ["%s %s;" % (f.c_type(), f.name) for f in msg.members()]
+        col = max([len(d) for d in decls] + [20]) + 1
+        for f, d in zip(msg.members(), decls):
+            out.append("    %s// %s" % (d.ljust(col), bit_range(f)))
+        if not msg.members():
+            out.append("    uint8_t unused;")
+        out.append("} %s_t;" % n)
+
+        words = pack_words(msg, lambda f: "v->" + f.name)
+        out.append("")
+        out.append("// Packs all fields of v into message, bits not covered by "
+                   "a field are 0.")
+        out.append("static inline void %s_pack(WORD_T message[%s_WORDS],"
+                   % (n, n.upper()))
+        out.append("        const %s_t* v) {" % n)
+        for k, w in enumerate(words):
+            out.append("    message[%d] = bitter_conv(%s, %s);" % (k, w, order))
+        out.append("}")
+
+        out.append("")
+        out.append("// Unpacks all fields of message into v. Returns 0, or -1 "
+                   "if a constant")
+        out.append("// field does not have its value.")
+        out.append("static inline int %s_unpack(const WORD_T message[%s_WORDS],"
+                   % (n, n.upper()))
+        out.append("        %s_t* v) {" % n)
+        for k in used_words(msg):
+            out.append("    WORD_T w%d = bitter_conv(message[%d], %s);" %
+                       (k, k, order))
+        for f in msg.members():
+            out.append("    v->%s = %s;" %
+                       (f.name, unpack_field(msg, f, lambda k: "w%d" % k)))
+        checks = const_checks(msg, lambda k: "w%d" % k)
+        if checks:
+            out.append("    if(%s)" % " ||\n       ".join(checks))
+            out.append("        return -1;")
+        if not msg.members() and not checks:
+            out.append("    (void)message;")
+            out.append("    (void)v;")
+        out.append("    return 0;")
+        out.append("}")
+
+    out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+def gen_cpp(messages, base):
+    guard = "_%s_HPP_" % re.sub(r"\W", "_", base).upper()
+    out = []
+    out.append("/// @file %s.hpp" % base)
+    out.append("/// Generated by bitgen.py, do not edit.")
+    out.append("")
+    out.append("#ifndef %s" % guard)
+    out.append("#define %s" % guard)
+    out.append("")
+    out.append("#include <cstdint>")
+    out.append("")
+    out.append('#include "bitter.h"')
+    out.append('#include "bitter_inline.h"')
+    out.append("")
+    out.append("static_assert(WORD_BIT_LEN == %d, \"generated for %d bit "
+               "words\");" % (WORD_BIT_LEN, WORD_BIT_LEN))
+    out.append("")
+    out.append("namespace bitgen {")
+
+    for msg in messages:
+        n = msg.name
+        order = byte_order(msg)
+        out.append("")
+        out.append("// Message %s, %d bits in %s, %s first." %
+                   (n, msg.end, word_count(msg), msg.order.upper()))
+        out.append("struct %s {" % n)
+        out.append("    static constexpr int words = %d;" % msg.word_len())
+        out.append("")
+        for f in msg.members():
+            out.append("    %s %s = 0;" % (f.c_type(), f.name))
+        out.append("")
+
+        words = pack_words(msg, lambda f: f.name)
+        out.append("    void pack(WORD_T (&message)[words]) const {")
+        for k, w in enumerate(words):
+            w = w.replace("\n            ", "\n                ")
+            out.append("        message[%d] = bitter_conv(%s, %s);" %
+                       (k, w, order))
+        out.append("    }")
+        out.append("")
+
+        out.append("    bool unpack(const WORD_T (&message)[words]) {")
+        for k in used_words(msg):
+            out.append("        WORD_T w%d = bitter_conv(message[%d], %s);" %
+                       (k, k, order))
+        for f in msg.members():
+            out.append("        %s = %s;" %
+                       (f.name, unpack_field(msg, f, lambda k: "w%d" % k)))
+        checks = const_checks(msg, lambda k: "w%d" % k)
+        if checks:
+            out.append("        return !(%s);" %
+                       " ||\n                 ".join(checks))
+        else:
+            out.append("        (void)message;")
+            out.append("        return true;")
+        out.append("    }")
+        out.append("};")
+
+    out.append("")
+    out.append("} // namespace bitgen")
+    out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+def gen_test(messages, base):
+    out = []
+    out.append("/// @file %s_test.c" % base)
+    out.append("/// Generated by bitgen.py, do not edit.")
+    out.append("/// Round trip test of the generated pack/unpack functions "
+               "against")
+    out.append("/// set_message_bits/get_message_bits, link with -lbitter.")
+    out.append("")
+    out.append("#include <stdlib.h>")
+    out.append("#include <stdio.h>")
+    out.append("#include <string.h>")
+    out.append("")
+    out.append('#include "%s.h"' % base)
+    out.append("")
+    out.append("")
+    out.append("#define ROUNDS 10000")
+    out.append("")
+    out.append("static WORD_T rand_word(void) {")
+    out.append("    WORD_T v = 0;")
+    out.append("    for(unsigned i=0; i<WORD_BYTE_LEN; i++)")
+    out.append("        v = (v << 8) | rand_in_range(0, 255);")
+    out.append("    return v;")
+    out.append("}")
+
+    for msg in messages:
+        n = msg.name
+        suffix = "" if msg.order == "msb" else "_le"
+        nw = "%s_WORDS" % n.upper()
+        out.append("")
+        out.append("static int test_%s(void) {" % n)
+        out.append("    WORD_T message[%s];" % nw)
+        out.append("    WORD_T ref[%s];" % nw)
+        out.append("    %s_t v, v2;" % n)
+        out.append("    WORD_T x;")
+        out.append("")
+        out.append("    for(int r=0; r<ROUNDS; r++) {")
+        for f in msg.members():
+            out.append("        v.%s = rand_word() & 0x%xULL;" %
+                       (f.name, mask(f.width)))
+        out.append("        for(int i=0; i<%s; i++)" % nw)
+        out.append("            message[i] = rand_word();")
+        out.append("        memset(ref, 0, sizeof(ref));")
+        for f in msg.fields:
+            if f.pad:
+                continue
+            val = "v.%s" % f.name if f.const is None else "0x%xULL" % f.const
+            out.append("        set_message_bits%s(ref, %s, %d, %d, %s, "
+                       "true, true);" % (suffix, nw, f.start, f.width, val))
+        out.append("")
+        out.append("        %s_pack(message, &v);" % n)
+        out.append("        if(memcmp(message, ref, sizeof(ref)) != 0) {")
+        out.append('            printf("%s: pack differs\\n");' % n)
+        out.append("            return 1;")
+        out.append("        }")
+        out.append("        if(%s_unpack(message, &v2) != 0) {" % n)
+        out.append('            printf("%s: constant field differs\\n");' % n)
+        out.append("            return 1;")
+        out.append("        }")
+        for f in msg.members():
+            out.append("        get_message_bits%s(message, %s, %d, %d, &x, "
+                       "true);" % (suffix, nw, f.start, f.width))
+            out.append("        if(v2.%s != v.%s || x != v.%s) {" %
+                       (f.name, f.name, f.name))
+            out.append('            printf("%s: field %s differs\\n");' %
+                       (n, f.name))
+            out.append("            return 1;")
+            out.append("        }")
+        consts = [f for f in msg.fields if f.const is not None]
+        if consts:
+            f = consts[0]
+            out.append("")
+            out.append("        // Wrong constant is detected.")
+            out.append("        set_message_bits%s(message, %s, %d, %d, "
+                       "0x%xULL, true, true);" %
+                       (suffix, nw, f.start, f.width, f.const ^ 1))
+            out.append("        if(%s_unpack(message, &v2) != -1) {" % n)
+            out.append('            printf("%s: constant not checked\\n");' %
+                       n)
+            out.append("            return 1;")
+            out.append("        }")
+        out.append("    }")
+        out.append('    printf("%s: ok\\n");' % n)
+        out.append("    return 0;")
+        out.append("}")
+
+    out.append("")
+    out.append("int main(void) {")
+    out.append("    int failed = 0;")
+    for msg in messages:
+        out.append("    failed += test_%s();" % msg.name)
+    out.append("    return (failed ? 1 : 0);")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    ap = argparse.ArgumentParser(
+        description="Generates pack/unpack functions for bitter messages.")
+    ap.add_argument("layout", help="layout file")
+    ap.add_argument("-o", "--output", default=".", help="output directory")
+    ap.add_argument("-b", "--base",
+                    help="base name of generated files, default is the "
+                         "layout file name without extension")
+    args = ap.parse_args()
+
+    base = args.base or os.path.splitext(os.path.basename(args.layout))[0]
+    try:
+        with open(args.layout) as f:
+            messages = parse_layout(f.read())
+    except (OSError, LayoutError) as e:
+        print("bitgen: %s" % e, file=sys.stderr)
+        return 1
+
+    os.makedirs(args.output, exist_ok=True)
+    for name, text in ((base + ".h", gen_c(messages, base)),
+                       (base + ".hpp", gen_cpp(messages, base)),
+                       (base + "_test.c", gen_test(messages, base))):
+        with open(os.path.join(args.output, name), "w") as f:
+            f.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
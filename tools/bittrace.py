@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""bittrace - renders trace files written by libbitter.
+
+A trace file is written by bitter_trace_write or, when the BITTER_TRACE
+environment variable is set to a file name, when the traced process exits.
+Each event is printed as one line:
+
+    time        Microseconds since the first event
+    thread      Thread id of the caller
+    function    Traced bit function
+    start_bit   Absolute bit position of the field
+    bit_len     Number of bits of the field
+    word        Message word index and bit offset of start_bit
+    x           Field crosses a word boundary
+    result      Next bit position or negative error code
+
+Usage: bittrace.py <trace file> [-f <function>] [-t <thread>] [-e]
+"""
+
+import argparse
+import struct
+import sys
+
+
+# Layout of trace_header_t and bitter_trace_event_t in host byte order of
+# the traced process.
+HEADER = struct.Struct("=4sHHII")
+EVENT = struct.Struct("=QqqqIHH")
+VERSION = 1
+
+CROSSING = 0x0001
+
+# BITTER_TRACE_* function ids.
+FUNCTIONS = [
+    None,
+    "set_message_bits", "get_message_bits",
+    "set_message_bits2", "get_message_bits2",
+    "set_message_bits3", "get_message_bits3",
+    "set_message_bits_h", "get_message_bits_h",
+    "set_message_bits_le", "get_message_bits_le",
+    "set_message_bits2_le", "get_message_bits2_le",
+    "set_message_bits3_le", "get_message_bits3_le",
+    "set_message_bits2_h", "get_message_bits2_h",
+    "set_message_bits3_h", "get_message_bits3_h",
+    "set_buffer_bits", "get_buffer_bits",
+    "set_buffer_bits3", "get_buffer_bits3",
+    "bit_writer_put", "bit_writer_flush", "bit_reader_get",
+    "encode_fields", "decode_fields",
+    "encode_columns", "decode_columns", "decode_columns_buffer",
+    "message_crc", "message_crc_update",
+    "message_find", "message_find_all",
+    "copy_message_bits", "fill_message_bits", "clear_message_bits",
+    "insert_message_bits", "delete_message_bits",
+    "message_finalize", "message_load",
+    "bitstream_set_bits", "bitstream_get_bits",
+    "bitstream_set_bits3", "bitstream_get_bits3",
+    "bitstream_insert_bits", "bitstream_delete_bits",
+    "bitstream_find", "bitstream_find_all",
+]
+
+
+class TraceError(Exception):
+    pass
+
+
+def read_trace(f):
+    """Returns word bit length and list of event tuples of a trace file."""
+    data = f.read(HEADER.size)
+    if len(data) != HEADER.size:
+        raise TraceError("file too short")
+    magic, version, event_size, word_bit_len, cnt = HEADER.unpack(data)
+    if magic != b"BTRC":
+        raise TraceError("not a bitter trace file")
+    if version != VERSION or event_size != EVENT.size:
+        raise TraceError("unsupported trace file version %d" % version)
+
+    data = f.read(cnt * EVENT.size)
+    if len(data) != cnt * EVENT.size:
+        raise TraceError("file truncated, %d of %d events"
+                         % (len(data) // EVENT.size, cnt))
+    return word_bit_len, [e for e in EVENT.iter_unpack(data)]
+
+
+def function_name(function):
+    if 0 < function < len(FUNCTIONS):
+        return FUNCTIONS[function]
+    return "function_%d" % function
+
+
+def render(word_bit_len, events, out):
+    out.write("%12s %8s  %-22s %10s %8s %14s %s %8s\n" % (
+        "time", "thread", "function", "start_bit", "bit_len", "word", "x",
+        "result"))
+    t0 = events[0][0] if events else 0
+    for time_ns, start_bit, bit_len, result, thread, function, flags in events:
+        if start_bit >= 0:
+            word = "%d+%d" % (start_bit // word_bit_len,
+                              start_bit % word_bit_len)
+        else:
+            word = "-"
+        out.write("%12.3f %8d  %-22s %10d %8d %14s %s %8d\n" % (
+            (time_ns - t0) / 1000.0, thread, function_name(function),
+            start_bit, bit_len, word, "x" if flags & CROSSING else " ",
+            result))
+
+
+def main():
+    ap = argparse.ArgumentParser(
+        description="Renders trace files written by libbitter.")
+    ap.add_argument("trace", help="trace file")
+    ap.add_argument("-f", "--function", help="only events of function")
+    ap.add_argument("-t", "--thread", type=int,
+                    help="only events of thread id")
+    ap.add_argument("-e", "--errors", action="store_true",
+                    help="only calls returning an error")
+    args = ap.parse_args()
+
+    try:
+        with open(args.trace, "rb") as f:
+            word_bit_len, events = read_trace(f)
+    except (OSError, TraceError) as e:
+        print("bittrace: %s" % e, file=sys.stderr)
+        return 1
+
+    if args.function is not None:
+        events = [e for e in events if function_name(e[5]) == args.function]
+    if args.thread is not None:
+        events = [e for e in events if e[4] == args.thread]
+    if args.errors:
+        events = [e for e in events if e[3] < 0]
+    render(word_bit_len, events, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())